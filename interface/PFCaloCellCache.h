@@ -0,0 +1,129 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFCaloCellCache_h_
+#define RecoParticleFlow_PFClusterProducer_PFCaloCellCache_h_
+
+#include <vector>
+
+#include "DataFormats/DetId/interface/DetId.h"
+
+/**\class PFCaloCellCache
+\brief Cell geometry and neighbour tables of the calorimeters,
+as needed to make the PFRecHits
+
+EventSetup product of the CaloGeometryRecord, made once per geometry
+by PFCaloCellCacheESProducer. It is read-only, and shared by all the
+PFRecHit producers.
+
+The cells of each part are indexed by a dense index:
+  - ECAL: EBDetId hashed index, then EBDetId::kSizeForDenseIndexing
+    + EEDetId hashed index
+  - HCAL: HcalTopology dense id (HB, HE, HO and HF cells)
+  - PS: ESDetId hashed index
+  - CALOTOWER: CaloTowerDetId dense index, without cell geometry
+
+The neighbour table of a part has a row of nNeighbours(part) dense
+indices per cell, NOTFOUND if there is no neighbour. The rows of the
+ECAL, HCAL (HB, HE and HO cells only) and PS tables are:
+north, northeast, south, southwest, east, southeast, west, northwest.
+The rows of the CALOTOWER table are: north, northeast, northeast2,
+south, southwest, southwest2, east, east2, southeast, southeast2,
+west, west2, northwest, northwest2. The "2" neighbours are used
+where the phi pitch changes.
+
+The ECAL table exists in two variants, with the navigation crossing 
+the barrel-endcap border or not, so that each producer can choose 
+one (see ecalNeighbours).
+*/
+
+class PFCaloCellCache {
+ public:
+
+  enum Part { ECAL=0, HCAL, PS, CALOTOWER, NPARTS };
+
+  /// value of the missing neighbours
+  static const unsigned NOTFOUND = 0xFFFFFFFF;
+
+  /// geometry of a cell
+  struct Cell {
+    enum Status {
+      NOTFOUND=0,   // not in the geometry
+      NOAXIS,       // not a truncated pyramid, no axis
+      VALID
+    };
+    Cell() : status(NOTFOUND) {}
+    unsigned char status;
+    /// cell centre
+    float  position[3];
+    /// pseudorapidity and azimuth of the cell centre
+    float  eta;
+    float  phi;
+    /// difference of the back and front face centres
+    double axis[3];
+    /// NE, SE, SW and NW front corners
+    float  corners[4][3];
+  };
+
+  PFCaloCellCache() {}
+
+  /// \return the ECAL dense index of a barrel or endcap cell,
+  /// NOTFOUND for the other cells
+  static unsigned ecalDenseIndex( const DetId& id );
+
+  /// \return the geometry of a cell, 0 if it is not in the geometry
+  const Cell* cell( Part part, unsigned index ) const {
+    const std::vector<Cell>& cells = cells_[part];
+    if( index >= cells.size() ||
+	cells[index].status == Cell::NOTFOUND ) return 0;
+    return &cells[index];
+  }
+
+  /// number of entries in a row of the neighbour table of part
+  static unsigned nNeighbours( Part part ) {
+    return part == CALOTOWER ? 14 : 8;
+  }
+
+  /// for each entry of a row of the neighbour table of part,
+  /// true for a 4-neighbour, false for an 8-neighbour
+  static const bool* fourNeighbours( Part part );
+
+  /// \return the neighbours of a cell, 0 if there is no row for it
+  const unsigned* neighbours( Part part, unsigned index ) const {
+    const std::vector<unsigned>& table = neighbours_[part];
+    unsigned n = nNeighbours( part );
+    if( index >= table.size()/n ) return 0;
+    return &table[n*index];
+  }
+
+  /// \return the neighbours of an ECAL cell, the navigation crossing 
+  /// the barrel-endcap border or not. 0 if there is no row for it
+  const unsigned* ecalNeighbours( unsigned index, 
+				  bool crossBarrelEndcapBorder ) const {
+    if( !crossBarrelEndcapBorder ) return neighbours( ECAL, index );
+    if( index >= ecalCrossNeighbours_.size()/8 ) return 0;
+    return &ecalCrossNeighbours_[8*index];
+  }
+
+  /// number of rows of the neighbour table of part.
+  /// 0 if the subdetector is not in the geometry
+  unsigned size( Part part ) const {
+    return neighbours_[part].size()/nNeighbours( part );
+  }
+
+  /// to be used by PFCaloCellCacheESProducer only
+  std::vector<Cell>& cells( Part part ) { return cells_[part]; }
+  std::vector<unsigned>& neighbours( Part part ) { return neighbours_[part]; }
+  std::vector<unsigned>& ecalCrossNeighbours() { return ecalCrossNeighbours_; }
+
+ private:
+
+  /// cell geometry, by dense index
+  std::vector<Cell>      cells_[NPARTS];
+
+  /// neighbour tables. the ECAL one does not cross the 
+  /// barrel-endcap border
+  std::vector<unsigned>  neighbours_[NPARTS];
+
+  /// ECAL neighbour table crossing the barrel-endcap border
+  std::vector<unsigned>  ecalCrossNeighbours_;
+};
+
+#endif
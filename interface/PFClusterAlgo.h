@@ -46,6 +46,7 @@ class PFClusterAlgo {
  
 
   typedef edm::Handle< reco::PFRecHitCollection > PFRecHitHandle;
+  typedef edm::OrphanHandle< reco::PFRecHitCollection > PFRecHitOrphanHandle;
   
   /// perform clustering
   void doClustering( const reco::PFRecHitCollection& rechits );
@@ -54,6 +55,25 @@ class PFClusterAlgo {
   /// perform clustering in full framework
   void doClustering( const PFRecHitHandle& rechitsHandle );
   void doClustering( const PFRecHitHandle& rechitsHandle, const std::vector<bool> & mask );
+
+  /// perform clustering on rechits just put in the event 
+  /// by the calling producer
+  void doClustering( const PFRecHitOrphanHandle& rechitsHandle );
+  void doClustering( const PFRecHitOrphanHandle& rechitsHandle, const std::vector<bool> & mask );
+
+  /// restrict the seeds of the next clustering to the rechits i 
+  /// with seedMask[i] true. The topological clusters still grow 
+  /// over all the (masked) rechits, so that the clusters seeded 
+  /// near the border of the seed mask are the same as without it
+  void setSeedMask( const std::vector<bool>& seedMask ) 
+    { seedMask_ = seedMask; }
+
+  /// make the rechit references of cluster point to the rechits of 
+  /// the same indices in rechitsHandle, e.g. rehydrated from a 
+  /// PFRecHitSlim. \return false if an index is out of range, 
+  /// in which case the cluster is left unchanged
+  static bool rebindRecHitRefs( reco::PFCluster& cluster, 
+				const PFRecHitOrphanHandle& rechitsHandle );
   
   /// setters -------------------------------------------------------
   
@@ -110,6 +130,13 @@ class PFClusterAlgo {
   /// Activate cleaning of HCAL RBX's and HPD's
   void setCleanRBXandHPDs( bool cleanRBXandHPDs) { cleanRBXandHPDs_ = cleanRBXandHPDs; }
 
+  /// set the distances to the ECAL cracks (see dCrack), precomputed for 
+  /// each crystal and indexed by barrel and endcap hashed index.
+  /// Empty vectors make the distances computed on the fly.
+  void setCrackDistances( const std::vector< std::pair<double,double> >& barrel,
+			  const std::vector< std::pair<double,double> >& endcap ) 
+    { crackDistBarrel_ = barrel; crackDistEndcap_ = endcap; }
+
   /// getters -------------------------------------------------------
  
   /// get barrel threshold
@@ -157,7 +184,8 @@ class PFClusterAlgo {
     SPECIAL 
   };
 
-  /// \return color of the rechit
+  /// \return color of the rechit. 
+  /// always NONE unless compiled with PFLOW_DEBUG
   unsigned color(unsigned rhi) const;
 
   /// \return seed flag (not seed state) for rechit with index rhi
@@ -189,6 +217,9 @@ class PFClusterAlgo {
   /// in a given layer. 
     double parameter( Parameter paramtype, PFLayer::Layer layer, unsigned iCoeff = 0, int iring0=0) const; 
 
+  /// distance to a crack in the ECAL barrel in eta and phi direction
+  static std::pair<double,double> dCrack(double phi, double eta);
+
   
   enum SeedState {
     UNKNOWN=-1,
@@ -208,9 +239,61 @@ class PFClusterAlgo {
   /// perform clustering
   void doClusteringWorker( const reco::PFRecHitCollection& rechits );
 
+  /// initialize the rechit states from a mask
+  void setMask( const reco::PFRecHitCollection& rechits, 
+		const std::vector<bool> & mask );
+
+  /// bits of the rechit state
+  enum StateBits {
+    MASK_BIT    = 0x01,
+    TOPO_BIT    = 0x02,
+    SEED_SHIFT  = 2,
+    SEED_BITS   = 0x0C,
+    COLOR_SHIFT = 4,
+    COLOR_BITS  = 0x30,
+    NOSEED_BIT  = 0x40
+  };
+
+  /// unchecked accessors to the rechit state, for internal use. 
+  /// the seed state is stored shifted by one, so that UNKNOWN is 0
+  bool isMasked( unsigned rhi ) const { return states_[rhi] & MASK_BIT; }
+  void unmask( unsigned rhi ) { states_[rhi] &= ~MASK_BIT; }
+
+  bool isSeedAllowed( unsigned rhi ) const { return !( states_[rhi] & NOSEED_BIT ); }
+
+  bool isUsedInTopo( unsigned rhi ) const { return states_[rhi] & TOPO_BIT; }
+  void setUsedInTopo( unsigned rhi ) { states_[rhi] |= TOPO_BIT; }
+
+  SeedState seedState( unsigned rhi ) const 
+    { return static_cast<SeedState>( ( ( states_[rhi] & SEED_BITS ) >> SEED_SHIFT ) - 1 ); }
+  void setSeedState( unsigned rhi, SeedState state ) 
+    { states_[rhi] = ( states_[rhi] & ~SEED_BITS ) | ( ( state + 1 ) << SEED_SHIFT ); }
+
+  /// seed flag (YES or CLEAN seed state)
+  bool seedFlag( unsigned rhi ) const 
+    { return ( states_[rhi] & SEED_BITS ) >= ( ( YES + 1 ) << SEED_SHIFT ); }
+
   /// Clean HCAL readout box noise and HPD discharge
   void cleanRBXAndHPD( const reco::PFRecHitCollection& rechits );
 
+  /// mask the softest of a list of HCAL rechits: the four softest, 
+  /// and those below factor times the energy of the fifth one
+  void cleanHits( const unsigned* rhits, unsigned nhits, double factor, 
+		  const reco::PFRecHitCollection& rechits );
+
+  /// compute the 4-neighbour energy sums used by the seed cleaning,
+  /// for all rechits energetic enough to be tested
+  void computeNeighbourSums( const reco::PFRecHitCollection& rechits );
+
+  /// sum the energies of the masked 4-neighbours of rechit rhi
+  void sumMaskedNeighbours( unsigned rhi, 
+			    const reco::PFRecHitCollection& rechits );
+
+  /// update the sums of the cleaning candidates around a rechit 
+  /// which has just been unmasked
+  void updateNeighbourSums( unsigned rhi, 
+			    const reco::PFRecHitCollection& rechits );
+
   /// look for seeds 
   void findSeeds( const reco::PFRecHitCollection& rechits );
 
@@ -225,25 +308,32 @@ class PFClusterAlgo {
   void buildPFClusters( const std::vector< unsigned >& cluster, 
 			const reco::PFRecHitCollection& rechits ); 
 
-  /// calculate position of a cluster
+  /// calculate position of a cluster. 
+  /// seedNeighbours, if given, flags the rechits of the topocluster 
+  /// (see topoPosition_) which are neighbours of the seed
   void calculateClusterPosition( reco::PFCluster& cluster, 
                                  reco::PFCluster& clusterwodepthcor,
 				 bool depcor = true,
-				 int posCalcNCrystal=0);
+				 int posCalcNCrystal=0,
+				 unsigned seed=0,
+				 const unsigned char* seedNeighbours=0);
   
   /// create a reference to a rechit. 
-  /// in case  rechitsHandle_.isValid(), this reference is permanent.
+  /// in case  rechitsHandle_.isValid() or rechitsOrphanHandle_.isValid(), 
+  /// this reference is permanent.
   reco::PFRecHitRef  createRecHitRef( const reco::PFRecHitCollection& rechits, 
 				      unsigned rhi );
 
   /// paint a rechit with a color. 
   void paint( unsigned rhi, unsigned color=1 );
 
-  /// distance to a crack in the ECAL barrel in eta and phi direction
-  std::pair<double,double> dCrack(double phi, double eta);
+  /// distance to the ECAL cracks for a rechit, from the 
+  /// precomputed tables when available
+  std::pair<double,double> crackDistance( const reco::PFRecHit& rh ) const;
   
 
   PFRecHitHandle           rechitsHandle_;   
+  PFRecHitOrphanHandle     rechitsOrphanHandle_;   
 
   /// ids of rechits used in seed search
   std::set<unsigned>       idUsedRecHits_;
@@ -251,18 +341,60 @@ class PFClusterAlgo {
   /// indices to rechits, sorted by decreasing E (not E_T)
   std::multimap<double, unsigned, std::greater<double> >  eRecHits_;
 
-  /// mask, for all rechits. only masked rechits will be clustered
-  /// by default, all rechits are masked. see setMask function.
-  std::vector< bool >      mask_;
+  /// state of all rechits, one byte per rechit (see StateBits): 
+  /// mask (only masked rechits will be clustered; by default, all 
+  /// rechits are masked, see setMask function), used in topo cluster,
+  /// seed state and color
+  std::vector< unsigned char > states_;
+
+  /// rechits allowed as seeds in the next clustering, all if empty 
+  /// (see setSeedMask)
+  std::vector<bool>  seedMask_;
+
+  /// 4-neighbour energy sums of a rechit, for S4/S1 and double spike cleaning
+  struct NeighbourSums {
+    NeighbourSums() : surroundingEnergy(0.), maskedEnergy(0.), allEnergy(0.), 
+      maxEnergy(-999.), maxNeighbour(0), candidate(false), hasAllEnergy(false) {}
+    /// Eup of the hit + sum of E+Eup over masked 4-neighbours
+    double   surroundingEnergy;
+    /// sum of E over masked 4-neighbours
+    double   maskedEnergy;
+    /// sum of E over all 4-neighbours
+    double   allEnergy;
+    /// energy and index of the most energetic masked 4-neighbour
+    double   maxEnergy;
+    unsigned maxNeighbour;
+    /// masked sums are filled (rechit may be tested for cleaning)
+    bool     candidate;
+    /// allEnergy is filled
+    bool     hasAllEnergy;
+  };
 
-  /// color, for all rechits
-  std::vector< unsigned >  color_;
+  /// neighbour energy sums, for all rechits
+  std::vector< NeighbourSums > neighbourSums_;
 
-  /// seed state, for all rechits
-  std::vector< SeedState > seedStates_;
+  /// HCAL rechit with its HPD and RBX dense indices, for the RBX/HPD cleaning
+  struct HcalCleaningHit {
+    unsigned rhi;
+    unsigned hpd;
+    unsigned rbx;
+  };
+
+  /// work buffers for the RBX/HPD cleaning, kept to avoid reallocations: 
+  /// HCAL rechits, rechits grouped by HPD and by RBX, and energy-sorted hits
+  std::vector< HcalCleaningHit > hcalCleaningHits_;
+  std::vector< unsigned >  hpdHits_;
+  std::vector< unsigned >  rbxHits_;
+  std::vector< std::pair<double, unsigned> > cleanEnergies_;
+
+  /// distances to the ECAL cracks, per barrel and endcap hashed index
+  std::vector< std::pair<double,double> > crackDistBarrel_;
+  std::vector< std::pair<double,double> > crackDistEndcap_;
 
-  /// used in topo cluster? for all rechits
-  std::vector< bool >      usedInTopo_;
+  /// cleaning candidates having a given rechit as 4-neighbour, 
+  /// stored as offsets (one per rechit + 1) into a flat index list
+  std::vector< unsigned >  nbCandOffsets_;
+  std::vector< unsigned >  nbCandIndices_;
 
   /// vector of indices for seeds.   
   std::vector< unsigned >  seeds_; 
@@ -270,6 +402,13 @@ class PFClusterAlgo {
   /// sets of cells having one common side, and energy over threshold
   std::vector< std::vector< unsigned > > topoClusters_;
 
+  /// position of each rechit in the topocluster being processed
+  std::vector< unsigned >  topoPosition_;
+
+  /// neighbour flags of the rechits of the topocluster being processed,
+  /// for each of its seeds (seed-major), for the 5 or 9 crystal position
+  std::vector< unsigned char > seedNeighbours_;
+
   /// all clusters
   // std::vector< reco::PFCluster >  allClusters_;
 
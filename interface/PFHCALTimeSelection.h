@@ -0,0 +1,103 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFHCALTimeSelection_h_
+#define RecoParticleFlow_PFClusterProducer_PFHCALTimeSelection_h_
+
+#include <vector>
+
+#include "DataFormats/HcalDetId/interface/HcalDetId.h"
+
+namespace edm {
+  class ParameterSet;
+}
+
+/**\class PFHCALTimeSelection
+\brief Time selection of the HB and HE rechits
+
+Used by PFRecHitProducerHCAL to make the HB and HE PFRecHits
+directly from the HBHE rechits in time, instead of the CaloTowers.
+The selection is applied to all the candidate rechits of the event
+at once, before any geometry access.
+*/
+
+class PFHCALTimeSelection {
+ public:
+
+  virtual ~PFHCALTimeSelection() {}
+
+  /// correct the times of n HB or HE rechits of given (calibrated)
+  /// energies, and set accept[i] to 1 if rechit i is selected, 0 if not
+  virtual void select( unsigned n,
+		       const HcalDetId* detids,
+		       const double* energies,
+		       double* times,
+		       unsigned char* accept ) const = 0;
+};
+
+
+
+/**\class PFHCALDualTimeSelection
+\brief Slewing correction and time window, by subdetector and depth,
+as used in the HCAL upgrade studies
+
+The corrected time is t - A/(B+E). The rechit is selected if
+tmin < t < tmax. A, B, tmin and tmax are read from the
+"dualTimeSelection" PSet, by depth:
+
+  HB_slewA, HB_slewB, HB_minTime, HB_maxTime,
+  HE_slewA, HE_slewB, HE_minTime, HE_maxTime
+
+If the PSet is missing, the values for signal=4 are used.
+Rechits at other depths are rejected.
+
+\author Chris Tully
+\date   June 2012
+*/
+
+class PFHCALDualTimeSelection : public PFHCALTimeSelection {
+ public:
+
+  /// the tables are read from the "dualTimeSelection" PSet of iConfig,
+  /// if any
+  explicit PFHCALDualTimeSelection( const edm::ParameterSet& iConfig );
+
+  virtual void select( unsigned n,
+		       const HcalDetId* detids,
+		       const double* energies,
+		       double* times,
+		       unsigned char* accept ) const override;
+
+ private:
+
+  /// set the rows of a subdetector. the first row is depth 1
+  void setRows( int subdet,
+		const std::vector<double>& slewA,
+		const std::vector<double>& slewB,
+		const std::vector<double>& minTime,
+		const std::vector<double>& maxTime );
+
+  /// \return the row of the tables for detid. the last row
+  /// rejects everything
+  unsigned row( const HcalDetId& detid ) const {
+    unsigned subdet = detid.subdet() == HcalEndcap ? 1 : 0;
+    if( detid.subdet() != HcalBarrel && detid.subdet() != HcalEndcap )
+      return reject_;
+    unsigned depth = detid.depth();
+    if( depth < 1 || depth > nDepths_[subdet] ) return reject_;
+    return firstRow_[subdet] + depth - 1;
+  }
+
+  /// the tables, by row: HB depths, then HE depths, then a row
+  /// rejecting everything
+  std::vector<double>  slewA_;
+  std::vector<double>  slewB_;
+  std::vector<double>  minTime_;
+  std::vector<double>  maxTime_;
+
+  /// for HB and HE, first row and number of depths
+  unsigned  firstRow_[2];
+  unsigned  nDepths_[2];
+
+  /// the row rejecting everything
+  unsigned  reject_;
+};
+
+#endif
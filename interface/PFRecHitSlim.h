@@ -0,0 +1,54 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFRecHitSlim_h_
+#define RecoParticleFlow_PFClusterProducer_PFRecHitSlim_h_
+
+#include <vector>
+#include <stdint.h>
+
+#include "DataFormats/ParticleFlowReco/interface/PFRecHitFwd.h"
+
+namespace reco {
+
+/**\class reco::PFRecHitSlim
+\brief Particle flow rechits without their geometry, for persistence
+
+Optional event product of the ECAL, HO and PS PFRecHitProducers
+(slimPersistence), in the order of the PFRecHitCollection. Only the
+detId, energy, time and neighbours of each rechit are stored: the
+position, axis and corners are copied from the cell geometry by the
+producers, and are rehydrated from the PFCaloCellCache on read by
+PFRecHitProducerSlim. The layer is deduced from the detId.
+
+The energy and time are single precision, as in the calorimeter
+rechits they come from. The neighbours are stored in compressed
+rows.
+*/
+
+class PFRecHitSlim {
+ public:
+
+  PFRecHitSlim() {}
+
+  /// number of rechits
+  unsigned size() const { return detId.size(); }
+
+  /// fill the columns from the rechits
+  void fill( const reco::PFRecHitCollection& rechits );
+
+  // ----------columns ---------------------------
+
+  std::vector<uint32_t>  detId;
+  std::vector<float>     energy;
+  /// time (see PFRecHit::rescale)
+  std::vector<float>     time;
+
+  /// neighbours of the rechit i: neighbours[ neighbourOffsets[i] ]
+  /// to neighbours[ neighbourOffsets[i+1] - 1 ], the nNeighbours4[i]
+  /// first ones being the 4-neighbours
+  std::vector<uint32_t>       neighbourOffsets;
+  std::vector<unsigned char>  nNeighbours4;
+  std::vector<uint32_t>       neighbours;
+};
+
+}
+
+#endif
@@ -0,0 +1,1028 @@
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFCaloCellCacheESProducer.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitNeighbourCache.h"
+
+#include <sstream>
+
+#include "DataFormats/DetId/interface/DetId.h"
+#include "DataFormats/EcalDetId/interface/EBDetId.h"
+#include "DataFormats/EcalDetId/interface/EEDetId.h"
+#include "DataFormats/EcalDetId/interface/ESDetId.h"
+#include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+#include "DataFormats/HcalDetId/interface/HcalSubdetector.h"
+#include "DataFormats/CaloTowers/interface/CaloTowerDetId.h"
+#include "DataFormats/Math/interface/Vector3D.h"
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "Geometry/Records/interface/IdealGeometryRecord.h"
+#include "Geometry/CaloGeometry/interface/CaloGeometry.h"
+#include "Geometry/CaloGeometry/interface/CaloSubdetectorGeometry.h"
+#include "Geometry/CaloGeometry/interface/CaloCellGeometry.h"
+#include "Geometry/CaloGeometry/interface/TruncatedPyramid.h"
+#include "Geometry/EcalAlgo/interface/EcalBarrelGeometry.h"
+#include "Geometry/EcalAlgo/interface/EcalEndcapGeometry.h"
+#include "Geometry/CaloTopology/interface/EcalBarrelTopology.h"
+#include "Geometry/CaloTopology/interface/EcalEndcapTopology.h"
+#include "Geometry/CaloTopology/interface/EcalPreshowerTopology.h"
+#include "Geometry/CaloTopology/interface/HcalTopology.h"
+#include "Geometry/CaloTopology/interface/CaloTowerTopology.h"
+#include "RecoCaloTools/Navigation/interface/CaloNavigator.h"
+
+using namespace std;
+using namespace edm;
+
+namespace {
+
+  /// content of the neighbour tables, added to the checksum of the
+  /// cache files. 3: PFCaloCellCache tables, north first. 
+  /// 4: both ECAL tables, with and without the border crossing
+  const uint32_t neighbourTableContent = 4;
+
+  /// directions probed on the borders, and the entries of a row of
+  /// the 3x3 windows, both in the order SOUTHWEST, SOUTH, SOUTHEAST,
+  /// WEST, EAST, NORTHWEST, NORTH, NORTHEAST
+  const CaloDirection orderedDir[8] = { SOUTHWEST, SOUTH, SOUTHEAST,
+					WEST, EAST,
+					NORTHWEST, NORTH, NORTHEAST };
+
+  /// entry of the PFCaloCellCache row for each of these directions
+  const unsigned rowEntry[8] = { 3, 2, 5, 6, 4, 7, 0, 1 };
+
+  /// HCAL dense id of a neighbour, NOTFOUND if not in HO
+  unsigned denseIdHO( const DetId& id, const HcalTopology& topo ) {
+    if( id.det() != DetId::Hcal || id.subdetId() != HcalOuter )
+      return PFCaloCellCache::NOTFOUND;
+    return topo.detId2denseId( id );
+  }
+
+  /// hashed index of a preshower strip, NOTFOUND for DetId(0)
+  unsigned stripIndex( const DetId& id ) {
+    if( id == DetId(0) ) return PFCaloCellCache::NOTFOUND;
+    return ESDetId( id ).hashedIndex();
+  }
+}
+
+
+
+PFCaloCellCacheESProducer::PFCaloCellCacheESProducer(const edm::ParameterSet& iConfig) {
+
+  neighbourCacheFile_ =
+    iConfig.getUntrackedParameter<string>("neighbourCacheFile","");
+
+  setWhatProduced(this);
+}
+
+
+
+PFCaloCellCacheESProducer::~PFCaloCellCacheESProducer() {}
+
+
+
+std::auto_ptr<PFCaloCellCache>
+PFCaloCellCacheESProducer::produce(const CaloGeometryRecord& record) {
+
+  std::auto_ptr<PFCaloCellCache> cellCache( new PFCaloCellCache );
+
+  edm::ESHandle<CaloGeometry> geoHandle;
+  record.get(geoHandle);
+
+  edm::ESHandle<HcalTopology> hcalTopology;
+  record.getRecord<IdealGeometryRecord>().get(hcalTopology);
+
+  // ECAL barrel and endcap
+  const CaloSubdetectorGeometry *ebGeom =
+    geoHandle->getSubdetectorGeometry(DetId::Ecal, EcalBarrel);
+  const CaloSubdetectorGeometry *eeGeom =
+    geoHandle->getSubdetectorGeometry(DetId::Ecal, EcalEndcap);
+  if( ebGeom && eeGeom ) {
+    vector<PFCaloCellCache::Cell>& cells =
+      cellCache->cells( PFCaloCellCache::ECAL );
+    cells.assign( EBDetId::kSizeForDenseIndexing +
+		  EEDetId::kSizeForDenseIndexing, PFCaloCellCache::Cell() );
+    fillCells( cells, *ebGeom, DetId::Ecal, EcalBarrel,
+	       &PFCaloCellCache::ecalDenseIndex );
+    fillCells( cells, *eeGeom, DetId::Ecal, EcalEndcap,
+	       &PFCaloCellCache::ecalDenseIndex );
+    fillEcalNeighbours( geoHandle, *cellCache );
+  }
+
+  // HCAL: HB, HE, HO and HF
+  const HcalTopology& topology = *hcalTopology;
+  vector<PFCaloCellCache::Cell>& hcalCells =
+    cellCache->cells( PFCaloCellCache::HCAL );
+  hcalCells.assign( topology.ncells(), PFCaloCellCache::Cell() );
+  static const int hcalSubdets[4] =
+    { HcalBarrel, HcalEndcap, HcalOuter, HcalForward };
+  for(unsigned is=0; is<4; ++is) {
+    const CaloSubdetectorGeometry *geom =
+      geoHandle->getSubdetectorGeometry(DetId::Hcal, hcalSubdets[is]);
+    if( !geom ) continue;
+    fillCells( hcalCells, *geom, DetId::Hcal, hcalSubdets[is],
+	       [&topology]( const DetId& id ) {
+		 return topology.detId2denseId( id );
+	       } );
+  }
+  fillHcalNeighbours( geoHandle->getSubdetectorGeometry(DetId::Hcal, HcalOuter),
+		      topology, *cellCache );
+
+  // PS. ShR 28 Jul 2008: the partial CMS geometries of the
+  // Pilot1/2 scenarios do not include the preshower
+  const CaloSubdetectorGeometry *psGeom =
+    geoHandle->getSubdetectorGeometry(DetId::Ecal, EcalPreshower);
+  if( psGeom ) {
+    vector<PFCaloCellCache::Cell>& cells =
+      cellCache->cells( PFCaloCellCache::PS );
+    cells.assign( ESDetId::kSizeForDenseIndexing, PFCaloCellCache::Cell() );
+    fillCells( cells, *psGeom, DetId::Ecal, EcalPreshower,
+	       []( const DetId& id ) {
+		 return unsigned( ESDetId( id ).hashedIndex() );
+	       } );
+    fillPSNeighbours( geoHandle, *psGeom, *cellCache );
+  }
+
+  // CaloTowers, independent of the geometry
+  fillCaloTowerNeighbours( *cellCache );
+
+  return cellCache;
+}
+
+
+
+template<class Index>
+void
+PFCaloCellCacheESProducer::fillCells( vector<PFCaloCellCache::Cell>& cells,
+				      const CaloSubdetectorGeometry& geom,
+				      int det, int subdet,
+				      Index denseIndex ) const {
+
+  const vector<DetId>& ids =
+    geom.getValidDetIds( DetId::Detector(det), subdet );
+  for(unsigned ic=0; ic<ids.size(); ++ic) {
+    unsigned index = denseIndex( ids[ic] );
+    if( index >= cells.size() ) continue;
+
+    const CaloCellGeometry* thisCell = geom.getGeometry( ids[ic] );
+    if( !thisCell ) continue;
+
+    PFCaloCellCache::Cell& cell = cells[index];
+    cell.position[0] = thisCell->getPosition().x();
+    cell.position[1] = thisCell->getPosition().y();
+    cell.position[2] = thisCell->getPosition().z();
+    cell.eta = thisCell->getPosition().eta();
+    cell.phi = thisCell->getPosition().phi();
+
+    const CaloCellGeometry::CornersVec& corners = thisCell->getCorners();
+    assert( corners.size() == 8 );
+    for(unsigned icorner=0; icorner<4; ++icorner) {
+      cell.corners[icorner][0] = corners[icorner].x();
+      cell.corners[icorner][1] = corners[icorner].y();
+      cell.corners[icorner][2] = corners[icorner].z();
+    }
+
+    // the axis is only defined for truncated pyramids
+    const TruncatedPyramid* pyr
+      = dynamic_cast< const TruncatedPyramid* > (thisCell);
+    if( !pyr ) {
+      cell.status = PFCaloCellCache::Cell::NOAXIS;
+      continue;
+    }
+
+    math::XYZVector axis( pyr->getPosition(1).x(),
+			  pyr->getPosition(1).y(),
+			  pyr->getPosition(1).z() );
+    math::XYZVector axis0( pyr->getPosition(0).x(),
+			   pyr->getPosition(0).y(),
+			   pyr->getPosition(0).z() );
+    axis -= axis0;
+
+    cell.axis[0] = axis.x();
+    cell.axis[1] = axis.y();
+    cell.axis[2] = axis.z();
+    cell.status = PFCaloCellCache::Cell::VALID;
+  }
+}
+
+
+
+string
+PFCaloCellCacheESProducer::cacheFile( const char* part ) const {
+  if( neighbourCacheFile_.empty() ) return neighbourCacheFile_;
+  return neighbourCacheFile_ + "." + part;
+}
+
+
+
+void
+PFCaloCellCacheESProducer::fillEcalNeighbours( const edm::ESHandle<CaloGeometry>& geoHandle,
+					       PFCaloCellCache& cellCache ) const {
+
+  // get the ecalBarrel geometry
+  const CaloSubdetectorGeometry *ebtmp =
+    geoHandle->getSubdetectorGeometry(DetId::Ecal, EcalBarrel);
+
+  const EcalBarrelGeometry* ecalBarrelGeometry =
+    dynamic_cast< const EcalBarrelGeometry* > (ebtmp);
+  assert( ecalBarrelGeometry );
+
+  // get the ecalBarrel topology
+  EcalBarrelTopology ecalBarrelTopology(geoHandle);
+
+  // get the endcap geometry
+  const CaloSubdetectorGeometry *eetmp =
+    geoHandle->getSubdetectorGeometry(DetId::Ecal, EcalEndcap);
+
+  const EcalEndcapGeometry* ecalEndcapGeometry =
+    dynamic_cast< const EcalEndcapGeometry* > (eetmp);
+  assert( ecalEndcapGeometry );
+
+  // get the endcap topology
+  EcalEndcapTopology ecalEndcapTopology(geoHandle);
+
+  // try the table saved by a previous job for the same geometry
+  PFRecHitNeighbourCache cache( cacheFile("ECAL") );
+  if( cache.enabled() ) {
+    cache.addGeometry( *ecalBarrelGeometry, DetId::Ecal, EcalBarrel );
+    cache.addGeometry( *ecalEndcapGeometry, DetId::Ecal, EcalEndcap );
+    cache.add( neighbourTableContent );
+  }
+  unsigned tableSize = 8*( EBDetId::kSizeForDenseIndexing +
+			   EEDetId::kSizeForDenseIndexing );
+
+  vector<unsigned>& table = cellCache.neighbours( PFCaloCellCache::ECAL );
+  vector<unsigned>& crossTable = cellCache.ecalCrossNeighbours();
+
+  // the file holds the two tables one after the other
+  vector<unsigned> both;
+  if( cache.read( both, 2*tableSize ) ) {
+    table.assign( both.begin(), both.begin()+tableSize );
+    crossTable.assign( both.begin()+tableSize, both.end() );
+    return;
+  }
+
+  ecalNeighbArray( *ecalBarrelGeometry,
+		   ecalBarrelTopology,
+		   *ecalEndcapGeometry,
+		   ecalEndcapTopology,
+		   table, crossTable );
+  if( cache.enabled() ) {
+    both = table;
+    both.insert( both.end(), crossTable.begin(), crossTable.end() );
+    cache.write( both );
+  }
+}
+
+
+
+void
+PFCaloCellCacheESProducer::fillHcalNeighbours( const CaloSubdetectorGeometry* hoGeom,
+					       const HcalTopology& topology,
+					       PFCaloCellCache& cellCache ) const {
+
+  // try the table saved by a previous job for the same geometry
+  PFRecHitNeighbourCache cache( cacheFile("HCAL") );
+  if( cache.enabled() ) {
+    if( hoGeom ) cache.addGeometry( *hoGeom, DetId::Hcal, HcalOuter );
+    cache.add( topology.mode() );
+    cache.add( topology.ncells() );
+    cache.add( neighbourTableContent );
+  }
+
+  vector<unsigned>& table = cellCache.neighbours( PFCaloCellCache::HCAL );
+  if( cache.read( table, 8*topology.ncells() ) ) return;
+
+  table.assign( 8*topology.ncells(), PFCaloCellCache::NOTFOUND );
+
+  // HB and HE cells, with the HCAL topology
+  for(unsigned cell=0; cell<topology.ncells(); ++cell) {
+
+    DetId detid = topology.denseId2detId( cell );
+    if( detid.det() != DetId::Hcal ) continue;
+    if( detid.subdetId() != HcalBarrel &&
+	detid.subdetId() != HcalEndcap ) continue;
+
+    CaloNavigator<DetId> navigator(detid, &topology);
+
+    DetId north = navigator.north();
+
+    DetId northeast(0);
+    if( north != DetId(0) ) {
+      northeast = navigator.east();
+    }
+    navigator.home();
+
+
+    DetId south = navigator.south();
+
+
+
+    DetId southwest(0);
+    if( south != DetId(0) ) {
+      southwest = navigator.west();
+    }
+    navigator.home();
+
+
+    DetId east = navigator.east();
+    DetId southeast;
+    if( east != DetId(0) ) {
+      southeast = navigator.south();
+    }
+    navigator.home();
+    DetId west = navigator.west();
+    DetId northwest;
+    if( west != DetId(0) ) {
+      northwest = navigator.north();
+    }
+    navigator.home();
+
+    const DetId neighbours[8] =
+      { north, northeast, south, southwest,
+	east, southeast, west, northwest };
+
+    unsigned* row = &table[8*cell];
+    for(unsigned in=0; in<8; ++in) {
+      if( neighbours[in] == DetId(0) ) continue;
+      row[in] = topology.detId2denseId( neighbours[in] );
+    }
+  }
+
+  // HO cells
+  if( hoGeom ) hoNeighbArray( *hoGeom, topology, table );
+
+  cache.write( table );
+}
+
+
+
+void
+PFCaloCellCacheESProducer::fillPSNeighbours( const edm::ESHandle<CaloGeometry>& geoHandle,
+					     const CaloSubdetectorGeometry& psGeom,
+					     PFCaloCellCache& cellCache ) const {
+
+  // try the table saved by a previous job for the same geometry
+  PFRecHitNeighbourCache cache( cacheFile("PS") );
+  if( cache.enabled() ) {
+    cache.addGeometry( psGeom, DetId::Ecal, EcalPreshower );
+    cache.add( neighbourTableContent );
+  }
+
+  const unsigned size = 8*ESDetId::kSizeForDenseIndexing;
+  vector<unsigned>& table = cellCache.neighbours( PFCaloCellCache::PS );
+  if( cache.read( table, size ) ) return;
+
+  // get the ps topology
+  EcalPreshowerTopology psTopology(geoHandle);
+
+  table.assign( size, PFCaloCellCache::NOTFOUND );
+
+  const vector<DetId>& strips =
+    psGeom.getValidDetIds(DetId::Ecal, EcalPreshower);
+  for(unsigned is=0; is<strips.size(); ++is) {
+
+    const DetId& detid = strips[is];
+    CaloNavigator<DetId> navigator(detid, &psTopology);
+
+    DetId north = navigator.north();
+    DetId northeast(0);
+    if( north != DetId(0) ) {
+      northeast = navigator.east();
+    }
+    navigator.home();
+
+    DetId south = navigator.south();
+    DetId southwest(0);
+    if( south != DetId(0) ) {
+      southwest = navigator.west();
+    }
+    navigator.home();
+
+    DetId east = navigator.east();
+    DetId southeast(0);
+    if( east != DetId(0) ) {
+      southeast = navigator.south();
+    }
+    navigator.home();
+
+    DetId west = navigator.west();
+    DetId northwest(0);
+    if( west != DetId(0) ) {
+      northwest = navigator.north();
+    }
+
+    unsigned* row = &table[8*stripIndex(detid)];
+    row[0] = stripIndex( north );
+    row[1] = stripIndex( northeast );
+    row[2] = stripIndex( south );
+    row[3] = stripIndex( southwest );
+    row[4] = stripIndex( east );
+    row[5] = stripIndex( southeast );
+    row[6] = stripIndex( west );
+    row[7] = stripIndex( northwest );
+  }
+
+  cache.write( table );
+}
+
+
+
+void
+PFCaloCellCacheESProducer::fillCaloTowerNeighbours( PFCaloCellCache& cellCache ) const {
+
+  CaloTowerTopology topology;
+
+  const unsigned nNeighboursCT =
+    PFCaloCellCache::nNeighbours( PFCaloCellCache::CALOTOWER );
+
+  vector<unsigned>& table = cellCache.neighbours( PFCaloCellCache::CALOTOWER );
+  table.assign( nNeighboursCT*CaloTowerDetId::kSizeForDenseIndexing,
+		PFCaloCellCache::NOTFOUND );
+
+  for(unsigned tower=0; tower<CaloTowerDetId::kSizeForDenseIndexing; ++tower) {
+
+    if( !CaloTowerDetId::validDenseIndex( tower ) ) continue;
+    CaloTowerDetId ctDetId = CaloTowerDetId::detIdFromDenseIndex( tower );
+    if( !topology.valid( ctDetId ) ) continue;
+
+    vector<DetId> northids = topology.north(ctDetId);
+    vector<DetId> westids = topology.west(ctDetId);
+    vector<DetId> southids = topology.south(ctDetId);
+    vector<DetId> eastids = topology.east(ctDetId);
+
+
+    // all the following detids will be CaloTowerDetId
+    CaloTowerDetId north;
+    CaloTowerDetId northwest;
+    CaloTowerDetId northwest2;
+    CaloTowerDetId west;
+    CaloTowerDetId west2;
+    CaloTowerDetId southwest;
+    CaloTowerDetId southwest2;
+    CaloTowerDetId south;
+    CaloTowerDetId southeast;
+    CaloTowerDetId southeast2;
+    CaloTowerDetId east;
+    CaloTowerDetId east2;
+    CaloTowerDetId northeast;
+    CaloTowerDetId northeast2;
+
+    // for north and south, there is no ambiguity : 1 or 0 neighbours
+
+    switch( northids.size() ) {
+    case 0:
+      break;
+    case 1:
+      north = northids[0];
+      break;
+    default:
+      throw cms::Exception("PFCaloCellCache")
+	<<"PFCaloCellCacheESProducer::fillCaloTowerNeighbours : incorrect number of neighbours north: "
+	<<northids.size();
+    }
+
+    switch( southids.size() ) {
+    case 0:
+      break;
+    case 1:
+      south = southids[0];
+      break;
+    default:
+      throw cms::Exception("PFCaloCellCache")
+	<<"PFCaloCellCacheESProducer::fillCaloTowerNeighbours : incorrect number of neighbours south: "
+	<<southids.size();
+    }
+
+    // for east and west, one must take care
+    // of the pitch change in HCAL endcap.
+
+    switch( eastids.size() ) {
+    case 0:
+      break;
+    case 1:
+      east = eastids[0];
+      northeast = getNorth(east, topology);
+      southeast = getSouth(east, topology);
+      break;
+    case 2:
+      // in this case, 0 is more on the north than 1
+      east = eastids[0];
+      east2 = eastids[1];
+      northeast = getNorth(east, topology );
+      southeast = getSouth(east2, topology);
+      northeast2 = getNorth(northeast, topology );
+      southeast2 = getSouth(southeast, topology);
+      break;
+    default:
+      throw cms::Exception("PFCaloCellCache")
+	<<"PFCaloCellCacheESProducer::fillCaloTowerNeighbours : incorrect number of neighbours eastids: "
+	<<eastids.size();
+    }
+
+
+    switch( westids.size() ) {
+    case 0:
+      break;
+    case 1:
+      west = westids[0];
+      northwest = getNorth(west, topology);
+      southwest = getSouth(west, topology);
+      break;
+    case 2:
+      // in this case, 0 is more on the north than 1
+      west = westids[0];
+      west2 = westids[1];
+      northwest = getNorth(west, topology );
+      southwest = getSouth(west2, topology );
+      northwest2 = getNorth(northwest, topology );
+      southwest2 = getSouth(southwest, topology );
+      break;
+    default:
+      throw cms::Exception("PFCaloCellCache")
+	<<"PFCaloCellCacheESProducer::fillCaloTowerNeighbours : incorrect number of neighbours westids: "
+	<<westids.size();
+    }
+
+    // same order as PFCaloCellCache::fourNeighbours
+    const CaloTowerDetId neighbours[14] =
+      { north, northeast, northeast2,
+	south, southwest, southwest2,
+	east, east2, southeast, southeast2,
+	west, west2, northwest, northwest2 };
+
+    // towers outside the topology never hold a rechit
+    unsigned* row = &table[nNeighboursCT*tower];
+    for(unsigned in=0; in<nNeighboursCT; ++in) {
+      if( neighbours[in].null() ||
+	  !topology.valid( neighbours[in] ) ) continue;
+      row[in] = neighbours[in].denseIndex();
+    }
+  }
+}
+
+
+
+// Build the array of (max)8 neighbors
+void
+PFCaloCellCacheESProducer::ecalNeighbArray(
+					   const EcalBarrelGeometry& barrelGeom,
+					   const CaloSubdetectorTopology& barrelTopo,
+					   const EcalEndcapGeometry& endcapGeom,
+					   const CaloSubdetectorTopology& endcapTopo,
+					   vector<unsigned>& table,
+					   vector<unsigned>& crossTable ) const {
+
+  // one row of 8 neighbours per barrel and endcap cell.
+  // There are some holes in the hashedIndex for the EE,
+  // the corresponding rows have no neighbours.
+  table.assign( 8*( EBDetId::kSizeForDenseIndexing +
+		    EEDetId::kSizeForDenseIndexing ),
+		PFCaloCellCache::NOTFOUND );
+  crossTable = table;
+
+  for(unsigned isub=0; isub<2; ++isub) {
+
+    // Barrel first, then endcap
+    const CaloSubdetectorGeometry& geom = isub==0 ?
+      static_cast<const CaloSubdetectorGeometry&>(barrelGeom) :
+      static_cast<const CaloSubdetectorGeometry&>(endcapGeom);
+    const CaloSubdetectorTopology& topo = isub==0 ? barrelTopo : endcapTopo;
+    const EcalSubdetector subdet = isub==0 ? EcalBarrel : EcalEndcap;
+
+    const std::vector<DetId>& vec(geom.getValidDetIds(DetId::Ecal,subdet));
+    unsigned size=vec.size();
+    for(unsigned ic=0; ic<size; ++ic)
+      {
+	unsigned cell=PFCaloCellCache::ecalDenseIndex(vec[ic]);
+	if(8*cell>=table.size())
+	  {
+	    LogDebug("CaloGeometryTools")  << " Array overflow " << std::endl;
+	    continue;
+	  }
+	unsigned* row=&table[8*cell];
+	unsigned* crossRow=&crossTable[8*cell];
+
+	// We get the 9 cells in a square.
+	std::vector<DetId> neighbours(topo.getWindow(vec[ic],3,3));
+	unsigned nneighbours=neighbours.size();
+
+	// If there are 9 cells, it is easy, and this order is know:
+	//      6  7  8
+	//      3  4  5
+	//      0  1  2   (0 = SOUTHWEST)
+
+	if(nneighbours==9)
+	  {
+	    unsigned idir=0;
+	    for(unsigned in=0;in<nneighbours && idir<8;++in)
+	      {
+		// remove the centre
+		if(neighbours[in]!=vec[ic]) {
+		  unsigned entry=rowEntry[idir++];
+		  row[entry]=PFCaloCellCache::ecalDenseIndex(neighbours[in]);
+		  crossRow[entry]=row[entry];
+		}
+	      }
+	  }
+	else
+	  {
+	    // on a border: move in each direction, without and
+	    // with the crossing of the barrel-endcap border
+	    for(unsigned idir=0;idir<8;++idir)
+	      {
+		DetId testid=vec[ic];
+		if(stdmove(testid,orderedDir[idir],
+			   barrelTopo, endcapTopo,
+			   barrelGeom, endcapGeom, false))
+		  row[rowEntry[idir]]=PFCaloCellCache::ecalDenseIndex(testid);
+
+		testid=vec[ic];
+		if(stdmove(testid,orderedDir[idir],
+			   barrelTopo, endcapTopo,
+			   barrelGeom, endcapGeom, true))
+		  crossRow[rowEntry[idir]]=
+		    PFCaloCellCache::ecalDenseIndex(testid);
+	      }
+	  }
+      }
+  }
+}
+
+
+
+bool
+PFCaloCellCacheESProducer::stdsimplemove(DetId& cell,
+					 const CaloDirection& dir,
+					 const CaloSubdetectorTopology& barrelTopo,
+					 const CaloSubdetectorTopology& endcapTopo,
+					 const EcalBarrelGeometry& barrelGeom,
+					 const EcalEndcapGeometry& endcapGeom,
+					 bool crossBarrelEndcapBorder )
+  const {
+
+  std::vector<DetId> neighbours;
+
+  // BARREL CASE
+  if(cell.subdetId()==EcalBarrel) {
+    EBDetId ebDetId = cell;
+
+    neighbours = barrelTopo.getNeighbours(ebDetId,dir);
+
+    // first try to move according to the standard navigation
+    if(neighbours.size()>0 && !neighbours[0].null()) {
+      cell = neighbours[0];
+      return true;
+    }
+
+    // failed.
+
+    if(crossBarrelEndcapBorder) {
+      // are we on the outer ring ?
+      const int ietaAbs ( ebDetId.ietaAbs() ) ; // abs value of ieta
+      if( EBDetId::MAX_IETA == ietaAbs ) {
+	// get ee nbrs for for end of barrel crystals
+
+	// yes we are
+	const EcalBarrelGeometry::OrderedListOfEEDetId&
+	  ol( * barrelGeom.getClosestEndcapCells( ebDetId ) ) ;
+
+	// take closest neighbour on the other side, that is in the barrel.
+	cell = *(ol.begin() );
+	return true;
+      }
+    }
+  }
+
+  // ENDCAP CASE
+  else if(cell.subdetId()==EcalEndcap) {
+
+    EEDetId eeDetId = cell;
+
+    neighbours= endcapTopo.getNeighbours(eeDetId,dir);
+
+    if(neighbours.size()>0 && !neighbours[0].null()) {
+      cell = neighbours[0];
+      return true;
+    }
+
+    // failed.
+
+    if(crossBarrelEndcapBorder) {
+      // are we on the outer ring ?
+      const int iphi ( eeDetId.iPhiOuterRing() ) ;
+      if( iphi!= 0) {
+	// yes we are
+	const EcalEndcapGeometry::OrderedListOfEBDetId&
+	  ol( * endcapGeom.getClosestBarrelCells( eeDetId ) ) ;
+
+	// take closest neighbour on the other side, that is in the barrel.
+	cell = *(ol.begin() );
+	return true;
+      }
+    }
+  }
+
+  // everything failed
+  cell = DetId(0);
+  return false;
+}
+
+
+
+bool
+PFCaloCellCacheESProducer::stdmove(DetId& cell,
+				   const CaloDirection& dir,
+				   const CaloSubdetectorTopology& barrelTopo,
+				   const CaloSubdetectorTopology& endcapTopo,
+				   const EcalBarrelGeometry& barrelGeom,
+				   const EcalEndcapGeometry& endcapGeom,
+				   bool crossBarrelEndcapBorder )
+
+  const {
+
+
+  bool result;
+
+  if(dir==NORTH) {
+    result = stdsimplemove(cell,NORTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+    return result;
+  }
+  else if(dir==SOUTH) {
+    result = stdsimplemove(cell,SOUTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+    return result;
+  }
+  else if(dir==EAST) {
+    result = stdsimplemove(cell,EAST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+    return result;
+  }
+  else if(dir==WEST) {
+    result = stdsimplemove(cell,WEST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+    return result;
+  }
+
+
+  // One has to try both paths
+  else if(dir==NORTHEAST)
+    {
+      result = stdsimplemove(cell,NORTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+      if(result)
+        return stdsimplemove(cell,EAST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+      else
+        {
+          result = stdsimplemove(cell,EAST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+          if(result)
+            return stdsimplemove(cell,NORTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+          else
+            return false;
+        }
+    }
+  else if(dir==NORTHWEST)
+    {
+      result = stdsimplemove(cell,NORTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+      if(result)
+        return stdsimplemove(cell,WEST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+      else
+        {
+          result = stdsimplemove(cell,WEST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+          if(result)
+            return stdsimplemove(cell,NORTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+          else
+            return false;
+        }
+    }
+  else if(dir == SOUTHEAST)
+    {
+      result = stdsimplemove(cell,SOUTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+      if(result)
+        return stdsimplemove(cell,EAST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+      else
+        {
+          result = stdsimplemove(cell,EAST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+          if(result)
+            return stdsimplemove(cell,SOUTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+          else
+            return false;
+        }
+    }
+  else if(dir == SOUTHWEST)
+    {
+      result = stdsimplemove(cell,SOUTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+      if(result)
+        return stdsimplemove(cell,WEST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+      else
+        {
+          result = stdsimplemove(cell,SOUTH, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+          if(result)
+            return stdsimplemove(cell,WEST, barrelTopo, endcapTopo, barrelGeom, endcapGeom, crossBarrelEndcapBorder );
+          else
+            return false;
+        }
+    }
+  cell = DetId(0);
+  return false;
+}
+
+
+
+// Build the HO rows of the array of (max)8 neighbors
+void
+PFCaloCellCacheESProducer::hoNeighbArray(
+					 const CaloSubdetectorGeometry& barrelGeom,
+					 const HcalTopology& barrelTopo,
+					 vector<unsigned>& table ) const {
+
+  const std::vector<DetId>& vec(barrelGeom.getValidDetIds(DetId::Hcal,
+							  HcalOuter));
+  unsigned size=vec.size();
+  for(unsigned ic=0; ic<size; ++ic)
+    {
+      // We get the 9 cells in a square.
+      std::vector<DetId> neighbours(barrelTopo.getWindow(vec[ic],3,3));
+      unsigned nneighbours=neighbours.size();
+
+      unsigned hashedindex=barrelTopo.detId2denseId(vec[ic]);
+      if(8*hashedindex>=table.size())
+	{
+          LogDebug("CaloGeometryTools")  << " Array overflow " << std::endl;
+	  continue;
+	}
+      unsigned* row=&table[8*hashedindex];
+
+
+      // If there are 9 cells, it is easy, and this order is know:
+      //      6  7  8
+      //      3  4  5
+      //      0  1  2   (0 = SOUTHWEST)
+
+      if(nneighbours==9)
+        {
+          unsigned idir=0;
+          for(unsigned in=0;in<nneighbours && idir<8;++in)
+            {
+              // remove the centre
+              if(neighbours[in]!=vec[ic])
+                row[rowEntry[idir++]]=denseIdHO(neighbours[in], barrelTopo);
+            }
+        }
+      else
+        {
+          DetId central(vec[ic]);
+          for(unsigned idir=0;idir<8;++idir)
+            {
+              DetId testid=central;
+              bool status=hoMove(testid,orderedDir[idir], barrelTopo);
+              if(status) row[rowEntry[idir]]=denseIdHO(testid, barrelTopo);
+            }
+        }
+    }
+}
+
+
+
+bool
+PFCaloCellCacheESProducer::hoSimpleMove(DetId& cell,
+					const CaloDirection& dir,
+					const CaloSubdetectorTopology& barrelTopo)
+  const {
+
+  std::vector<DetId> neighbours;
+
+  // BARREL CASE
+  if(cell.subdetId()==HcalOuter) {
+    HcalDetId hoDetId = cell;
+
+    neighbours = barrelTopo.getNeighbours(hoDetId,dir);
+
+    // first try to move according to the standard navigation
+    if(neighbours.size()>0 && !neighbours[0].null()) {
+      cell = neighbours[0];
+      return true;
+    }
+
+    // failed.
+
+
+  }
+
+  // everything failed
+  cell = DetId(0);
+  return false;
+}
+
+
+
+bool
+PFCaloCellCacheESProducer::hoMove(DetId& cell,
+				  const CaloDirection& dir,
+				  const CaloSubdetectorTopology& barrelTopo)
+
+  const {
+
+
+  bool result;
+
+  if(dir==NORTH) {
+    result = hoSimpleMove(cell,NORTH, barrelTopo);
+    return result;
+  }
+  else if(dir==SOUTH) {
+    result = hoSimpleMove(cell,SOUTH, barrelTopo);
+    return result;
+  }
+  else if(dir==EAST) {
+    result = hoSimpleMove(cell,EAST, barrelTopo);
+    return result;
+  }
+  else if(dir==WEST) {
+    result = hoSimpleMove(cell,WEST, barrelTopo);
+    return result;
+  }
+
+
+  // One has to try both paths
+  else if(dir==NORTHEAST)
+    {
+      result = hoSimpleMove(cell,NORTH, barrelTopo);
+      if(result)
+        return hoSimpleMove(cell,EAST, barrelTopo);
+      else
+        {
+          result = hoSimpleMove(cell,EAST, barrelTopo);
+          if(result)
+            return hoSimpleMove(cell,NORTH, barrelTopo);
+          else
+            return false;
+        }
+    }
+  else if(dir==NORTHWEST)
+    {
+      result = hoSimpleMove(cell,NORTH, barrelTopo );
+      if(result)
+        return hoSimpleMove(cell,WEST, barrelTopo );
+      else
+        {
+          result = hoSimpleMove(cell,WEST, barrelTopo );
+          if(result)
+            return hoSimpleMove(cell,NORTH, barrelTopo );
+          else
+            return false;
+        }
+    }
+  else if(dir == SOUTHEAST)
+    {
+      result = hoSimpleMove(cell,SOUTH, barrelTopo );
+      if(result)
+        return hoSimpleMove(cell,EAST, barrelTopo );
+      else
+        {
+          result = hoSimpleMove(cell,EAST, barrelTopo );
+          if(result)
+            return hoSimpleMove(cell,SOUTH, barrelTopo );
+          else
+            return false;
+        }
+    }
+  else if(dir == SOUTHWEST)
+    {
+      result = hoSimpleMove(cell,SOUTH, barrelTopo );
+      if(result)
+        return hoSimpleMove(cell,WEST, barrelTopo );
+      else
+        {
+          result = hoSimpleMove(cell,SOUTH, barrelTopo );
+          if(result)
+            return hoSimpleMove(cell,WEST, barrelTopo );
+          else
+            return false;
+        }
+    }
+  cell = DetId(0);
+  return false;
+}
+
+
+
+DetId
+PFCaloCellCacheESProducer::getSouth(const DetId& id,
+				    const CaloSubdetectorTopology& topology) {
+
+  DetId south;
+  vector<DetId> sids = topology.south(id);
+  if(sids.size() == 1)
+    south = sids[0];
+
+  return south;
+}
+
+
+
+DetId
+PFCaloCellCacheESProducer::getNorth(const DetId& id,
+				    const CaloSubdetectorTopology& topology) {
+
+  DetId north;
+  vector<DetId> nids = topology.north(id);
+  if(nids.size() == 1)
+    north = nids[0];
+
+  return north;
+}
@@ -0,0 +1,122 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFCaloCellCacheESProducer_h_
+#define RecoParticleFlow_PFClusterProducer_PFCaloCellCacheESProducer_h_
+
+// system include files
+#include <memory>
+#include <string>
+#include <vector>
+
+// user include files
+#include "FWCore/Framework/interface/ESProducer.h"
+#include "FWCore/Framework/interface/ESHandle.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "Geometry/Records/interface/CaloGeometryRecord.h"
+#include "Geometry/CaloTopology/interface/CaloDirection.h"
+
+#include "RecoParticleFlow/PFClusterProducer/interface/PFCaloCellCache.h"
+
+/**\class PFCaloCellCacheESProducer
+\brief Makes the PFCaloCellCache of the current geometry, shared by
+all the PFRecHit producers
+
+The neighbour tables of the ECAL, HCAL and PS parts can be cached
+between jobs in local files, named after the untracked
+neighbourCacheFile parameter followed by the part (e.g. ".ECAL").
+*/
+
+class CaloGeometry;
+class CaloSubdetectorGeometry;
+class CaloSubdetectorTopology;
+class EcalBarrelGeometry;
+class EcalEndcapGeometry;
+class HcalTopology;
+class DetId;
+
+class PFCaloCellCacheESProducer : public edm::ESProducer {
+ public:
+  explicit PFCaloCellCacheESProducer(const edm::ParameterSet&);
+  ~PFCaloCellCacheESProducer();
+
+  std::auto_ptr<PFCaloCellCache> produce(const CaloGeometryRecord& record);
+
+ private:
+
+  /// fill the cell geometry of a subdetector, by dense index
+  template<class Index>
+    void fillCells( std::vector<PFCaloCellCache::Cell>& cells,
+		    const CaloSubdetectorGeometry& geom,
+		    int det, int subdet,
+		    Index denseIndex ) const;
+
+  /// fill the two ECAL tables, from the cache file if possible
+  void fillEcalNeighbours( const edm::ESHandle<CaloGeometry>& geoHandle,
+			   PFCaloCellCache& cache ) const;
+
+  /// fill the HB, HE and HO rows of the HCAL table, from the
+  /// cache file if possible. hoGeom may be 0
+  void fillHcalNeighbours( const CaloSubdetectorGeometry* hoGeom,
+			   const HcalTopology& topology,
+			   PFCaloCellCache& cache ) const;
+
+  /// fill the PS table, from the cache file if possible
+  void fillPSNeighbours( const edm::ESHandle<CaloGeometry>& geoHandle,
+			 const CaloSubdetectorGeometry& psGeom,
+			 PFCaloCellCache& cache ) const;
+
+  /// fill the CaloTower table
+  void fillCaloTowerNeighbours( PFCaloCellCache& cache ) const;
+
+  /// \return the name of the cache file of a part,
+  /// empty if there is no caching
+  std::string cacheFile( const char* part ) const;
+
+  /// fill the ECAL tables, without and with the crossing 
+  /// of the barrel-endcap border
+  void ecalNeighbArray( const EcalBarrelGeometry& barrelGeom,
+			const CaloSubdetectorTopology& barrelTopo,
+			const EcalEndcapGeometry& endcapGeom,
+			const CaloSubdetectorTopology& endcapTopo,
+			std::vector<unsigned>& table,
+			std::vector<unsigned>& crossTable ) const;
+
+  bool stdsimplemove(DetId& cell,
+		     const CaloDirection& dir,
+		     const CaloSubdetectorTopology& barrelTopo,
+		     const CaloSubdetectorTopology& endcapTopo,
+		     const EcalBarrelGeometry& barrelGeom,
+		     const EcalEndcapGeometry& endcapGeom,
+		     bool crossBarrelEndcapBorder ) const;
+
+  bool stdmove(DetId& cell,
+	       const CaloDirection& dir,
+	       const CaloSubdetectorTopology& barrelTopo,
+	       const CaloSubdetectorTopology& endcapTopo,
+	       const EcalBarrelGeometry& barrelGeom,
+	       const EcalEndcapGeometry& endcapGeom,
+	       bool crossBarrelEndcapBorder ) const;
+
+  /// fill the HO rows of the HCAL table
+  void hoNeighbArray( const CaloSubdetectorGeometry& barrelGeom,
+		      const HcalTopology& barrelTopo,
+		      std::vector<unsigned>& table ) const;
+
+  bool hoSimpleMove(DetId& cell,
+		    const CaloDirection& dir,
+		    const CaloSubdetectorTopology& barrelTopo ) const;
+
+  bool hoMove(DetId& cell,
+	      const CaloDirection& dir,
+	      const CaloSubdetectorTopology& barrelTopo ) const;
+
+  static DetId getNorth(const DetId& id, const CaloSubdetectorTopology& topology);
+  static DetId getSouth(const DetId& id, const CaloSubdetectorTopology& topology);
+
+  // ----------member data ---------------------------
+
+  /// prefix of the files in which the neighbour tables are cached
+  /// between jobs. no caching if empty
+  std::string  neighbourCacheFile_;
+};
+
+#endif
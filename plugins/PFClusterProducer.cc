@@ -11,10 +11,20 @@
 #include "FWCore/Framework/interface/ESHandle.h"
 #include "FWCore/Framework/interface/EventSetup.h"
 
+#include "Geometry/CaloGeometry/interface/CaloGeometry.h"
+#include "Geometry/CaloGeometry/interface/CaloSubdetectorGeometry.h"
+#include "Geometry/CaloGeometry/interface/CaloCellGeometry.h"
+
+#include "DataFormats/EcalDetId/interface/EBDetId.h"
+#include "DataFormats/EcalDetId/interface/EEDetId.h"
+#include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+#include "DataFormats/Math/interface/Point3D.h"
+
 using namespace std;
 using namespace edm;
 
 PFClusterProducer::PFClusterProducer(const edm::ParameterSet& iConfig)
+  : regions_( iConfig )
 {
     
   verbose_ = 
@@ -23,6 +33,33 @@ PFClusterProducer::PFClusterProducer(const edm::ParameterSet& iConfig)
 
 
   // parameters for clustering
+  configure( clusterAlgo_, iConfig );
+
+
+  // access to the collections of rechits from the various detectors:
+
+  
+  inputTagPFRecHits_ = 
+    iConfig.getParameter<InputTag>("PFRecHits");
+  //---ab
+
+  //inputTagClusterCollectionName_ =  iConfig.getParameter<string>("PFClusterCollectionName");    
+ 
+  // produces<reco::PFClusterCollection>(inputTagClusterCollectionName_);
+   produces<reco::PFClusterCollection>();
+   produces<reco::PFRecHitCollection>("Cleaned");
+
+    //---ab
+}
+
+
+
+PFClusterProducer::~PFClusterProducer() {}
+
+
+
+void PFClusterProducer::configure(PFClusterAlgo& algo, 
+				  const edm::ParameterSet& iConfig) {
   
   double threshBarrel = 
     iConfig.getParameter<double>("thresh_Barrel");
@@ -82,40 +119,40 @@ PFClusterProducer::PFClusterProducer(const edm::ParameterSet& iConfig)
     iConfig.getParameter<bool>("cleanRBXandHPDs");
 
 
-  clusterAlgo_.setThreshBarrel( threshBarrel );
-  clusterAlgo_.setThreshSeedBarrel( threshSeedBarrel );
+  algo.setThreshBarrel( threshBarrel );
+  algo.setThreshSeedBarrel( threshSeedBarrel );
   
-  clusterAlgo_.setThreshPtBarrel( threshPtBarrel );
-  clusterAlgo_.setThreshPtSeedBarrel( threshPtSeedBarrel );
+  algo.setThreshPtBarrel( threshPtBarrel );
+  algo.setThreshPtSeedBarrel( threshPtSeedBarrel );
   
-  clusterAlgo_.setThreshCleanBarrel(threshCleanBarrel);
-  clusterAlgo_.setS4S1CleanBarrel(minS4S1CleanBarrel);
+  algo.setThreshCleanBarrel(threshCleanBarrel);
+  algo.setS4S1CleanBarrel(minS4S1CleanBarrel);
 
-  clusterAlgo_.setThreshDoubleSpikeBarrel( threshDoubleSpikeBarrel );
-  clusterAlgo_.setS6S2DoubleSpikeBarrel( minS6S2DoubleSpikeBarrel );
+  algo.setThreshDoubleSpikeBarrel( threshDoubleSpikeBarrel );
+  algo.setS6S2DoubleSpikeBarrel( minS6S2DoubleSpikeBarrel );
 
-  clusterAlgo_.setThreshEndcap( threshEndcap );
-  clusterAlgo_.setThreshSeedEndcap( threshSeedEndcap );
+  algo.setThreshEndcap( threshEndcap );
+  algo.setThreshSeedEndcap( threshSeedEndcap );
 
-  clusterAlgo_.setThreshPtEndcap( threshPtEndcap );
-  clusterAlgo_.setThreshPtSeedEndcap( threshPtSeedEndcap );
+  algo.setThreshPtEndcap( threshPtEndcap );
+  algo.setThreshPtSeedEndcap( threshPtSeedEndcap );
 
-  clusterAlgo_.setThreshCleanEndcap(threshCleanEndcap);
-  clusterAlgo_.setS4S1CleanEndcap(minS4S1CleanEndcap);
+  algo.setThreshCleanEndcap(threshCleanEndcap);
+  algo.setS4S1CleanEndcap(minS4S1CleanEndcap);
 
-  clusterAlgo_.setThreshDoubleSpikeEndcap( threshDoubleSpikeEndcap );
-  clusterAlgo_.setS6S2DoubleSpikeEndcap( minS6S2DoubleSpikeEndcap );
+  algo.setThreshDoubleSpikeEndcap( threshDoubleSpikeEndcap );
+  algo.setS6S2DoubleSpikeEndcap( minS6S2DoubleSpikeEndcap );
 
-  clusterAlgo_.setNNeighbours( nNeighbours );
+  algo.setNNeighbours( nNeighbours );
 
   // p1 set to the minimum rechit threshold:
   double posCalcP1 = threshBarrel<threshEndcap ? threshBarrel:threshEndcap;
-  clusterAlgo_.setPosCalcP1( posCalcP1 );
-  clusterAlgo_.setPosCalcNCrystal( posCalcNCrystal );
-  clusterAlgo_.setShowerSigma( showerSigma );
+  algo.setPosCalcP1( posCalcP1 );
+  algo.setPosCalcNCrystal( posCalcNCrystal );
+  algo.setShowerSigma( showerSigma );
 
-  clusterAlgo_.setUseCornerCells( useCornerCells  );
-  clusterAlgo_.setCleanRBXandHPDs( cleanRBXandHPDs);
+  algo.setUseCornerCells( useCornerCells  );
+  algo.setCleanRBXandHPDs( cleanRBXandHPDs);
 
   int dcormode = 
     iConfig.getParameter<int>("depthCor_Mode");
@@ -133,30 +170,10 @@ PFClusterProducer::PFClusterProducer(const edm::ParameterSet& iConfig)
     reco::PFCluster::setDepthCorParameters( dcormode, 
 					    dcora, dcorb, 
 					    dcorap, dcorbp );
-
-
-  // access to the collections of rechits from the various detectors:
-
-  
-  inputTagPFRecHits_ = 
-    iConfig.getParameter<InputTag>("PFRecHits");
-  //---ab
-
-  //inputTagClusterCollectionName_ =  iConfig.getParameter<string>("PFClusterCollectionName");    
- 
-  // produces<reco::PFClusterCollection>(inputTagClusterCollectionName_);
-   produces<reco::PFClusterCollection>();
-   produces<reco::PFRecHitCollection>("Cleaned");
-
-    //---ab
 }
 
 
 
-PFClusterProducer::~PFClusterProducer() {}
-
-
-
 
 void PFClusterProducer::produce(edm::Event& iEvent, 
 				const edm::EventSetup& iSetup) {
@@ -177,6 +194,24 @@ void PFClusterProducer::produce(edm::Event& iEvent,
   }
 
 
+  // distances to the ECAL cracks, computed once per geometry
+  // and only for ECAL rechits
+  if ( !rechitsHandle->empty() ) { 
+    PFLayer::Layer layer = rechitsHandle->front().layer();
+    if ( ( layer == PFLayer::ECAL_BARREL || layer == PFLayer::ECAL_ENDCAP ) && 
+	 geometryWatcher_.check(iSetup) ) 
+      computeCrackDistances(clusterAlgo_, iSetup);
+  }
+
+  // in regional mode, only the rechits in the regions of interest 
+  // can be seeds. the clusters grow over all the rechits, 
+  // those in the margin included
+  if( regions_.active() ) {
+    regions_.fill( iEvent );
+    regions_.mask( *rechitsHandle, mask_ );
+    clusterAlgo_.setSeedMask( mask_ );
+  }
+
   // do clustering
   clusterAlgo_.doClustering( rechitsHandle );
   
@@ -197,3 +232,43 @@ void PFClusterProducer::produce(edm::Event& iEvent,
   
 
 
+
+void PFClusterProducer::computeCrackDistances(PFClusterAlgo& algo, 
+					      const edm::EventSetup& iSetup) {
+
+  edm::ESHandle<CaloGeometry> geoHandle;
+  iSetup.get<CaloGeometryRecord>().get(geoHandle);
+
+  const CaloSubdetectorGeometry* barrelGeom = 
+    geoHandle->getSubdetectorGeometry(DetId::Ecal, EcalBarrel);
+  const CaloSubdetectorGeometry* endcapGeom = 
+    geoHandle->getSubdetectorGeometry(DetId::Ecal, EcalEndcap);
+
+  vector< pair<double,double> > barrel( EBDetId::kSizeForDenseIndexing );
+  vector< pair<double,double> > endcap( EEDetId::kSizeForDenseIndexing );
+
+  // the positions are those of the PFRecHits, i.e. the cell centres
+  const vector<DetId>& barrelIds = barrelGeom->getValidDetIds(DetId::Ecal, EcalBarrel);
+  for ( unsigned i = 0; i < barrelIds.size(); ++i ) { 
+    const CaloCellGeometry* cell = barrelGeom->getGeometry( barrelIds[i] );
+    if ( !cell ) continue;
+    math::XYZPoint position( cell->getPosition().x(),
+			     cell->getPosition().y(),
+			     cell->getPosition().z() );
+    barrel[ EBDetId(barrelIds[i]).hashedIndex() ] = 
+      PFClusterAlgo::dCrack( position.phi(), position.eta() );
+  }
+
+  const vector<DetId>& endcapIds = endcapGeom->getValidDetIds(DetId::Ecal, EcalEndcap);
+  for ( unsigned i = 0; i < endcapIds.size(); ++i ) { 
+    const CaloCellGeometry* cell = endcapGeom->getGeometry( endcapIds[i] );
+    if ( !cell ) continue;
+    math::XYZPoint position( cell->getPosition().x(),
+			     cell->getPosition().y(),
+			     cell->getPosition().z() );
+    endcap[ EEDetId(endcapIds[i]).hashedIndex() ] = 
+      PFClusterAlgo::dCrack( position.phi(), position.eta() );
+  }
+
+  algo.setCrackDistances( barrel, endcap );
+}
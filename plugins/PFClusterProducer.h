@@ -13,11 +13,15 @@
 #include "FWCore/Framework/interface/MakerMacros.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Framework/interface/ESWatcher.h"
+
+#include "Geometry/Records/interface/CaloGeometryRecord.h"
 
 #include "DataFormats/ParticleFlowReco/interface/PFRecHitFwd.h"
 #include "DataFormats/ParticleFlowReco/interface/PFClusterFwd.h"
 
 #include "RecoParticleFlow/PFClusterProducer/interface/PFClusterAlgo.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFEtaPhiRegions.h"
 
 /**\class PFClusterProducer 
 \brief Producer for particle flow  clusters (PFCluster). 
@@ -45,6 +49,14 @@ class PFClusterProducer : public edm::EDProducer {
 
   
   virtual void produce(edm::Event&, const edm::EventSetup&);
+
+  /// set the clustering parameters of algo from iConfig
+  static void configure(PFClusterAlgo& algo, 
+			const edm::ParameterSet& iConfig);
+
+  /// compute the distances to the ECAL cracks for all crystals
+  static void computeCrackDistances(PFClusterAlgo& algo, 
+				    const edm::EventSetup& iSetup);
   
 
  private:
@@ -57,6 +69,15 @@ class PFClusterProducer : public edm::EDProducer {
 
   /// verbose ?
   bool   verbose_;
+
+  /// regions of interest. the whole detector if not configured
+  PFEtaPhiRegions  regions_;
+
+  /// rechits allowed as seeds, in regional mode
+  std::vector<bool>  mask_;
+
+  /// watcher for the geometry of the crack distance tables
+  edm::ESWatcher<CaloGeometryRecord> geometryWatcher_;
   
   // ----------access to event data
   edm::InputTag    inputTagPFRecHits_;
@@ -0,0 +1,87 @@
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFEtaPhiRegions.h"
+
+#include <sstream>
+#include <cmath>
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/Math/interface/deltaPhi.h"
+#include "DataFormats/ParticleFlowReco/interface/PFRecHit.h"
+
+using namespace std;
+using namespace edm;
+
+
+
+PFEtaPhiRegions::PFEtaPhiRegions( const edm::ParameterSet& iConfig ) 
+  : deltaEta_(0.),
+    deltaPhi_(0.) {
+
+  // no regions if regionSeeds is absent or empty
+  if( !iConfig.exists("regionSeeds") ) return;
+  seedTags_ = 
+    iConfig.getParameter< vector<InputTag> >("regionSeeds");
+  if( seedTags_.empty() ) return;
+
+  deltaEta_ = 
+    iConfig.getParameter<double>("regionDeltaEta");
+  deltaPhi_ = 
+    iConfig.getParameter<double>("regionDeltaPhi");
+}
+
+
+
+void PFEtaPhiRegions::fill( const edm::Event& iEvent ) {
+
+  regions_.clear();
+
+  for(unsigned it=0; it<seedTags_.size(); ++it) {
+    Handle< View<reco::Candidate> > seeds;
+    bool found = iEvent.getByLabel( seedTags_[it], seeds );
+    if(!found) {
+      ostringstream err;
+      err<<"could not find region seeds "<<seedTags_[it];
+      LogError("PFEtaPhiRegions")<<err.str()<<endl;
+    
+      throw cms::Exception( "MissingProduct", err.str());
+    }
+
+    for(unsigned is=0; is<seeds->size(); ++is) {
+      Region region;
+      region.eta = (*seeds)[is].eta();
+      region.phi = (*seeds)[is].phi();
+      regions_.push_back( region );
+    }
+  }
+}
+
+
+
+bool PFEtaPhiRegions::containsSlow( double eta, double phi, 
+				    double margin ) const {
+
+  const double maxDEta = deltaEta_ + margin;
+  const double maxDPhi = deltaPhi_ + margin;
+  for(unsigned ir=0; ir<regions_.size(); ++ir) {
+    const Region& region = regions_[ir];
+    if( fabs( eta - region.eta ) > maxDEta ) continue;
+    if( fabs( reco::deltaPhi( phi, double(region.phi) ) ) > maxDPhi ) continue;
+    return true;
+  }
+  return false;
+}
+
+
+
+void PFEtaPhiRegions::mask( const reco::PFRecHitCollection& rechits,
+			    vector<bool>& mask ) const {
+  
+  mask.resize( rechits.size() );
+  for(unsigned i=0; i<rechits.size(); ++i) 
+    mask[i] = contains( rechits[i].positionREP().eta(), 
+			rechits[i].positionREP().phi() );
+}
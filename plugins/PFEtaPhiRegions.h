@@ -0,0 +1,68 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFEtaPhiRegions_h_
+#define RecoParticleFlow_PFClusterProducer_PFEtaPhiRegions_h_
+
+#include <vector>
+
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/InputTag.h"
+
+#include "DataFormats/ParticleFlowReco/interface/PFRecHitFwd.h"
+
+/**\class PFEtaPhiRegions
+\brief Regions of interest in eta and phi, for the regional 
+production of the rechits and clusters
+
+There is a region around each candidate of the regionSeeds 
+collections (edm::View<reco::Candidate>, e.g. L1 extra particles), 
+of half widths regionDeltaEta and regionDeltaPhi. With an empty 
+regionSeeds (the default), the regions cover the whole detector, 
+nothing is rejected, and the half widths are not read.
+*/
+
+class PFEtaPhiRegions {
+ public:
+
+  explicit PFEtaPhiRegions( const edm::ParameterSet& iConfig );
+
+  /// false if the regions cover the whole detector
+  bool active() const { return !seedTags_.empty(); }
+
+  /// get the seeds of the event, throws if a collection is missing
+  void fill( const edm::Event& iEvent );
+
+  /// number of regions in the event
+  unsigned size() const { return regions_.size(); }
+
+  /// \return true if (eta, phi) is in a region enlarged by margin
+  bool contains( double eta, double phi, double margin=0. ) const {
+    if( !active() ) return true;
+    return containsSlow( eta, phi, margin );
+  }
+
+  /// set mask[i] to true for the rechits i in the regions, 
+  /// for PFClusterAlgo::setSeedMask
+  void mask( const reco::PFRecHitCollection& rechits,
+	     std::vector<bool>& mask ) const;
+
+ private:
+
+  bool containsSlow( double eta, double phi, double margin ) const;
+
+  struct Region {
+    float eta;
+    float phi;
+  };
+
+  /// collections of seeds
+  std::vector<edm::InputTag>  seedTags_;
+
+  /// half widths of the regions
+  double  deltaEta_;
+  double  deltaPhi_;
+
+  /// regions of the event
+  std::vector<Region>  regions_;
+};
+
+#endif
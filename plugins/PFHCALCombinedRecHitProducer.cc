@@ -0,0 +1,10 @@
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFHCALCombinedRecHitProducer.h"
+
+
+
+PFHCALCombinedRecHitProducer::PFHCALCombinedRecHitProducer(const edm::ParameterSet& iConfig)
+  : PFRecHitProducerHCAL( iConfig, true, true ) {}
+
+
+
+PFHCALCombinedRecHitProducer::~PFHCALCombinedRecHitProducer() {}
@@ -0,0 +1,21 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFHCALCombinedRecHitProducer_h_
+#define RecoParticleFlow_PFClusterProducer_PFHCALCombinedRecHitProducer_h_
+
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducerHCAL.h"
+
+/**\class PFHCALCombinedRecHitProducer
+\brief Producer of the standard and the dual time HCAL rechits in 
+a single pass over the CaloTowers and HCAL rechits
+
+The standard rechits are put with the labels of PFRecHitProducerHCAL,
+the dual time ones with the labels of PFHCALDualTimeRecHitProducer 
+prefixed by "DualTime".
+*/
+
+class PFHCALCombinedRecHitProducer : public PFRecHitProducerHCAL {
+ public:
+  explicit PFHCALCombinedRecHitProducer(const edm::ParameterSet&);
+  ~PFHCALCombinedRecHitProducer();
+};
+
+#endif
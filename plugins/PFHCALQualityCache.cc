@@ -0,0 +1,69 @@
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFHCALQualityCache.h"
+
+#include "FWCore/Framework/interface/ESHandle.h"
+#include "FWCore/Framework/interface/EventSetup.h"
+#include "RecoLocalCalo/HcalRecAlgos/interface/HcalSeverityLevelComputer.h"
+
+using namespace std;
+
+
+
+PFHCALQualityCache::PFHCALQualityCache() 
+  : levels_( 1 << levelBits ),
+    quality_(0),
+    topology_(0),
+    severityComputer_(0) {}
+
+
+
+void 
+PFHCALQualityCache::update( const edm::EventSetup& es, bool withSeverity ) {
+
+  // check both, to keep the watchers up to date
+  bool qualityChanged = qualityWatcher_.check(es);
+  bool topologyChanged = topologyWatcher_.check(es);
+  if( qualityChanged || topologyChanged ) {
+
+    edm::ESHandle<HcalChannelQuality> hcalChStatus;    
+    es.get<HcalChannelQualityRcd>().get( hcalChStatus );
+    quality_ = hcalChStatus.product();
+
+    edm::ESHandle<HcalTopology> hcalTopology;
+    es.get<IdealGeometryRecord>().get( hcalTopology );
+    topology_ = hcalTopology.product();
+
+    status_.assign( topology_->ncells(), Status() );
+    const vector<DetId> channels = quality_->getAllChannels();
+    for(unsigned ic=0; ic<channels.size(); ++ic) {
+      const DetId& id = channels[ic];
+      if( id.det() != DetId::Hcal || 
+	  id.subdetId() < HcalBarrel || id.subdetId() > HcalForward ) continue;
+      unsigned index = topology_->detId2denseId( id );
+      if( index >= status_.size() ) continue;
+      status_[index].value = quality_->getValues( id )->getValue();
+      status_[index].known = true;
+    }
+  }
+
+  if( withSeverity && severityWatcher_.check(es) ) {
+    edm::ESHandle<HcalSeverityLevelComputer> hcalSevLvlComputerHndl;
+    es.get<HcalSeverityLevelComputerRcd>().get(hcalSevLvlComputerHndl);
+    severityComputer_ = hcalSevLvlComputerHndl.product();
+    levels_.assign( 1 << levelBits, Level() );
+  }
+}
+
+
+
+int 
+PFHCALQualityCache::computeSeverityLevel( const DetId& id, 
+					  uint32_t flags, 
+					  uint32_t status,
+					  Level& level ) const {
+
+  level.flags = flags;
+  level.status = status;
+  level.subdet = id.rawId() >> 25;
+  level.level = severityComputer_->getSeverityLevel( id, flags, status );
+  return level.level;
+}
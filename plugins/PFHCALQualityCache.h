@@ -0,0 +1,113 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFHCALQualityCache_h_
+#define RecoParticleFlow_PFClusterProducer_PFHCALQualityCache_h_
+
+#include <vector>
+#include <stdint.h>
+
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/ESWatcher.h"
+
+#include "CondFormats/HcalObjects/interface/HcalChannelQuality.h"
+#include "CondFormats/DataRecord/interface/HcalChannelQualityRcd.h"
+#include "Geometry/CaloTopology/interface/HcalTopology.h"
+#include "Geometry/Records/interface/IdealGeometryRecord.h"
+#include "RecoLocalCalo/HcalRecAlgos/interface/HcalSeverityLevelComputerRcd.h"
+#include "DataFormats/DetId/interface/DetId.h"
+#include "DataFormats/HcalDetId/interface/HcalSubdetector.h"
+
+class HcalSeverityLevelComputer;
+
+/**\class PFHCALQualityCache
+\brief HCAL channel status words and severity levels, for the
+quality filtering of the HCAL rechits
+
+The status words are copied to an array indexed by HcalTopology
+dense id when the channel quality or the topology changes.
+
+The severity level computer only looks at the subdetector of the
+channel, so the levels are memorized by (subdetector, flag word,
+status word). Within a run the rechits only show a handful of
+combinations: most lookups are a hash and an array load.
+The memo is not thread safe, severityLevel must be called from the
+module thread.
+*/
+
+class PFHCALQualityCache {
+ public:
+
+  PFHCALQualityCache();
+
+  /// reload the status words if the channel quality or the topology
+  /// changed. if withSeverity, also get the severity level computer,
+  /// and forget the memorized levels if it changed
+  void update( const edm::EventSetup& es, bool withSeverity );
+
+  /// \return the status word of an HCAL channel
+  uint32_t status( const DetId& id ) const {
+    if( id.det() == DetId::Hcal &&
+	id.subdetId() >= HcalBarrel && id.subdetId() <= HcalForward ) {
+      unsigned index = topology_->detId2denseId( id );
+      if( index < status_.size() && status_[index].known )
+	return status_[index].value;
+    }
+    // not in the conditions: let the container complain
+    return quality_->getValues( id )->getValue();
+  }
+
+  /// \return the severity level of a channel with these flag and
+  /// status words. update must have been called withSeverity
+  int severityLevel( const DetId& id, uint32_t flags, uint32_t status ) const {
+    unsigned char subdet = id.rawId() >> 25;
+    uint32_t hash =
+      ( flags * 0x9E3779B1u ) ^ ( status * 0x85EBCA77u ) ^ ( subdet * 0xC2B2AE35u );
+    Level& level = levels_[ hash >> ( 32 - levelBits ) ];
+    if( level.subdet == subdet && level.flags == flags &&
+	level.status == status ) return level.level;
+    return computeSeverityLevel( id, flags, status, level );
+  }
+
+ private:
+
+  /// status word of a channel. known is false if the channel is not
+  /// in the conditions
+  struct Status {
+    Status() : value(0), known(false) {}
+    uint32_t value;
+    bool     known;
+  };
+
+  /// a memorized severity level. subdet is the detector and
+  /// subdetector bits of the DetId, noSubdet if the entry is empty
+  struct Level {
+    Level() : flags(0), status(0), subdet(noSubdet), level(0) {}
+    uint32_t       flags;
+    uint32_t       status;
+    unsigned char  subdet;
+    int            level;
+  };
+
+  /// compute a severity level and store it in level
+  int computeSeverityLevel( const DetId& id, uint32_t flags, uint32_t status,
+			    Level& level ) const;
+
+  static const unsigned char noSubdet = 0xFF;
+
+  /// the memo has 2^levelBits entries
+  static const unsigned levelBits = 8;
+
+  /// status words, by HcalTopology dense id
+  std::vector<Status>  status_;
+
+  /// memorized severity levels, direct mapped
+  mutable std::vector<Level>   levels_;
+
+  const HcalChannelQuality*         quality_;
+  const HcalTopology*               topology_;
+  const HcalSeverityLevelComputer*  severityComputer_;
+
+  edm::ESWatcher<HcalChannelQualityRcd>         qualityWatcher_;
+  edm::ESWatcher<IdealGeometryRecord>           topologyWatcher_;
+  edm::ESWatcher<HcalSeverityLevelComputerRcd>  severityWatcher_;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFRecHitClusterProducer_h_
+#define RecoParticleFlow_PFClusterProducer_PFRecHitClusterProducer_h_
+
+// system include files
+#include <memory>
+#include <vector>
+
+// user include files
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/ESWatcher.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+#include "Geometry/Records/interface/CaloGeometryRecord.h"
+
+#include "DataFormats/Common/interface/OrphanHandle.h"
+#include "DataFormats/ParticleFlowReco/interface/PFRecHit.h"
+#include "DataFormats/ParticleFlowReco/interface/PFRecHitFwd.h"
+#include "DataFormats/ParticleFlowReco/interface/PFCluster.h"
+#include "DataFormats/ParticleFlowReco/interface/PFClusterFwd.h"
+#include "DataFormats/ParticleFlowReco/interface/PFLayer.h"
+
+#include "RecoParticleFlow/PFClusterProducer/interface/PFClusterAlgo.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFClusterProducer.h"
+
+/**\class PFRecHitClusterProducer 
+\brief Producer for particle flow rechits and clusters in a single module
+
+Makes the PFRecHits as RecHitProducer does, and clusters them at once 
+with a PFClusterAlgo, configured by the "clustering" PSet as in 
+PFClusterProducer. The rechits are put in the event before the 
+clustering, so that the clusters refer to them: whether they are 
+written out is up to the keep/drop statements of the output module.
+
+Products:
+  - PFClusterCollection: the clusters
+  - PFRecHitCollection "Cleaned": the rechits cleaned by RecHitProducer, 
+    followed by those cleaned by the clustering
+  - PFRecHitCollection: the rechits, with their slim version 
+    if configured
+
+The other products of RecHitProducer, if any (e.g. the HFEM and HFHAD 
+rechits of PFRecHitProducerHCAL) are put in the event as usual.
+*/
+
+template<class RecHitProducer>
+class PFRecHitClusterProducer : public RecHitProducer {
+ public:
+  explicit PFRecHitClusterProducer(const edm::ParameterSet&);
+
+  void produce(edm::Event& iEvent, 
+	       const edm::EventSetup& iSetup) override;
+
+ private:
+
+  // ----------member data ---------------------------
+
+  /// clustering algorithm 
+  PFClusterAlgo    clusterAlgo_;
+
+  /// rechits allowed as seeds, in regional mode
+  std::vector<bool>  mask_;
+
+  /// watcher for the geometry of the crack distance tables
+  edm::ESWatcher<CaloGeometryRecord> geometryWatcher_;
+};
+
+
+
+template<class RecHitProducer>
+PFRecHitClusterProducer<RecHitProducer>::
+PFRecHitClusterProducer(const edm::ParameterSet& iConfig) 
+  : RecHitProducer(iConfig) {
+
+  PFClusterProducer::configure( clusterAlgo_, 
+				iConfig.getParameter<edm::ParameterSet>("clustering") );
+
+  // the rechit collections are declared by RecHitProducer
+  this->template produces<reco::PFClusterCollection>();
+}
+
+
+
+template<class RecHitProducer>
+void PFRecHitClusterProducer<RecHitProducer>::produce(edm::Event& iEvent, 
+						      const edm::EventSetup& iSetup) {
+
+  std::auto_ptr< std::vector<reco::PFRecHit> > recHits( new std::vector<reco::PFRecHit> );
+  std::auto_ptr< std::vector<reco::PFRecHit> > recHitsCleaned( new std::vector<reco::PFRecHit> ); 
+  std::vector<reco::PFRecHit>& rechits = *recHits;
+
+  // fill the rechits (see RecHitProducer)
+  this->makeRecHits( rechits, *recHitsCleaned, iEvent, iSetup );
+
+  // distances to the ECAL cracks, computed once per geometry
+  // and only for ECAL rechits
+  if ( !rechits.empty() ) { 
+    PFLayer::Layer layer = rechits.front().layer();
+    if ( ( layer == PFLayer::ECAL_BARREL || layer == PFLayer::ECAL_ENDCAP ) && 
+	 geometryWatcher_.check(iSetup) ) 
+      PFClusterProducer::computeCrackDistances(clusterAlgo_, iSetup);
+  }
+
+  // in regional mode, the rechits were made with a margin 
+  // around the regions, and only those in the regions can be seeds
+  if( this->regions_.active() ) { 
+    this->regions_.mask( rechits, mask_ );
+    clusterAlgo_.setSeedMask( mask_ );
+  }
+
+  // do clustering. the rechits are put first, 
+  // for the clusters to refer to them permanently
+  this->putRecHitColumns( iEvent, rechits );
+  edm::OrphanHandle<reco::PFRecHitCollection> rechitsHandle = 
+    iEvent.put( recHits );
+  clusterAlgo_.doClustering( rechitsHandle );
+
+  if( this->verbose_ ) {
+    edm::LogInfo("PFRecHitClusterProducer")
+      <<"  clusters --------------------------------- "<<std::endl
+      <<clusterAlgo_<<std::endl;
+  }    
+
+  // get clusters out of the clustering algorithm 
+  // and put them in the event. There is no copy.
+  std::auto_ptr< std::vector<reco::PFCluster> > outClusters( clusterAlgo_.clusters() ); 
+  const std::vector<reco::PFRecHit>& clusterCleaned = *clusterAlgo_.rechitsCleaned();
+  recHitsCleaned->insert( recHitsCleaned->end(), 
+			  clusterCleaned.begin(), clusterCleaned.end() );
+
+  iEvent.put( outClusters );    
+  iEvent.put( recHitsCleaned, "Cleaned" );    
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFRecHitDenseIndex_h_
+#define RecoParticleFlow_PFClusterProducer_PFRecHitDenseIndex_h_
+
+#include <vector>
+
+/**\class PFRecHitDenseIndex 
+\brief Dense map from a cell index (e.g. a hashed index) to the index 
+of the corresponding rechit in the PFRecHit collection.
+
+It replaces a std::map<unsigned,unsigned> filled at each event. 
+The array is allocated once, and a generation counter invalidates 
+all entries at the beginning of each event in constant time.
+*/
+
+class PFRecHitDenseIndex {
+ public:
+
+  /// value returned for cells without rechit
+  static const unsigned NOTFOUND = 0xFFFFFFFF;
+
+  PFRecHitDenseIndex() : generation_(1) {}
+
+  /// set the number of cells
+  void resize( unsigned ncells ) { entries_.resize( ncells ); }
+
+  /// number of cells
+  unsigned size() const { return entries_.size(); }
+
+  /// invalidate all entries
+  void newEvent() { 
+    if( ++generation_ == 0 ) {
+      // the counter wrapped around: really clear the entries 
+      for( unsigned i=0; i<entries_.size(); ++i ) entries_[i].generation = 0;
+      generation_ = 1;
+    }
+  }
+
+  /// map cell to rechit index, unless the cell is already mapped 
+  /// in this event (as std::map::insert). \return true if inserted
+  bool insert( unsigned cell, unsigned rechit ) {
+    if( cell >= entries_.size() ) return false;
+    Entry& entry = entries_[cell];
+    if( entry.generation == generation_ ) return false;
+    entry.generation = generation_;
+    entry.rechit = rechit;
+    return true;
+  }
+
+  /// \return the index of the rechit in this cell, or NOTFOUND
+  unsigned find( unsigned cell ) const {
+    if( cell >= entries_.size() ) return NOTFOUND;
+    const Entry& entry = entries_[cell];
+    return entry.generation == generation_ ? entry.rechit : NOTFOUND;
+  }
+
+ private:
+
+  struct Entry {
+    Entry() : generation(0), rechit(NOTFOUND) {}
+    unsigned generation;
+    unsigned rechit;
+  };
+
+  std::vector<Entry> entries_;
+
+  /// current event generation. entries of older generations are empty
+  unsigned generation_;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitNeighbourCache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+#include "Geometry/CaloGeometry/interface/CaloSubdetectorGeometry.h"
+#include "Geometry/CaloGeometry/interface/CaloCellGeometry.h"
+
+using namespace std;
+using namespace edm;
+
+namespace {
+
+  /// "PFNT"
+  const uint32_t cacheMagic = 0x544e4650;
+  /// to be incremented when the file format changes
+  const uint32_t cacheVersion = 2;
+
+  const uint64_t fnvOffset = 14695981039346656037ULL;
+  const uint64_t fnvPrime = 1099511628211ULL;
+
+  inline uint32_t floatBits( float value ) {
+    uint32_t bits;
+    memcpy( &bits, &value, sizeof(bits) );
+    return bits;
+  }
+
+  /// FNV-1a hash of the table, written after it
+  uint64_t tableChecksum( const vector<uint32_t>& table ) {
+    uint64_t hash = fnvOffset;
+    for(unsigned i=0; i<table.size(); ++i) 
+      for(unsigned ib=0; ib<4; ++ib) {
+	hash ^= ( table[i] >> (8*ib) ) & 0xff;
+	hash *= fnvPrime;
+      }
+    return hash;
+  }
+}
+
+
+
+PFRecHitNeighbourCache::PFRecHitNeighbourCache( const string& fileName )
+  : fileName_( fileName ),
+    checksum_( fnvOffset ) {}
+
+
+
+void
+PFRecHitNeighbourCache::add( uint32_t value ) {
+
+  for(unsigned ib=0; ib<4; ++ib) {
+    checksum_ ^= ( value >> (8*ib) ) & 0xff;
+    checksum_ *= fnvPrime;
+  }
+}
+
+
+
+void
+PFRecHitNeighbourCache::addGeometry( const CaloSubdetectorGeometry& geom,
+				     DetId::Detector det, int subdet ) {
+
+  const vector<DetId>& cells = geom.getValidDetIds( det, subdet );
+  add( cells.size() );
+  for(unsigned ic=0; ic<cells.size(); ++ic) {
+    add( cells[ic].rawId() );
+    const CaloCellGeometry* cell = geom.getGeometry( cells[ic] );
+    if( !cell ) continue;
+    add( floatBits( cell->getPosition().x() ) );
+    add( floatBits( cell->getPosition().y() ) );
+    add( floatBits( cell->getPosition().z() ) );
+  }
+}
+
+
+
+bool
+PFRecHitNeighbourCache::read( vector<unsigned>& table,
+			      unsigned size ) const {
+
+  if( !enabled() ) return false;
+
+  ifstream in( fileName_.c_str(), ios::binary );
+  if( !in ) return false;
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t checksum = 0;
+  uint64_t fileSize = 0;
+  in.read( reinterpret_cast<char*>(&magic), sizeof(magic) );
+  in.read( reinterpret_cast<char*>(&version), sizeof(version) );
+  in.read( reinterpret_cast<char*>(&checksum), sizeof(checksum) );
+  in.read( reinterpret_cast<char*>(&fileSize), sizeof(fileSize) );
+
+  if( !in || magic != cacheMagic || version != cacheVersion ||
+      checksum != checksum_ || fileSize != size ) {
+    LogInfo("PFRecHitNeighbourCache")
+      <<"neighbour cache "<<fileName_
+      <<" does not match the geometry, rebuilding"<<endl;
+    return false;
+  }
+
+  vector<uint32_t> buffer( size );
+  uint64_t contentChecksum = 0;
+  in.read( reinterpret_cast<char*>( size ? &buffer[0] : 0 ),
+	   size*sizeof(uint32_t) );
+  in.read( reinterpret_cast<char*>(&contentChecksum), sizeof(contentChecksum) );
+  if( !in ) {
+    LogWarning("PFRecHitNeighbourCache")
+      <<"neighbour cache "<<fileName_<<" is truncated, rebuilding"<<endl;
+    return false;
+  }
+
+  // nothing may follow the table, and it must not be corrupted
+  in.peek();
+  if( !in.eof() || contentChecksum != tableChecksum( buffer ) ) {
+    LogWarning("PFRecHitNeighbourCache")
+      <<"neighbour cache "<<fileName_<<" is corrupted, rebuilding"<<endl;
+    return false;
+  }
+
+  table.assign( buffer.begin(), buffer.end() );
+  return true;
+}
+
+
+
+bool
+PFRecHitNeighbourCache::write( const vector<unsigned>& table ) const {
+
+  if( !enabled() ) return false;
+
+  // write to a temporary file of a unique name in the same directory, 
+  // then rename it, so that concurrent jobs never read a partial file 
+  // nor write to the same temporary file
+  vector<char> tmpName( fileName_.begin(), fileName_.end() );
+  const char* suffix = ".XXXXXX";
+  tmpName.insert( tmpName.end(), suffix, suffix + strlen(suffix) + 1 );
+  int fd = mkstemp( &tmpName[0] );
+  if( fd < 0 ) {
+    LogWarning("PFRecHitNeighbourCache")
+      <<"could not create a temporary file for neighbour cache "
+      <<fileName_<<endl;
+    return false;
+  }
+  // readable by the other jobs, as a file made by ofstream
+  fchmod( fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+
+  FILE* out = fdopen( fd, "wb" );
+  if( !out ) {
+    close( fd );
+    remove( &tmpName[0] );
+    LogWarning("PFRecHitNeighbourCache")
+      <<"could not write neighbour cache "<<&tmpName[0]<<endl;
+    return false;
+  }
+
+  uint64_t fileSize = table.size();
+  vector<uint32_t> buffer( table.begin(), table.end() );
+  uint64_t contentChecksum = tableChecksum( buffer );
+
+  bool ok = 
+    fwrite( &cacheMagic, sizeof(cacheMagic), 1, out ) == 1 &&
+    fwrite( &cacheVersion, sizeof(cacheVersion), 1, out ) == 1 &&
+    fwrite( &checksum_, sizeof(checksum_), 1, out ) == 1 &&
+    fwrite( &fileSize, sizeof(fileSize), 1, out ) == 1 &&
+    ( buffer.empty() || 
+      fwrite( &buffer[0], sizeof(uint32_t), 
+	      buffer.size(), out ) == buffer.size() ) &&
+    fwrite( &contentChecksum, sizeof(contentChecksum), 1, out ) == 1;
+  ok = ( fclose( out ) == 0 ) && ok;
+
+  if( !ok ) {
+    LogWarning("PFRecHitNeighbourCache")
+      <<"could not write neighbour cache "<<&tmpName[0]<<endl;
+    remove( &tmpName[0] );
+    return false;
+  }
+
+  if( rename( &tmpName[0], fileName_.c_str() ) != 0 ) {
+    LogWarning("PFRecHitNeighbourCache")
+      <<"could not write neighbour cache "<<fileName_<<endl;
+    remove( &tmpName[0] );
+    return false;
+  }
+  return true;
+}
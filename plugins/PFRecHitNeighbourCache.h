@@ -0,0 +1,60 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFRecHitNeighbourCache_h_
+#define RecoParticleFlow_PFClusterProducer_PFRecHitNeighbourCache_h_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "DataFormats/DetId/interface/DetId.h"
+
+class CaloSubdetectorGeometry;
+
+/**\class PFRecHitNeighbourCache
+\brief Local binary file cache for the rechit neighbour tables.
+
+Building the neighbour tables requires a topology navigation for
+each cell, which is slow for short jobs. The table can be written
+to a file, and read back by the following jobs as long as the
+checksum of the geometry (cell ids and positions) and of the
+navigation settings is unchanged.
+
+The file is a local, machine dependent cache: it is rebuilt
+whenever it cannot be read, does not match, or fails the checksum
+of its content. It is written to a unique temporary file renamed
+into place, so that concurrent jobs can share it.
+*/
+
+class PFRecHitNeighbourCache {
+ public:
+
+  /// no caching if fileName is empty
+  explicit PFRecHitNeighbourCache( const std::string& fileName );
+
+  /// is a cache file used ?
+  bool enabled() const { return !fileName_.empty(); }
+
+  /// add the cells of a subdetector, and their positions, to the checksum
+  void addGeometry( const CaloSubdetectorGeometry& geom,
+		    DetId::Detector det, int subdet );
+
+  /// add a value (e.g. a navigation setting) to the checksum
+  void add( uint32_t value );
+
+  uint64_t checksum() const { return checksum_; }
+
+  /// read a table of the given size.
+  /// \return false if the file is missing or does not match
+  bool read( std::vector<unsigned>& table, unsigned size ) const;
+
+  /// write the table. \return false in case of failure
+  bool write( const std::vector<unsigned>& table ) const;
+
+ private:
+
+  std::string fileName_;
+
+  /// FNV-1a hash of everything added so far
+  uint64_t checksum_;
+};
+
+#endif
@@ -1,8 +1,15 @@
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducer.h"
 
 #include <memory>
+#include <utility>
 
 #include "DataFormats/ParticleFlowReco/interface/PFRecHit.h"
+#include "DataFormats/DetId/interface/DetId.h"
+#include "DataFormats/EcalDetId/interface/EBDetId.h"
+#include "DataFormats/EcalDetId/interface/EEDetId.h"
+#include "DataFormats/EcalDetId/interface/ESDetId.h"
+#include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+#include "DataFormats/HcalDetId/interface/HcalDetId.h"
 
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
 #include "FWCore/Framework/interface/ESHandle.h"
@@ -14,17 +21,33 @@
 #include "CondFormats/DataRecord/interface/HcalChannelQualityRcd.h"
 #include "CondFormats/DataRecord/interface/EcalChannelStatusRcd.h"
 #include "Geometry/Records/interface/IdealGeometryRecord.h"
+#include "Geometry/Records/interface/CaloGeometryRecord.h"
 using namespace std;
 using namespace edm;
 
 
 PFRecHitProducer::PFRecHitProducer(const edm::ParameterSet& iConfig)
+  : regions_( iConfig )
 {
 
     
   verbose_ = 
     iConfig.getUntrackedParameter<bool>("verbose",false);
 
+  ecalTowerDeadCode_ = 0;
+
+  cellCache_ = 0;
+
+  // optional, for the configurations written before these settings
+  spatialOrder_ = iConfig.exists("spatialOrder") ? 
+    iConfig.getParameter<bool>("spatialOrder") : false;
+
+  regionMargin_ = iConfig.exists("regionMargin") ? 
+    iConfig.getParameter<double>("regionMargin") : 0.;
+
+  slimPersistence_ = iConfig.exists("slimPersistence") ? 
+    iConfig.getParameter<bool>("slimPersistence") : false;
+
   thresh_Barrel_ = 
     iConfig.getParameter<double>("thresh_Barrel");
   thresh_Endcap_ = 
@@ -34,6 +57,7 @@ PFRecHitProducer::PFRecHitProducer(const edm::ParameterSet& iConfig)
   
   //register products
   produces<reco::PFRecHitCollection>();
+  if( slimPersistence_ ) produces<reco::PFRecHitSlim>();
   produces<reco::PFRecHitCollection>("Cleaned");
   
 }
@@ -47,7 +71,9 @@ void PFRecHitProducer::produce(edm::Event& iEvent,
   auto_ptr< vector<reco::PFRecHit> > recHitsCleaned( new vector<reco::PFRecHit> ); 
   
   // fill the collection of rechits (see child classes)
-  createRecHits( *recHits, *recHitsCleaned, iEvent, iSetup);
+  makeRecHits( *recHits, *recHitsCleaned, iEvent, iSetup);
+
+  putRecHitColumns( iEvent, *recHits );
 
   iEvent.put( recHits );
   iEvent.put( recHitsCleaned, "Cleaned" );
@@ -55,8 +81,215 @@ void PFRecHitProducer::produce(edm::Event& iEvent,
 }
 
 
+
+void PFRecHitProducer::putRecHitColumns(edm::Event& iEvent, 
+					const reco::PFRecHitCollection& rechits) const {
+
+  // the same rechits, without geometry, to be written out
+  if( slimPersistence_ ) {
+    auto_ptr< reco::PFRecHitSlim > recHitsSlim( new reco::PFRecHitSlim );
+    recHitsSlim->fill( rechits );
+    iEvent.put( recHitsSlim );
+  }
+}
+
+
+
+void PFRecHitProducer::makeRecHits(vector<reco::PFRecHit>& rechits,
+				   vector<reco::PFRecHit>& rechitsCleaned,
+				   edm::Event& iEvent, 
+				   const edm::EventSetup& iSetup) {
+
+  if( regions_.active() ) regions_.fill( iEvent );
+
+  createRecHits( rechits, rechitsCleaned, iEvent, iSetup);
+}
+
+
 PFRecHitProducer::~PFRecHitProducer() {}
 
+
+
+reco::PFRecHit& 
+PFRecHitProducer::newRecHit( vector<reco::PFRecHit>& rechits,
+			     unsigned detId, 
+			     PFLayer::Layer layer,
+			     double energy, 
+			     double x, double y, double z,
+			     double ax, double ay, double az ) {
+
+  rechits.emplace_back( detId, layer, energy, x, y, z, ax, ay, az );
+  return rechits.back();
+}
+
+
+
+void 
+PFRecHitProducer::setCorners( reco::PFRecHit& rh, 
+			      const CaloCellGeometry::CornersVec& corners,
+			      double scale, double dz ) {
+
+  assert( corners.size() == 8 );
+
+  rh.setNECorner( scale*corners[0].x(), scale*corners[0].y(), scale*corners[0].z()+dz );
+  rh.setSECorner( scale*corners[1].x(), scale*corners[1].y(), scale*corners[1].z()+dz );
+  rh.setSWCorner( scale*corners[2].x(), scale*corners[2].y(), scale*corners[2].z()+dz );
+  rh.setNWCorner( scale*corners[3].x(), scale*corners[3].y(), scale*corners[3].z()+dz );
+}
+
+
+
+void 
+PFRecHitProducer::setCorners( reco::PFRecHit& rh, 
+			      const float (&corners)[4][3],
+			      double scale, double dz ) {
+
+  rh.setNECorner( scale*corners[0][0], scale*corners[0][1], scale*corners[0][2]+dz );
+  rh.setSECorner( scale*corners[1][0], scale*corners[1][1], scale*corners[1][2]+dz );
+  rh.setSWCorner( scale*corners[2][0], scale*corners[2][1], scale*corners[2][2]+dz );
+  rh.setNWCorner( scale*corners[3][0], scale*corners[3][1], scale*corners[3][2]+dz );
+}
+
+
+
+void 
+PFRecHitProducer::addNeighbours( reco::PFRecHit& rh, 
+				 PFCaloCellCache::Part part, unsigned cell,
+				 const PFRecHitDenseIndex& sortedHits ) const {
+
+  addNeighbours( rh, part, cellCache_->neighbours( part, cell ), sortedHits );
+}
+
+
+
+void 
+PFRecHitProducer::addNeighbours( reco::PFRecHit& rh, 
+				 PFCaloCellCache::Part part, 
+				 const unsigned* row,
+				 const PFRecHitDenseIndex& sortedHits ) const {
+
+  if( !row ) return;
+
+  const unsigned n = PFCaloCellCache::nNeighbours( part );
+  const bool* four = PFCaloCellCache::fourNeighbours( part );
+  for(unsigned in=0; in<n; ++in) {
+    if( row[in] == PFCaloCellCache::NOTFOUND ) continue;
+    unsigned index = sortedHits.find( row[in] );
+    if( index == PFRecHitDenseIndex::NOTFOUND ) continue;
+    if( four[in] ) rh.add4Neighbour( index );
+    else rh.add8Neighbour( index );
+  }
+}
+
+namespace {
+  /// spread the 16 lowest bits of v over the even bits
+  uint32_t spreadBits( uint32_t v ) {
+    v &= 0xFFFF;
+    v = ( v | ( v << 8 ) ) & 0x00FF00FF;
+    v = ( v | ( v << 4 ) ) & 0x0F0F0F0F;
+    v = ( v | ( v << 2 ) ) & 0x33333333;
+    v = ( v | ( v << 1 ) ) & 0x55555555;
+    return v;
+  }
+}
+
+
+
+uint64_t 
+PFRecHitProducer::spatialKey( unsigned detId ) {
+
+  const DetId id( detId );
+
+  // subdetector and side, coordinates on the curve, and depth
+  uint32_t part = ( id.det() << 3 ) | id.subdetId();
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t depth = 0;
+  
+  switch( id.det() ) {
+  case DetId::Ecal:
+    switch( id.subdetId() ) {
+    case EcalBarrel: {
+      EBDetId eb( id );
+      x = eb.ieta() + 128;
+      y = eb.iphi();
+      break;
+    }
+    case EcalEndcap: {
+      EEDetId ee( id );
+      part = ( part << 1 ) | ( ee.zside() > 0 );
+      x = ee.ix();
+      y = ee.iy();
+      break;
+    }
+    case EcalPreshower: {
+      ESDetId es( id );
+      part = ( part << 2 ) | ( ( es.plane() - 1 ) << 1 ) | ( es.zside() > 0 );
+      x = es.six();
+      y = es.siy();
+      depth = es.strip();
+      break;
+    }
+    default:
+      break;
+    }
+    break;
+  case DetId::Hcal: {
+    HcalDetId hcal( id );
+    x = hcal.ieta() + 128;
+    y = hcal.iphi();
+    depth = hcal.depth();
+    break;
+  }
+  case DetId::Calo: 
+    if( id.subdetId() == CaloTowerDetId::SubdetId ) {
+      CaloTowerDetId ct( id );
+      x = ct.ieta() + 128;
+      y = ct.iphi();
+    }
+    break;
+  default:
+    break;
+  }
+
+  uint64_t morton = spreadBits( x ) | ( spreadBits( y ) << 1 );
+  return ( uint64_t( part ) << 48 ) | ( morton << 16 ) | ( depth & 0xFFFF );
+}
+
+
+
+void 
+PFRecHitProducer::sortRecHits( vector<reco::PFRecHit>& rechits ) const {
+  vector<unsigned> newIndex;
+  reorderRecHits( rechits, newIndex );
+}
+
+
+
+bool 
+PFRecHitProducer::reorderRecHits( vector<reco::PFRecHit>& rechits,
+				  vector<unsigned>& newIndex ) const {
+
+  if( !spatialOrder_ ) return false;
+
+  // the rechits of a cell stay in their order
+  const unsigned n = rechits.size();
+  vector< pair<uint64_t, unsigned> > keys( n );
+  for(unsigned i=0; i<n; ++i) 
+    keys[i] = make_pair( spatialKey( rechits[i].detId() ), i );
+  sort( keys.begin(), keys.end() );
+
+  vector<reco::PFRecHit> sorted;
+  sorted.reserve( n );
+  newIndex.resize( n );
+  for(unsigned i=0; i<n; ++i) {
+    sorted.push_back( std::move( rechits[ keys[i].second ] ) );
+    newIndex[ keys[i].second ] = i;
+  }
+  rechits.swap( sorted );
+  return true;
+}
+
 // ------------ method called once each job just before starting event loop  ------------
 void 
 PFRecHitProducer::beginRun(const edm::Run& run,
@@ -85,6 +318,45 @@ PFRecHitProducer::beginRun(const edm::Run& run,
   edm::ESHandle<CaloTowerConstituentsMap> cttopo;
   es.get<IdealGeometryRecord>().get(cttopo);
   theTowerConstituentsMap = cttopo.product();
+
+  edm::ESHandle<PFCaloCellCache> cellCache;
+  es.get<CaloGeometryRecord>().get(cellCache);
+  cellCache_ = cellCache.product();
+}
+
+
+
+void 
+PFRecHitProducer::fillEcalTowerStatus( const edm::EventSetup& es, 
+				       unsigned deadCode ) {
+
+  // both watchers must be updated
+  bool statusChanged = ecalChStatusWatcher_.check(es);
+  bool constituentsChanged = towerConstituentsWatcher_.check(es);
+  if( !statusChanged && !constituentsChanged && 
+      !ecalTowerStatus_.empty() && deadCode == ecalTowerDeadCode_ ) return;
+
+  ecalTowerDeadCode_ = deadCode;
+  ecalTowerStatus_.assign( CaloTowerDetId::kSizeForDenseIndexing, 
+			   EcalTowerStatus() );
+
+  for(unsigned tower=0; tower<ecalTowerStatus_.size(); ++tower) {
+    if( !CaloTowerDetId::validDenseIndex( tower ) ) continue;
+
+    const std::vector<DetId>& allConstituents = 
+      theTowerConstituentsMap->constituentsOf( 
+        CaloTowerDetId::detIdFromDenseIndex( tower ) );
+
+    EcalTowerStatus& status = ecalTowerStatus_[tower];
+    for(unsigned int j=0;j<allConstituents.size();++j) { 
+      if ( allConstituents[j].det()==DetId::Ecal ) { 
+	++status.alive;
+	EcalChannelStatus::const_iterator chIt = theEcalChStatus->find(allConstituents[j]);
+	unsigned int dbStatus = chIt != theEcalChStatus->end() ? chIt->getStatusCode() : 0;
+	if ( dbStatus > deadCode ) ++status.dead;
+      }
+    }
+  }
 }
 
 
@@ -4,6 +4,8 @@
 // system include files
 #include <memory>
 #include <vector>
+#include <algorithm>
+#include <stdint.h>
 
 // user include files
 #include "FWCore/Framework/interface/Frameworkfwd.h"
@@ -13,8 +15,12 @@
 #include "FWCore/Framework/interface/MakerMacros.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Framework/interface/ESWatcher.h"
 
+#include "DataFormats/ParticleFlowReco/interface/PFRecHit.h"
 #include "DataFormats/ParticleFlowReco/interface/PFRecHitFwd.h"
+#include "DataFormats/ParticleFlowReco/interface/PFLayer.h"
+#include "Geometry/CaloGeometry/interface/CaloCellGeometry.h"
 
 // For RecHits calibration wrt 50 GeV pions.
 // #include "CondFormats//HcalObjects/interface/HcalRespCorrs.h"
@@ -22,6 +28,13 @@
 #include "CondFormats/HcalObjects/interface/HcalChannelQuality.h"
 #include "CondFormats/EcalObjects/interface/EcalChannelStatus.h"
 #include "Geometry/CaloTopology/interface/CaloTowerConstituentsMap.h"
+#include "CondFormats/DataRecord/interface/EcalChannelStatusRcd.h"
+#include "Geometry/Records/interface/IdealGeometryRecord.h"
+#include "DataFormats/CaloTowers/interface/CaloTowerDetId.h"
+#include "RecoParticleFlow/PFClusterProducer/interface/PFCaloCellCache.h"
+#include "RecoParticleFlow/PFClusterProducer/interface/PFRecHitSlim.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitDenseIndex.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFEtaPhiRegions.h"
 
 /**\class PFRecHitProducer 
 \brief Base producer for particle flow rechits (PFRecHit) 
@@ -40,6 +53,13 @@ class PFRecHitProducer : public edm::EDProducer {
   void produce(edm::Event& iEvent, 
 	       const edm::EventSetup& iSetup) override;
 
+  /// set the NE, SE, SW and NW corners of a rechit from the corners 
+  /// of its PFCaloCellCache cell, scaled by scale and shifted along z 
+  /// by dz. also used by PFRecHitProducerSlim
+  static void setCorners( reco::PFRecHit& rh, 
+			  const float (&corners)[4][3],
+			  double scale=1., double dz=0. );
+
 
 
  protected:
@@ -52,6 +72,88 @@ class PFRecHitProducer : public edm::EDProducer {
 			     std::vector<reco::PFRecHit>& rechitsCleaned,
 			     edm::Event&, const edm::EventSetup&) = 0;  
 
+  /// get the regions of interest of the event and call createRecHits. 
+  /// also used by the derived producers which override produce 
+  /// (see PFRecHitClusterProducer)
+  void makeRecHits(std::vector<reco::PFRecHit>& rechits,
+		   std::vector<reco::PFRecHit>& rechitsCleaned,
+		   edm::Event& iEvent, const edm::EventSetup& iSetup);
+
+  /// \return true if a rechit should be made for cell, i.e. if 
+  /// it is within regionMargin of a region of interest
+  bool inRegions( const PFCaloCellCache::Cell& cell ) const {
+    return regions_.contains( cell.eta, cell.phi, regionMargin_ );
+  }
+
+  /// put the slim version of the rechits in the event, 
+  /// if configured
+  void putRecHitColumns(edm::Event& iEvent, 
+			const reco::PFRecHitCollection& rechits) const;
+
+  /// construct a rechit in place at the end of rechits. 
+  /// \return the new rechit
+  static reco::PFRecHit& newRecHit( std::vector<reco::PFRecHit>& rechits,
+				    unsigned detId, 
+				    PFLayer::Layer layer,
+				    double energy, 
+				    double x, double y, double z,
+				    double ax=0, double ay=0, double az=0 );
+
+  /// set the NE, SE, SW and NW corners of a rechit from the corners 
+  /// of its cell, scaled by scale and shifted along z by dz
+  static void setCorners( reco::PFRecHit& rh, 
+			  const CaloCellGeometry::CornersVec& corners,
+			  double scale=1., double dz=0. );
+
+  /// add to rh the neighbours of cell found in the rechits, using 
+  /// the neighbour table of part. sortedHits maps the dense index 
+  /// of the cells to the position of their rechit
+  void addNeighbours( reco::PFRecHit& rh, 
+		      PFCaloCellCache::Part part, unsigned cell,
+		      const PFRecHitDenseIndex& sortedHits ) const;
+
+  /// same, with the row of the neighbour table already chosen 
+  /// (e.g. one of the two ECAL tables). nothing added if row is 0
+  void addNeighbours( reco::PFRecHit& rh, 
+		      PFCaloCellCache::Part part, const unsigned* row,
+		      const PFRecHitDenseIndex& sortedHits ) const;
+
+  /// if spatialOrder, sort the rechits along a space-filling curve 
+  /// (see spatialKey), so that neighbouring cells are close in memory. 
+  /// to be called before the navigation
+  void sortRecHits( std::vector<reco::PFRecHit>& rechits ) const;
+
+  /// same, for rechits already inserted in sortedHits 
+  /// with the cell index denseId( detId ): sortedHits is updated
+  template<class DenseId> 
+    void sortRecHits( std::vector<reco::PFRecHit>& rechits, 
+		      PFRecHitDenseIndex& sortedHits, 
+		      DenseId denseId ) const;
+
+  /// key of a cell along a Morton curve in (ieta, iphi), or (ix, iy) 
+  /// in EE and ES, by subdetector and side. The depth, or the ES strip, 
+  /// is in the lowest bits. 
+  static uint64_t spatialKey( unsigned detId );
+
+  /// number of ECAL channels in a CaloTower, and of dead ones
+  struct EcalTowerStatus {
+    EcalTowerStatus() : alive(0), dead(0) {}
+    unsigned short alive;
+    unsigned short dead;
+  };
+
+  /// count the ECAL channels and the dead ECAL channels (status above
+  /// deadCode) of each CaloTower, if the ECAL channel status or the 
+  /// tower constituents changed since the last call
+  void fillEcalTowerStatus( const edm::EventSetup& es, unsigned deadCode );
+
+  /// \return the ECAL channel counts of a CaloTower
+  const EcalTowerStatus& ecalTowerStatus( const CaloTowerDetId& id ) const {
+    static const EcalTowerStatus none;
+    unsigned index = id.denseIndex();
+    return index < ecalTowerStatus_.size() ? ecalTowerStatus_[index] : none;
+  }
+
 
   // ----------member data ---------------------------
   
@@ -59,6 +161,13 @@ class PFRecHitProducer : public edm::EDProducer {
   /// verbose ?
   bool   verbose_;
 
+  /// emit the rechits along a space-filling curve ? false by default
+  bool   spatialOrder_;
+
+  /// also put the rechits in the event as a reco::PFRecHitSlim, to be 
+  /// written out instead of the rechits ? false by default
+  bool   slimPersistence_;
+
   /// rechits with E < threshold will not give rise to a PFRecHit
   double  thresh_Barrel_;
   double  thresh_Endcap_;
@@ -69,6 +178,55 @@ class PFRecHitProducer : public edm::EDProducer {
   const HcalChannelQuality* theHcalChStatus;
   const EcalChannelStatus* theEcalChStatus;
   const CaloTowerConstituentsMap* theTowerConstituentsMap;
+
+  /// cell geometry and neighbour tables, shared by all the producers
+  const PFCaloCellCache* cellCache_;
+
+  /// regions of interest. the whole detector if not configured
+  PFEtaPhiRegions  regions_;
+
+  /// the rechits are made up to this distance in eta and phi 
+  /// from the regions, for the clustering of the region borders. 
+  /// 0 by default
+  double  regionMargin_;
+
+ private:
+
+  /// sort the rechits if spatialOrder_, and set newIndex[i] to the 
+  /// new position of the rechit i. \return false if not sorted
+  bool reorderRecHits( std::vector<reco::PFRecHit>& rechits,
+		       std::vector<unsigned>& newIndex ) const;
+
+  /// ECAL channel counts, by CaloTowerDetId dense index
+  std::vector<EcalTowerStatus>  ecalTowerStatus_;
+
+  /// dead code used to fill ecalTowerStatus_
+  unsigned ecalTowerDeadCode_;
+
+  /// watch the inputs of ecalTowerStatus_
+  edm::ESWatcher<EcalChannelStatusRcd>  ecalChStatusWatcher_;
+  edm::ESWatcher<IdealGeometryRecord>   towerConstituentsWatcher_;
 };
 
+
+
+template<class DenseId> 
+void PFRecHitProducer::sortRecHits( std::vector<reco::PFRecHit>& rechits, 
+				    PFRecHitDenseIndex& sortedHits, 
+				    DenseId denseId ) const {
+
+  std::vector<unsigned> newIndex;
+  if( !reorderRecHits( rechits, newIndex ) ) return;
+
+  // the cells are inserted again in the original order of the 
+  // rechits, for the same rechit to be kept if a cell has several
+  sortedHits.newEvent();
+  for(unsigned i=0; i<newIndex.size(); ++i) {
+    const reco::PFRecHit& rh = rechits[ newIndex[i] ];
+    sortedHits.insert( denseId( rh.detId() ), newIndex[i] );
+  }
+}
+
+
+
 #endif
@@ -14,10 +14,10 @@
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
-#include "Geometry/CaloTopology/interface/CaloDirection.h"
-
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducer.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitDenseIndex.h"
 #include "DataFormats/ParticleFlowReco/interface/PFLayer.h"
+#include "DataFormats/EcalRecHit/interface/EcalRecHitCollections.h"
 
 #include "DataFormats/Math/interface/Vector3D.h"
 /**\class PFRecHitProducerECAL 
@@ -27,10 +27,6 @@
 \date   february 2008
 */
 
-class CaloSubdetectorTopology;
-class CaloSubdetectorGeometry;
-class EcalBarrelGeometry;
-class EcalEndcapGeometry;
 class CaloSubdetectorGeometry;
 class DetId;
 
@@ -44,7 +40,6 @@ class PFRecHitProducerECAL : public PFRecHitProducer {
   explicit PFRecHitProducerECAL(const edm::ParameterSet&);
   ~PFRecHitProducerECAL();
 
-  
 
  private:
 
@@ -57,12 +52,24 @@ class PFRecHitProducerECAL : public PFRecHitProducer {
 
   
 
-  reco::PFRecHit*  createEcalRecHit( const DetId& detid,
+  /// get a rechit collection, throws if missing
+  void getRecHits( const edm::Event& iEvent,
+		   const edm::InputTag& tag,
+		   edm::Handle<EcalRecHitCollection>& handle ) const;
+
+  /// translate the barrel or endcap rechits to PFRecHits, 
+  /// appended to rechits or rechitsCleaned
+  void convertRecHits( const EcalRecHitCollection& hits,
+		       PFLayer::Layer layer, 
+		       std::vector<reco::PFRecHit>& rechits,
+		       std::vector<reco::PFRecHit>& rechitsCleaned ) const;
+
+  /// create a rechit at the end of rechits. 
+  /// \return the new rechit, or 0 if the cell geometry is missing
+  reco::PFRecHit*  createEcalRecHit( std::vector<reco::PFRecHit>& rechits,
+				     const DetId& detid,
 				     double energy,
-				     PFLayer::Layer layer,
-				     const CaloSubdetectorGeometry* geom );
-
-
+				     PFLayer::Layer layer ) const;
 
   /// find the position and the axis of the cell for a given rechit
   bool findEcalRecHitGeometry ( const DetId& detid, 
@@ -70,49 +77,16 @@ class PFRecHitProducerECAL : public PFRecHitProducer {
 				math::XYZVector& position, 
 				math::XYZVector& axis );
 
-  /// find rechit neighbours, using the hashed index
+  /// find rechit neighbours, using the PFCaloCellCache table
   void 
     findRecHitNeighboursECAL( reco::PFRecHit& rh, 
-			      const std::map<unsigned,unsigned >& sortedHits );
-
-  /// fill the vectors neighboursEB_ and neighboursEE_ 
-  /// which keep track of the neighbours of each rechit. 
-  /// to be called at the beginning of the run
-  void ecalNeighbArray( const EcalBarrelGeometry& barrelGeom,
-			const CaloSubdetectorTopology& barrelTopo,
-			const EcalEndcapGeometry& endcapGeom,
-			const CaloSubdetectorTopology& endcapTopo );
-
-  DetId move(DetId cell, const CaloDirection& dir ) const;
-
-  bool stdsimplemove(DetId& cell, 
-		     const CaloDirection& dir,
-		     const CaloSubdetectorTopology& barrelTopo,
-		     const CaloSubdetectorTopology& endcapTopo,
-		     const EcalBarrelGeometry& barrelGeom,
-		     const EcalEndcapGeometry& endcapGeom ) const;
-
-
-  bool stdmove(DetId& cell, 
-	       const CaloDirection& dir,
-	       const CaloSubdetectorTopology& barrelTopo,
-	       const CaloSubdetectorTopology& endcapTopo,
-	       const EcalBarrelGeometry& barrelGeom,
-	       const EcalEndcapGeometry& endcapGeom ) const;
+			      const PFRecHitDenseIndex& sortedHits ) const;
 
   // ----------member data ---------------------------
   
-
+  /// index of the rechit in each barrel and endcap cell, for the event
+  PFRecHitDenseIndex  idSortedRecHits_;
  
-  /// for each ecal barrel rechit, keep track of the neighbours
-  std::vector<std::vector<DetId> >  neighboursEB_;
-
-  /// for each ecal endcap rechit, keep track of the neighbours
-  std::vector<std::vector<DetId> >  neighboursEE_;
-  
-  /// set to true in ecalNeighbArray
-  bool  neighbourmapcalculated_;
-
   /// if true, navigation will cross the barrel-endcap border
   bool  crossBarrelEndcapBorder_;
 
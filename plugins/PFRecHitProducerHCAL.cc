@@ -1,4 +1,5 @@
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducerHCAL.h"
+#include "RecoParticleFlow/PFClusterProducer/interface/PFHCALTimeSelection.h"
 
 #include <memory>
 
@@ -27,6 +28,7 @@
 #include "RecoCaloTools/Navigation/interface/CaloNavigator.h"
 
 #include "DataFormats/CaloTowers/interface/CaloTowerCollection.h"
+#include "DataFormats/CaloTowers/interface/CaloTowerDetId.h"
 
 #include "Geometry/CaloTopology/interface/CaloTowerTopology.h"
 #include "RecoCaloTools/Navigation/interface/CaloTowerNavigator.h"
@@ -39,6 +41,13 @@ using namespace std;
 using namespace edm;
 
 PFRecHitProducerHCAL::PFRecHitProducerHCAL(const edm::ParameterSet& iConfig)
+  : PFRecHitProducerHCAL( iConfig, true, false ) {}
+
+
+
+PFRecHitProducerHCAL::PFRecHitProducerHCAL(const edm::ParameterSet& iConfig,
+					   bool produceStandard,
+					   bool produceDualTime)
   : PFRecHitProducer( iConfig )
 {
   // access to the collections of rechits 
@@ -87,29 +96,64 @@ PFRecHitProducerHCAL::PFRecHitProducerHCAL(const edm::ParameterSet& iConfig)
 
   applyTimeDPG_ = iConfig.getParameter<bool>("ApplyTimeDPG");
   applyPulseDPG_ = iConfig.getParameter<bool>("ApplyPulseDPG");
-  HcalMaxAllowedHFLongShortSev_ = iConfig.getParameter<int>("HcalMaxAllowedHFLongShortSev");
-  HcalMaxAllowedHFDigiTimeSev_ = iConfig.getParameter<int>("HcalMaxAllowedHFDigiTimeSev");
-  HcalMaxAllowedHFInTimeWindowSev_ = iConfig.getParameter<int>("HcalMaxAllowedHFInTimeWindowSev");
-  HcalMaxAllowedChannelStatusSev_ = iConfig.getParameter<int>("HcalMaxAllowedChannelStatusSev");
+
+  // the severity levels are only used by the standard rechits
+  HcalMaxAllowedHFLongShortSev_ = 0;
+  HcalMaxAllowedHFDigiTimeSev_ = 0;
+  HcalMaxAllowedHFInTimeWindowSev_ = 0;
+  HcalMaxAllowedChannelStatusSev_ = 0;
+  if( produceStandard ) {
+    HcalMaxAllowedHFLongShortSev_ = iConfig.getParameter<int>("HcalMaxAllowedHFLongShortSev");
+    HcalMaxAllowedHFDigiTimeSev_ = iConfig.getParameter<int>("HcalMaxAllowedHFDigiTimeSev");
+    HcalMaxAllowedHFInTimeWindowSev_ = iConfig.getParameter<int>("HcalMaxAllowedHFInTimeWindowSev");
+    HcalMaxAllowedChannelStatusSev_ = iConfig.getParameter<int>("HcalMaxAllowedChannelStatusSev");
+  }
 
   ECAL_Compensate_ = iConfig.getParameter<bool>("ECAL_Compensate");
   ECAL_Threshold_ = iConfig.getParameter<double>("ECAL_Threshold");
   ECAL_Compensation_ = iConfig.getParameter<double>("ECAL_Compensation");
   ECAL_Dead_Code_ = iConfig.getParameter<unsigned int>("ECAL_Dead_Code");
 
+  hcalTopology_ = 0;
+
   EM_Depth_ = iConfig.getParameter<double>("EM_Depth");
   HAD_Depth_ = iConfig.getParameter<double>("HAD_Depth");
 
+  // the HCAL rechits made from the CaloTowers carry the tower detId, 
+  // from which the cell geometry cannot be rehydrated
+  if( slimPersistence_ ) {
+    string err = "slimPersistence is not supported for the HCAL rechits";
+    LogError("PFRecHitProducerHCAL")<<err<<endl;
+    throw cms::Exception( "Configuration", err );
+  }
+
   //Get integer values of individual HCAL HF flags
   hcalHFLongShortFlagValue_=1<<HcalCaloFlagLabels::HFLongShort;
   hcalHFDigiTimeFlagValue_=1<<HcalCaloFlagLabels::HFDigiTime;
   hcalHFInTimeWindowFlagValue_=1<<HcalCaloFlagLabels::HFInTimeWindow;
 
 
-  //--ab
-  produces<reco::PFRecHitCollection>("HFHAD").setBranchAlias("HFHADRecHits");
-  produces<reco::PFRecHitCollection>("HFEM").setBranchAlias("HFEMRecHits");
-  //--ab
+  flavours_[STANDARD].produced = produceStandard;
+
+  flavours_[DUALTIME].produced = produceDualTime;
+  if( produceDualTime ) 
+    flavours_[DUALTIME].timeSelection.reset( new PFHCALDualTimeSelection( iConfig ) );
+  flavours_[DUALTIME].hfSeverity = false;
+  if( produceStandard ) flavours_[DUALTIME].label = "DualTime";
+
+  for(unsigned f=0; f<NFLAVOURS; ++f) {
+    const FlavourSetup& flavour = flavours_[f];
+    if( !flavour.produced ) continue;
+    // the first flavour uses the collections of PFRecHitProducer
+    if( !flavour.label.empty() ) {
+      produces<reco::PFRecHitCollection>(flavour.label);
+      produces<reco::PFRecHitCollection>(flavour.label+"Cleaned");
+    }
+    //--ab
+    produces<reco::PFRecHitCollection>(flavour.label+"HFHAD").setBranchAlias(flavour.label+"HFHADRecHits");
+    produces<reco::PFRecHitCollection>(flavour.label+"HFEM").setBranchAlias(flavour.label+"HFEMRecHits");
+    //--ab
+  }
 }
 
 
@@ -118,45 +162,59 @@ PFRecHitProducerHCAL::~PFRecHitProducerHCAL() {}
 
 
 
-void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
-					 vector<reco::PFRecHit>& rechitsCleaned,
-					 edm::Event& iEvent, 
-					 const edm::EventSetup& iSetup ) {
+void 
+PFRecHitProducerHCAL::beginRun(const edm::Run& run,
+			       const edm::EventSetup& es) {
 
-  
-  // this map is necessary to find the rechit neighbours efficiently
-  //C but I should think about using Florian's hashed index to do this.
-  //C in which case the map might not be necessary anymore
-  //C however the hashed index does not seem to be implemented for HCAL
-  // 
-  // the key of this map is detId. 
-  // the value is the index in the rechits vector
-  map<unsigned,  unsigned > idSortedRecHits;
-  map<unsigned,  unsigned > idSortedRecHitsHFEM;
-  map<unsigned,  unsigned > idSortedRecHitsHFHAD;
-  typedef map<unsigned, unsigned >::iterator IDH;  
+  PFRecHitProducer::beginRun(run, es);
 
+  // the severity levels are only used by the standard rechits
+  hcalQuality_.update( es, flavours_[STANDARD].produced );
 
-  edm::ESHandle<CaloGeometry> geoHandle;
-  iSetup.get<CaloGeometryRecord>().get(geoHandle);
-  
-  // get the hcalBarrel geometry
-  const CaloSubdetectorGeometry *hcalBarrelGeometry = 
-    geoHandle->getSubdetectorGeometry(DetId::Hcal, HcalBarrel);
+  // the cells are found in the cell cache by HcalTopology dense id
+  edm::ESHandle<HcalTopology> hcalTopology;
+  es.get<IdealGeometryRecord>().get( hcalTopology );
+  hcalTopology_ = hcalTopology.product();
+
+  if( !(inputTagCaloTowers_ == InputTag()) && ECAL_Compensate_ ) 
+    fillEcalTowerStatus( es, ECAL_Dead_Code_ );
+}
 
-  // get the endcap geometry
-  const CaloSubdetectorGeometry *hcalEndcapGeometry = 
-    geoHandle->getSubdetectorGeometry(DetId::Hcal, HcalEndcap);
 
-  // Get Hcal Severity Level Computer, so that the severity of each rechit flag/status may be determined
-  edm::ESHandle<HcalSeverityLevelComputer> hcalSevLvlComputerHndl;
-  iSetup.get<HcalSeverityLevelComputerRcd>().get(hcalSevLvlComputerHndl);
-  const HcalSeverityLevelComputer* hcalSevLvlComputer = hcalSevLvlComputerHndl.product();
 
+void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
+					 vector<reco::PFRecHit>& rechitsCleaned,
+					 edm::Event& iEvent, 
+					 const edm::EventSetup& iSetup ) {
+
+
+  // the output collections of each flavour. 
+  // the first flavour produced is stored in rechits and rechitsCleaned
+  vector<reco::PFRecHit>* flavourRecHits[NFLAVOURS] = {};
+  vector<reco::PFRecHit>* flavourRecHitsCleaned[NFLAVOURS] = {};
+  auto_ptr< vector<reco::PFRecHit> > ownRecHits[NFLAVOURS];
+  auto_ptr< vector<reco::PFRecHit> > ownRecHitsCleaned[NFLAVOURS];
   //--ab
-  auto_ptr< vector<reco::PFRecHit> > HFHADRecHits( new vector<reco::PFRecHit> ); 
-  auto_ptr< vector<reco::PFRecHit> > HFEMRecHits( new vector<reco::PFRecHit> ); 
+  auto_ptr< vector<reco::PFRecHit> > HFHADRecHits[NFLAVOURS];
+  auto_ptr< vector<reco::PFRecHit> > HFEMRecHits[NFLAVOURS];
   //--ab
+  unsigned first = NFLAVOURS;
+  for(unsigned f=0; f<NFLAVOURS; ++f) {
+    if( !flavours_[f].produced ) continue;
+    if( first == NFLAVOURS ) {
+      first = f;
+      flavourRecHits[f] = &rechits;
+      flavourRecHitsCleaned[f] = &rechitsCleaned;
+    }
+    else {
+      ownRecHits[f].reset( new vector<reco::PFRecHit> );
+      ownRecHitsCleaned[f].reset( new vector<reco::PFRecHit> );
+      flavourRecHits[f] = ownRecHits[f].get();
+      flavourRecHitsCleaned[f] = ownRecHitsCleaned[f].get();
+    }
+    HFHADRecHits[f].reset( new vector<reco::PFRecHit> );
+    HFEMRecHits[f].reset( new vector<reco::PFRecHit> );
+  }
 
   // 2 possibilities to make HCAL clustering :
   // - from the HCAL rechits
@@ -173,9 +231,6 @@ void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
   if( !(inputTagCaloTowers_ == InputTag()) ) {
       
     edm::Handle<CaloTowerCollection> caloTowers; 
-    CaloTowerTopology caloTowerTopology; 
-    const CaloSubdetectorGeometry *caloTowerGeometry = 0; 
-    // = geometry_->getSubdetectorGeometry(id)
 
     // get calotowers
     bool found = iEvent.getByLabel(inputTagCaloTowers_,
@@ -223,16 +278,28 @@ void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
 	assert( hbheHandle.isValid() );
       }
       
-      // create rechits
+      // index of the HF rechits, to pair the long and short fibres
+      edm::ESHandle<HcalTopology> hcalTopology;
+      iSetup.get<IdealGeometryRecord>().get( hcalTopology );
+      PFRecHitDenseIndex& idSortedHFRecHits = idSortedHFRecHits_;
+      idSortedHFRecHits.resize( hcalTopology->getHFSize() );
+      idSortedHFRecHits.newEvent();
+      for(unsigned ihf=0; ihf<hfHandle->size(); ++ihf) 
+	idSortedHFRecHits.insert( hcalTopology->detId2denseIdHF( (*hfHandle)[ihf].id() ), 
+				  ihf );
+
+      // the towers giving rechits, and the HF towers to be cleaned. 
+      // they are shared by all the flavours
       typedef CaloTowerCollection::const_iterator ICT;
+      vector<TowerRecHit> towers;
+      towers.reserve( caloTowers->size() );
+      vector<HFTower> hfTowers;
     
       for(ICT ict=caloTowers->begin(); ict!=caloTowers->end();ict++) {
 	  
 	const CaloTower& ct = (*ict);
 	  
 	//C	
-	if(!caloTowerGeometry) 
-	  caloTowerGeometry = geoHandle->getSubdetectorGeometry(ct.id());
 
 	  
 	// get the hadronic energy.
@@ -254,7 +321,6 @@ void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
 	
 	//get the constituents of the tower
 	const std::vector<DetId>& hits = ct.constituents();
-	const std::vector<DetId>& allConstituents = theTowerConstituentsMap->constituentsOf(ct.id());
 
 	/*
 	for(unsigned int i=0;i< hits.size();++i) {
@@ -294,15 +360,11 @@ void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
 	    foundHCALConstituent = true;
 	    detid = hits[i];
 	    // An HCAL tower was found: Look for dead ECAL channels in the same CaloTower.
+	    // The channel counts are computed in beginRun for all towers.
 	    if ( ECAL_Compensate_ && energy > ECAL_Threshold_ ) {
-	      for(unsigned int j=0;j<allConstituents.size();++j) { 
-		if ( allConstituents[j].det()==DetId::Ecal ) { 
-		  alive += 1.;
-		  EcalChannelStatus::const_iterator chIt = theEcalChStatus->find(allConstituents[j]);
-		  unsigned int dbStatus = chIt != theEcalChStatus->end() ? chIt->getStatusCode() : 0;
-		  if ( dbStatus > ECAL_Dead_Code_ ) dead += 1.;
-		}
-	      }
+	      const EcalTowerStatus& ecalStatus = ecalTowerStatus(ct.id());
+	      alive = ecalStatus.alive;
+	      dead = ecalStatus.dead;
 	    } 
 	    // Protection: tower 29 in HF is merged with tower 30. 
 	    // Just take the position of tower 30 in that case. 
@@ -314,655 +376,97 @@ void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
 	// In case of dead ECAL channel, rescale the HCAL energy...
 	double rescaleFactor = alive > 0. ? 1. + ECAL_Compensation_*dead/alive : 1.;
 	  
-	reco::PFRecHit* pfrh = 0;
-	reco::PFRecHit* pfrhCleaned = 0;
-	//---ab: need 2 rechits for the HF:
-	reco::PFRecHit* pfrhHFEM = 0;
-	reco::PFRecHit* pfrhHFHAD = 0;
-	reco::PFRecHit* pfrhHFEMCleaned = 0;
-	reco::PFRecHit* pfrhHFHADCleaned = 0;
-	reco::PFRecHit* pfrhHFEMCleaned29 = 0;
-	reco::PFRecHit* pfrhHFHADCleaned29 = 0;
-
-	if(foundHCALConstituent)
+	if(!foundHCALConstituent) continue;
+
+	// std::cout << ", new Energy = " << energy << std::endl;
+	unsigned hfTower = TowerRecHit::NOHF;
+	switch( detid.subdet() ) {
+	case HcalBarrel: 
 	  {
-	    // std::cout << ", new Energy = " << energy << std::endl;
-	    switch( detid.subdet() ) {
-	    case HcalBarrel: 
-	      {
-		if(energy < thresh_Barrel_ ) continue;
-
-		/*
-		// Check the timing
-		if ( energy > 5. ) { 
-		  for(unsigned int i=0;i< hits.size();++i) {
-		    if( hits[i].det() != DetId::Hcal ) continue; 
-		    HcalDetId theDetId = hits[i]; 
-		    typedef HBHERecHitCollection::const_iterator iHBHE;
-		    iHBHE theHit = hbheHandle->find(theDetId); 
-		    if ( theHit != hbheHandle->end() ) 
-		      std::cout << "HCAL hit : " 
-				<< theDetId.ieta() << " " << theDetId.iphi() << " " 
-				<< theHit->energy() << " " << theHit->time() << std::endl;
-		  }
-		}
-		*/
-
-
-		// if ( HCAL_Calib_ ) energy   *= std::min(max_Calib_,myPFCorr->getValues(detid)->getValue());
-		//if ( rescaleFactor > 1. ) 
-		// std::cout << "Barrel HCAL energy rescaled from = " << energy << " to " << energy*rescaleFactor << std::endl;
-		if ( rescaleFactor > 1. ) { 
-		  pfrhCleaned = createHcalRecHit( detid, 
-						  energy, 
-						  PFLayer::HCAL_BARREL1, 
-						  hcalBarrelGeometry,
-						  ct.id().rawId() );
-		  pfrhCleaned->setRescale(rescaleFactor);
-		  energy *= rescaleFactor;
-		}
-		pfrh = createHcalRecHit( detid, 
-					 energy, 
-				 PFLayer::HCAL_BARREL1, 
-					 hcalBarrelGeometry,
-					 ct.id().rawId() );
-		pfrh->setRescale(rescaleFactor);
-	      }
-	      break;
-	    case HcalEndcap:
-	      {
-		if(energy < thresh_Endcap_ ) continue;
-
-		/*
-		// Check the timing
-		if ( energy > 5. ) { 
-		  for(unsigned int i=0;i< hits.size();++i) {
-		    if( hits[i].det() != DetId::Hcal ) continue; 
-		    HcalDetId theDetId = hits[i]; 
-		    typedef HBHERecHitCollection::const_iterator iHBHE;
-		    iHBHE theHit = hbheHandle->find(theDetId); 
-		    if ( theHit != hbheHandle->end() ) 
-		      std::cout << "HCAL hit : " 
-				<< theDetId.ieta() << " " << theDetId.iphi() << " " 
-				<< theHit->energy() << " " << theHit->time() << std::endl;
-		  }
-		}
-		*/
-
-		// Apply tower 29 calibration
-		if ( HCAL_Calib_ && abs(detid.ieta()) == 29 ) energy *= HCAL_Calib_29;
-		//if ( rescaleFactor > 1. ) 
-		// std::cout << "End-cap HCAL energy rescaled from = " << energy << " to " << energy*rescaleFactor << std::endl;
-		if ( rescaleFactor > 1. ) { 
-		  pfrhCleaned = createHcalRecHit( detid, 
-						  energy, 
-						  PFLayer::HCAL_ENDCAP, 
-						  hcalEndcapGeometry,
-						  ct.id().rawId() );
-		  pfrhCleaned->setRescale(rescaleFactor);
-		  energy *= rescaleFactor;
-		}
-		pfrh = createHcalRecHit( detid, 
-					 energy, 
-					 PFLayer::HCAL_ENDCAP, 
-					 hcalEndcapGeometry,
-					 ct.id().rawId() );
-		pfrh->setRescale(rescaleFactor);
-	      }
-	      break;
-	    case HcalOuter:
-	      {
-	      }
-	      break;
-	    case HcalForward:
-	      {
-		//---ab: 2 rechits for HF:
-		//double energyemHF = weight_HFem_*ct.emEnergy();
-		//double energyhadHF = weight_HFhad_*ct.hadEnergy();
-		double energyemHF = weight_HFem_ * energyEM;
-		double energyhadHF = weight_HFhad_ * energy;
-		// Some energy in the tower !
-		if((energyemHF+energyhadHF) < thresh_HF_ ) continue;
-
-		// Some cleaning in the HF 
-		double longFibre = energyemHF + energyhadHF/2.;
-		double shortFibre = energyhadHF/2.;
-		int ieta = detid.ieta();
-		int iphi = detid.iphi();
-		HcalDetId theLongDetId (HcalForward, ieta, iphi, 1);
-		HcalDetId theShortDetId (HcalForward, ieta, iphi, 2);
-		typedef HFRecHitCollection::const_iterator iHF;
-		iHF theLongHit = hfHandle->find(theLongDetId); 
-		iHF theShortHit = hfHandle->find(theShortDetId); 
-		// 
-		double theLongHitEnergy = 0.;
-		double theShortHitEnergy = 0.;
-		bool flagShortDPG =  false; 
-		bool flagLongDPG = false; 
-		bool flagShortTimeDPG = false; 
-		bool flagLongTimeDPG = false;
-		bool flagShortPulseDPG = false;
-		bool flagLongPulseDPG = false;
-		//
-		if ( theLongHit != hfHandle->end() ) { 
-		  int theLongFlag = theLongHit->flags();
-		  theLongHitEnergy = theLongHit->energy();
-		  flagLongDPG = applyLongShortDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theLongDetId, theLongFlag & hcalHFLongShortFlagValue_, 0)> HcalMaxAllowedHFLongShortSev_);
-		  flagLongTimeDPG = applyTimeDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theLongDetId, theLongFlag & hcalHFInTimeWindowFlagValue_, 0)> HcalMaxAllowedHFInTimeWindowSev_);
-		  flagLongPulseDPG = applyPulseDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theLongDetId, theLongFlag & hcalHFDigiTimeFlagValue_, 0)> HcalMaxAllowedHFDigiTimeSev_);
-
-		  //flagLongDPG =  applyLongShortDPG_ && theLongHit->flagField(HcalCaloFlagLabels::HFLongShort)==1;
-		  //flagLongTimeDPG = applyTimeDPG_ && theLongHit->flagField(HcalCaloFlagLabels::HFInTimeWindow)==1;
-		  //flagLongPulseDPG = applyPulseDPG_ && theLongHit->flagField(HcalCaloFlagLabels::HFDigiTime)==1;
-		}
-		//
-		if ( theShortHit != hfHandle->end() ) { 
-		  int theShortFlag = theShortHit->flags();
-		  theShortHitEnergy = theShortHit->energy();
-		  flagShortDPG = applyLongShortDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theShortDetId, theShortFlag & hcalHFLongShortFlagValue_, 0)> HcalMaxAllowedHFLongShortSev_);
-		  flagShortTimeDPG = applyTimeDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theShortDetId, theShortFlag & hcalHFInTimeWindowFlagValue_, 0)> HcalMaxAllowedHFInTimeWindowSev_);
-		  flagShortPulseDPG = applyPulseDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theShortDetId, theShortFlag & hcalHFDigiTimeFlagValue_, 0)> HcalMaxAllowedHFDigiTimeSev_);
-		  //flagShortDPG =  applyLongShortDPG_ && theShortHit->flagField(HcalCaloFlagLabels::HFLongShort)==1;
-		  //flagShortTimeDPG = applyTimeDPG_ && theShortHit->flagField(HcalCaloFlagLabels::HFInTimeWindow)==1;
-		  //flagShortPulseDPG = applyPulseDPG_ && theShortHit->flagField(HcalCaloFlagLabels::HFDigiTime)==1;
-		}
-
-		// Then check the timing in short and long fibres in all other towers.
-		if ( theShortHitEnergy > longShortFibre_Cut && 
-		     ( theShortHit->time() < minShortTiming_Cut ||
-		       theShortHit->time() > maxShortTiming_Cut || 
-		       flagShortTimeDPG || flagShortPulseDPG ) ) { 
-		  // rescaleFactor = 0. ;
-		  pfrhHFHADCleaned = createHcalRecHit( detid, 
-						       theShortHitEnergy, 
-						       PFLayer::HF_HAD, 
-						       hcalEndcapGeometry,
-						       ct.id().rawId() );
-		  pfrhHFHADCleaned->setRescale(theShortHit->time());
-		  /*
-		  std::cout << "ieta/iphi = " << ieta << " " << iphi 
-			    << ", Energy em/had/long/short = " 
-			    << energyemHF << " " << energyhadHF << " "
-			    << theLongHitEnergy << " " << theShortHitEnergy << " " 
-			    << ". Time = " << theShortHit->time() << " " 
-			    << ". The short and long flags : " 
-			    << flagShortDPG << " " << flagLongDPG << " "  
-			    << flagShortTimeDPG << " " << flagLongTimeDPG << " "  
-			    << flagShortPulseDPG << " " << flagLongPulseDPG << " "  
-			    << ". Short fibres were cleaned." << std::endl;
-		  */
-		  shortFibre -= theShortHitEnergy;
-		  theShortHitEnergy = 0.;
-		}
-		
-		
-		if ( theLongHitEnergy > longShortFibre_Cut && 
-		     ( theLongHit->time() < minLongTiming_Cut ||
-		       theLongHit->time() > maxLongTiming_Cut  || 
-		       flagLongTimeDPG || flagLongPulseDPG ) ) { 
-		  //rescaleFactor = 0. ;
-		  pfrhHFEMCleaned = createHcalRecHit( detid, 
-						      theLongHitEnergy, 
-						      PFLayer::HF_EM, 
-						      hcalEndcapGeometry,
-						      ct.id().rawId() );
-		  pfrhHFEMCleaned->setRescale(theLongHit->time());
-		  /*
-		  std::cout << "ieta/iphi = " << ieta << " " << iphi 
-			    << ", Energy em/had/long/short = " 
-			    << energyemHF << " " << energyhadHF << " "
-			    << theLongHitEnergy << " " << theShortHitEnergy << " " 
-			    << ". Time = " << theLongHit->time() << " " 
-			    << ". The short and long flags : " 
-			    << flagShortDPG << " " << flagLongDPG << " "  
-			    << flagShortTimeDPG << " " << flagLongTimeDPG << " "  
-			    << flagShortPulseDPG << " " << flagLongPulseDPG << " "  
-			    << ". Long fibres were cleaned." << std::endl;
-		  */
-		  longFibre -= theLongHitEnergy;
-		  theLongHitEnergy = 0.;
-		}
-
-		// Some energy must be in the long fibres is there is some energy in the short fibres ! 
-		if ( theShortHitEnergy > shortFibre_Cut && 
-		     ( theLongHitEnergy/theShortHitEnergy < longFibre_Fraction || 
-		       flagShortDPG ) ) {
-		  // Check if the long-fibre hit was not cleaned already (because hot)
-		  // In this case don't apply the cleaning
-		  const HcalChannelStatus* theStatus = theHcalChStatus->getValues(theLongDetId);
-		  unsigned theStatusValue = theStatus->getValue();
-		  int theSeverityLevel = hcalSevLvlComputer->getSeverityLevel(detid, 0, theStatusValue);
-		  // The channel is killed
-		  /// if ( !theStatusValue ) 
-		  if (theSeverityLevel<=HcalMaxAllowedChannelStatusSev_) {
-		    // rescaleFactor = 0. ;
-		    pfrhHFHADCleaned = createHcalRecHit( detid, 
-							 theShortHitEnergy, 
-							 PFLayer::HF_HAD, 
-							 hcalEndcapGeometry,
-							 ct.id().rawId() );
-		    pfrhHFHADCleaned->setRescale(theShortHit->time());
-		    /*
-		    std::cout << "ieta/iphi = " << ieta << " " << iphi 
-			      << ", Energy em/had/long/short = " 
-			      << energyemHF << " " << energyhadHF << " "
-			      << theLongHitEnergy << " " << theShortHitEnergy << " " 
-			      << ". Time = " << theShortHit->time() << " " 
-			      << ". The status value is " << theStatusValue
-			      << ". The short and long flags : " 
-			      << flagShortDPG << " " << flagLongDPG << " "  
-			      << flagShortTimeDPG << " " << flagLongTimeDPG << " "  
-			      << flagShortPulseDPG << " " << flagLongPulseDPG << " "  
-			      << ". Short fibres were cleaned." << std::endl;
-		    */
-		    shortFibre -= theShortHitEnergy;
-		    theShortHitEnergy = 0.;
-		  }
-		}
-
-		if ( theLongHitEnergy > longFibre_Cut && 
-		     ( theShortHitEnergy/theLongHitEnergy < shortFibre_Fraction || 
-		       flagLongDPG ) ) {
-		  // Check if the long-fibre hit was not cleaned already (because hot)
-		  // In this case don't apply the cleaning
-		  const HcalChannelStatus* theStatus = theHcalChStatus->getValues(theShortDetId);
-		  unsigned theStatusValue = theStatus->getValue();
-
-		  int theSeverityLevel = hcalSevLvlComputer->getSeverityLevel(detid, 0, theStatusValue);
-		  // The channel is killed
-		  /// if ( !theStatusValue ) 
-		  if (theSeverityLevel<=HcalMaxAllowedChannelStatusSev_) {
-		    
-		    //rescaleFactor = 0. ;
-		    pfrhHFEMCleaned = createHcalRecHit( detid, 
-						      theLongHitEnergy, 
-						      PFLayer::HF_EM, 
-						      hcalEndcapGeometry,
-						      ct.id().rawId() );
-		    pfrhHFEMCleaned->setRescale(theLongHit->time());
-		    /*
-		    std::cout << "ieta/iphi = " << ieta << " " << iphi 
-			      << ", Energy em/had/long/short = " 
-			      << energyemHF << " " << energyhadHF << " "
-			      << theLongHitEnergy << " " << theShortHitEnergy << " " 
-			      << ". The status value is " << theStatusValue
-			      << ". Time = " << theLongHit->time() << " " 
-			      << ". The short and long flags : " 
-			      << flagShortDPG << " " << flagLongDPG << " "  
-			      << flagShortTimeDPG << " " << flagLongTimeDPG << " "  
-			      << flagShortPulseDPG << " " << flagLongPulseDPG << " "  
-			      << ". Long fibres were cleaned." << std::endl;
-		    */
-		    longFibre -= theLongHitEnergy;
-		    theLongHitEnergy = 0.;
-		  }
-		}
-
-		// Special treatment for tower 29
-		// A tower with energy only at ieta = +/- 29 is not physical -> Clean
-		if ( abs(ieta) == 29 ) { 
-		  // rescaleFactor = 0. ;
-		  // Clean long fibres
-		  if ( theLongHitEnergy > shortFibre_Cut/2. ) { 
-		    pfrhHFEMCleaned29 = createHcalRecHit( detid, 
-							  theLongHitEnergy, 
-							  PFLayer::HF_EM, 
-							  hcalEndcapGeometry,
-							  ct.id().rawId() );
-		    pfrhHFEMCleaned29->setRescale(theLongHit->time());
-		    /*
-		    std::cout << "ieta/iphi = " << ieta << " " << iphi 
-			      << ", Energy em/had/long/short = " 
-			      << energyemHF << " " << energyhadHF << " "
-			      << theLongHitEnergy << " " << theShortHitEnergy << " " 
-			      << ". Long fibres were cleaned." << std::endl;
-		    */
-		    longFibre -= theLongHitEnergy;
-		    theLongHitEnergy = 0.;
-		  }
-		  // Clean short fibres
-		  if ( theShortHitEnergy > shortFibre_Cut/2. ) { 
-		    pfrhHFHADCleaned29 = createHcalRecHit( detid, 
-							   theShortHitEnergy, 
-							   PFLayer::HF_HAD, 
-							   hcalEndcapGeometry,
-							   ct.id().rawId() );
-		    pfrhHFHADCleaned29->setRescale(theShortHit->time());
-		    /*
-		    std::cout << "ieta/iphi = " << ieta << " " << iphi 
-			      << ", Energy em/had/long/short = " 
-			      << energyemHF << " " << energyhadHF << " "
-			      << theLongHitEnergy << " " << theShortHitEnergy << " " 
-			      << ". Short fibres were cleaned." << std::endl;
-		    */
-		    shortFibre -= theShortHitEnergy;
-		    theShortHitEnergy = 0.;
-		  }
-		}
-		// Check the timing of the long and short fibre rechits
-		
-		// First, check the timing of long and short fibre in eta = 29 if tower 30.
-		else if ( abs(ieta) == 30 ) { 
-		  int ieta29 = ieta > 0 ? 29 : -29;
-		  HcalDetId theLongDetId29 (HcalForward, ieta29, iphi, 1);
-		  HcalDetId theShortDetId29 (HcalForward, ieta29, iphi, 2);
-		  iHF theLongHit29 = hfHandle->find(theLongDetId29); 
-		  iHF theShortHit29 = hfHandle->find(theShortDetId29); 
-		  // 
-		  double theLongHitEnergy29 = 0.;
-		  double theShortHitEnergy29 = 0.;
-		  bool flagShortDPG29 =  false; 
-		  bool flagLongDPG29 = false; 
-		  bool flagShortTimeDPG29 = false; 
-		  bool flagLongTimeDPG29 = false;
-		  bool flagShortPulseDPG29 = false;
-		  bool flagLongPulseDPG29 = false;
-		  //
-		  if ( theLongHit29 != hfHandle->end() ) { 
-		    int theLongFlag29 = theLongHit29->flags();
-		    theLongHitEnergy29 = theLongHit29->energy() ;
-		    flagLongDPG29 = applyLongShortDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theLongDetId29, theLongFlag29 & hcalHFLongShortFlagValue_, 0)> HcalMaxAllowedHFLongShortSev_);
-		    flagLongTimeDPG29 = applyTimeDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theLongDetId29, theLongFlag29 & hcalHFInTimeWindowFlagValue_, 0)> HcalMaxAllowedHFInTimeWindowSev_);
-		    flagLongPulseDPG29 = applyPulseDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theLongDetId29, theLongFlag29 & hcalHFDigiTimeFlagValue_, 0)> HcalMaxAllowedHFDigiTimeSev_);
-
-		    //flagLongDPG29 = applyLongShortDPG_ && theLongHit29->flagField(HcalCaloFlagLabels::HFLongShort)==1;
-		    //flagLongTimeDPG29 = applyTimeDPG_ && theLongHit29->flagField(HcalCaloFlagLabels::HFInTimeWindow)==1;
-		    //flagLongPulseDPG29 = applyPulseDPG_ && theLongHit29->flagField(HcalCaloFlagLabels::HFDigiTime)==1;
-		  }
-		  //
-		  if ( theShortHit29 != hfHandle->end() ) { 
-		    int theShortFlag29 = theShortHit29->flags();
-		    theShortHitEnergy29 = theShortHit29->energy();		  
-		    flagShortDPG29 = applyLongShortDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theShortDetId29, theShortFlag29 & hcalHFLongShortFlagValue_, 0)> HcalMaxAllowedHFLongShortSev_);
-		    flagShortTimeDPG29 = applyTimeDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theShortDetId29, theShortFlag29 & hcalHFInTimeWindowFlagValue_, 0)> HcalMaxAllowedHFInTimeWindowSev_);
-		    flagLongPulseDPG29 = applyPulseDPG_ && ( hcalSevLvlComputer->getSeverityLevel(theShortDetId29, theShortFlag29 & hcalHFDigiTimeFlagValue_, 0)> HcalMaxAllowedHFDigiTimeSev_);
-
-		    //flagShortDPG29 = applyLongShortDPG_ && theShortHit29->flagField(HcalCaloFlagLabels::HFLongShort)==1;
-		    //flagShortTimeDPG29 = applyTimeDPG_ && theShortHit29->flagField(HcalCaloFlagLabels::HFInTimeWindow)==1;
-		    //flagShortPulseDPG29 = applyPulseDPG_ && theShortHit29->flagField(HcalCaloFlagLabels::HFDigiTime)==1;
-		  }
-
-		  if ( theLongHitEnergy29 > longShortFibre_Cut && 
-		       ( theLongHit29->time() < minLongTiming_Cut ||
-		         theLongHit29->time() > maxLongTiming_Cut ||
-			 flagLongTimeDPG29 || flagLongPulseDPG29 ) ) { 
-		    //rescaleFactor = 0. ;
-		    pfrhHFEMCleaned29 = createHcalRecHit( detid, 
-							  theLongHitEnergy29, 
-							  PFLayer::HF_EM, 
-							  hcalEndcapGeometry,
-							  ct.id().rawId() );
-		    pfrhHFEMCleaned29->setRescale(theLongHit29->time());
-		    /*
-		    std::cout << "ieta/iphi = " << ieta29 << " " << iphi 
-			      << ", Energy em/had/long/short = " 
-			      << energyemHF << " " << energyhadHF << " "
-			      << theLongHitEnergy29 << " " << theShortHitEnergy29 << " " 
-			      << ". Time = " << theLongHit29->time() << " " 
-			      << ". The short and long flags : " 
-			      << flagShortDPG29 << " " << flagLongDPG29 << " "  
-			      << flagShortTimeDPG29 << " " << flagLongTimeDPG29 << " "  
-			      << flagShortPulseDPG29 << " " << flagLongPulseDPG29 << " "  
-			      << ". Long fibres were cleaned." << std::endl;
-		    */
-		    longFibre -= theLongHitEnergy29;
-		    theLongHitEnergy29 = 0;
-		  }
-
-		  if ( theShortHitEnergy29 > longShortFibre_Cut && 
-		       ( theShortHit29->time() < minShortTiming_Cut ||
-		         theShortHit29->time() > maxShortTiming_Cut ||
-			 flagShortTimeDPG29 || flagShortPulseDPG29 ) ) { 
-		    //rescaleFactor = 0. ;
-		    pfrhHFHADCleaned29 = createHcalRecHit( detid, 
-							 theShortHitEnergy29, 
-							 PFLayer::HF_HAD, 
-							 hcalEndcapGeometry,
-							 ct.id().rawId() );
-		    pfrhHFHADCleaned29->setRescale(theShortHit29->time());
-		    /*
-		    std::cout << "ieta/iphi = " << ieta29 << " " << iphi 
-			      << ", Energy em/had/long/short = " 
-			      << energyemHF << " " << energyhadHF << " "
-			      << theLongHitEnergy29 << " " << theShortHitEnergy29 << " " 
-			      << ". Time = " << theShortHit29->time() << " " 
-			      << ". The short and long flags : " 
-			      << flagShortDPG29 << " " << flagLongDPG29 << " "  
-			      << flagShortTimeDPG29 << " " << flagLongTimeDPG29 << " "  
-			      << flagShortPulseDPG29 << " " << flagLongPulseDPG29 << " "  
-			      << ". Short fibres were cleaned." << std::endl;
-		    */
-		    shortFibre -= theShortHitEnergy29;
-		    theShortHitEnergy29 = 0.;
-		  }
-
-		  // Some energy must be in the long fibres is there is some energy in the short fibres ! 
-		  if ( theShortHitEnergy29 > shortFibre_Cut && 
-		       ( theLongHitEnergy29/theShortHitEnergy29 < 2.*longFibre_Fraction || 
-			 flagShortDPG29 ) ) {
-		    // Check if the long-fibre hit was not cleaned already (because hot)
-		    // In this case don't apply the cleaning
-		    const HcalChannelStatus* theStatus = theHcalChStatus->getValues(theLongDetId29);
-		    unsigned theStatusValue = theStatus->getValue();
-
-		    int theSeverityLevel = hcalSevLvlComputer->getSeverityLevel(detid, 0, theStatusValue);
-		    // The channel is killed
-		    /// if ( !theStatusValue ) 
-		    if (theSeverityLevel<=HcalMaxAllowedChannelStatusSev_) {
-		      //rescaleFactor = 0. ;
-		      pfrhHFHADCleaned29 = createHcalRecHit( detid, 
-							   theShortHitEnergy29, 
-							   PFLayer::HF_HAD, 
-							   hcalEndcapGeometry,
-							   ct.id().rawId() );
-		      pfrhHFHADCleaned29->setRescale(theShortHit29->time());
-		      /*
-		      std::cout << "ieta/iphi = " << ieta29 << " " << iphi 
-				<< ", Energy em/had/long/short = " 
-				<< energyemHF << " " << energyhadHF << " "
-				<< theLongHitEnergy29 << " " << theShortHitEnergy29 << " " 
-				<< ". Time = " << theShortHit29->time() << " " 
-				<< ". The status value is " << theStatusValue
-				<< ". The short and long flags : " 
-				<< flagShortDPG29 << " " << flagLongDPG29 << " "  
-				<< flagShortTimeDPG29 << " " << flagLongTimeDPG29 << " "  
-				<< flagShortPulseDPG29 << " " << flagLongPulseDPG29 << " "  
-				<< ". Short fibres were cleaned." << std::endl;
-		      */
-		      shortFibre -= theShortHitEnergy29;
-		      theShortHitEnergy29 = 0.;
-		    }	    
-		  }
-		  
-		  // Some energy must be in the short fibres is there is some energy in the long fibres ! 
-		  if ( theLongHitEnergy29 > longFibre_Cut && 
-		       ( theShortHitEnergy29/theLongHitEnergy29 < shortFibre_Fraction || 
-			 flagLongDPG29 ) ) {
-		    // Check if the long-fibre hit was not cleaned already (because hot)
-		    // In this case don't apply the cleaning
-		    const HcalChannelStatus* theStatus = theHcalChStatus->getValues(theShortDetId29);
-		    unsigned theStatusValue = theStatus->getValue();
-		    int theSeverityLevel = hcalSevLvlComputer->getSeverityLevel(detid, 0, theStatusValue);
-		    // The channel is killed
-		    /// if ( !theStatusValue ) 
-		    if (theSeverityLevel<=HcalMaxAllowedChannelStatusSev_) {
-
-		      //rescaleFactor = 0. ;
-		      pfrhHFEMCleaned29 = createHcalRecHit( detid, 
-							    theLongHitEnergy29, 
-							    PFLayer::HF_EM, 
-							    hcalEndcapGeometry,
-							    ct.id().rawId() );
-		      pfrhHFEMCleaned29->setRescale(theLongHit29->time());
-		      /* 
-		      std::cout << "ieta/iphi = " << ieta29 << " " << iphi 
-				<< ", Energy em/had/long/short = " 
-				<< energyemHF << " " << energyhadHF << " "
-				<< theLongHitEnergy29 << " " << theShortHitEnergy29 << " " 
-				<< ". The status value is " << theStatusValue
-				<< ". Time = " << theLongHit29->time() << " " 
-				<< ". The short and long flags : " 
-				<< flagShortDPG29 << " " << flagLongDPG29 << " "  
-				<< flagShortTimeDPG29 << " " << flagLongTimeDPG29 << " "  
-				<< flagShortPulseDPG29 << " " << flagLongPulseDPG29 << " "  
-				<< ". Long fibres were cleaned." << std::endl;
-		      */
-		      longFibre -= theLongHitEnergy29;
-		      theLongHitEnergy29 = 0.;
-		    }
-		  }
-
-		  // Check that the energy in tower 29 is smaller than in tower 30
-		  // First in long fibres
-		  if ( theLongHitEnergy29 > std::max(theLongHitEnergy,shortFibre_Cut/2) ) { 
-		    pfrhHFEMCleaned29 = createHcalRecHit( detid, 
-							  theLongHitEnergy29, 
-							  PFLayer::HF_EM, 
-							  hcalEndcapGeometry,
-							  ct.id().rawId() );
-		    pfrhHFEMCleaned29->setRescale(theLongHit29->time());
-		    /*
-		    std::cout << "ieta/iphi = " << ieta29 << " " << iphi 
-			      << ", Energy L29/S29/L30/S30 = " 
-			      << theLongHitEnergy29 << " " << theShortHitEnergy29 << " "
-			      << theLongHitEnergy << " " << theShortHitEnergy << " " 
-			      << ". Long fibres were cleaned." << std::endl;
-		    */
-		    longFibre -= theLongHitEnergy29;
-		    theLongHitEnergy29 = 0.;
-		  }
-		  // Second in short fibres
-		  if ( theShortHitEnergy29 > std::max(theShortHitEnergy,shortFibre_Cut/2.) ) { 
-		    pfrhHFHADCleaned29 = createHcalRecHit( detid, 
-							   theShortHitEnergy29, 
-							   PFLayer::HF_HAD, 
-							   hcalEndcapGeometry,
-							   ct.id().rawId() );
-		    pfrhHFHADCleaned29->setRescale(theShortHit29->time());
-		    /*
-		    std::cout << "ieta/iphi = " << ieta << " " << iphi 
-			      << ", Energy L29/S29/L30/S30 = " 
-			      << theLongHitEnergy29 << " " << theShortHitEnergy29 << " "
-			      << theLongHitEnergy << " " << theShortHitEnergy << " " 
-			      << ". Short fibres were cleaned." << std::endl;
-		    */
-		    shortFibre -= theShortHitEnergy29;
-		    theShortHitEnergy29 = 0.;
-		  }
-		}
-
-
-		// Determine EM and HAD after cleaning of short and long fibres
-		energyhadHF = 2.*shortFibre;
-		energyemHF = longFibre - shortFibre;
-
-		// The EM energy might be negative, as it amounts to Long - Short
-		// In that case, put the EM "energy" in the HAD energy
-		// Just to avoid systematic positive bias due to "Short" high fluctuations
-		if ( energyemHF < thresh_HF_ ) { 
-		  energyhadHF += energyemHF;
-		  energyemHF = 0.;
-		}
-
-		// Apply HCAL calibration factors flor towers close to 29, if requested
-		if ( HF_Calib_ && abs(detid.ieta()) <= 32 ) { 
-		  energyhadHF *= HF_Calib_29;
-		  energyemHF *= HF_Calib_29;
-		}
-				
-		// Create an EM and a HAD rechit if above threshold.
-		if ( energyemHF > thresh_HF_ || energyhadHF > thresh_HF_ ) { 
-		  pfrhHFEM = createHcalRecHit( detid, 
-					       energyemHF, 
-					       PFLayer::HF_EM, 
-					       hcalEndcapGeometry,
-					       ct.id().rawId() );
-		  pfrhHFHAD = createHcalRecHit( detid, 
-						energyhadHF, 
-						PFLayer::HF_HAD, 
-						hcalEndcapGeometry,
-						ct.id().rawId() );
-		  pfrhHFEM->setEnergyUp(energyhadHF);
-		  pfrhHFHAD->setEnergyUp(energyemHF);
-		}
-		
-	      }
-	      break;
-	    default:
-	      LogError("PFRecHitProducerHCAL")
-		<<"CaloTower constituent: unknown layer : "
-		<<detid.subdet()<<endl;
-	    } 
+	    if(energy < thresh_Barrel_ ) continue;
 
-	    if(pfrh) { 
-	      rechits.push_back( *pfrh );
-	      delete pfrh;
-	      idSortedRecHits.insert( make_pair(ct.id().rawId(), 
-						rechits.size()-1 ) ); 
-	    }
-	    if(pfrhCleaned) { 
-	      rechitsCleaned.push_back( *pfrhCleaned );
-	      delete pfrhCleaned;
-	    }
-	    //---ab: 2 rechits for HF:	   
-	    if(pfrhHFEM) { 
-	      HFEMRecHits->push_back( *pfrhHFEM );
-	      delete pfrhHFEM;
-	      idSortedRecHitsHFEM.insert( make_pair(ct.id().rawId(), 
-						HFEMRecHits->size()-1 ) ); 
-	    }
-	    if(pfrhHFHAD) { 
-	      HFHADRecHits->push_back( *pfrhHFHAD );
-	      delete pfrhHFHAD;
-	      idSortedRecHitsHFHAD.insert( make_pair(ct.id().rawId(), 
-						HFHADRecHits->size()-1 ) ); 
-	    }
-	    //---ab	   
-	    if(pfrhHFEMCleaned) { 
-	      rechitsCleaned.push_back( *pfrhHFEMCleaned );
-	      delete pfrhHFEMCleaned;
-	    }
-	    if(pfrhHFHADCleaned) { 
-	      rechitsCleaned.push_back( *pfrhHFHADCleaned );
-	      delete pfrhHFHADCleaned;
-	    }
-	    if(pfrhHFEMCleaned29) { 
-	      rechitsCleaned.push_back( *pfrhHFEMCleaned29 );
-	      delete pfrhHFEMCleaned29;
-	    }
-	    if(pfrhHFHADCleaned29) { 
-	      rechitsCleaned.push_back( *pfrhHFHADCleaned29 );
-	      delete pfrhHFHADCleaned29;
+	    /*
+	    // Check the timing
+	    if ( energy > 5. ) { 
+	      for(unsigned int i=0;i< hits.size();++i) {
+		if( hits[i].det() != DetId::Hcal ) continue; 
+		HcalDetId theDetId = hits[i]; 
+		typedef HBHERecHitCollection::const_iterator iHBHE;
+		iHBHE theHit = hbheHandle->find(theDetId); 
+		if ( theHit != hbheHandle->end() ) 
+		  std::cout << "HCAL hit : " 
+			    << theDetId.ieta() << " " << theDetId.iphi() << " " 
+			    << theHit->energy() << " " << theHit->time() << std::endl;
+	      }
 	    }
+	    */
+
+	    // if ( HCAL_Calib_ ) energy   *= std::min(max_Calib_,myPFCorr->getValues(detid)->getValue());
 	  }
+	  break;
+	case HcalEndcap:
+	  {
+	    if(energy < thresh_Endcap_ ) continue;
+
+	    // Apply tower 29 calibration
+	    if ( HCAL_Calib_ && abs(detid.ieta()) == 29 ) energy *= HCAL_Calib_29;
+	  }
+	  break;
+	case HcalOuter:
+	  continue;
+	case HcalForward:
+	  {
+	    //---ab: 2 rechits for HF:
+	    //double energyemHF = weight_HFem_*ct.emEnergy();
+	    //double energyhadHF = weight_HFhad_*ct.hadEnergy();
+	    double energyemHF = weight_HFem_ * energyEM;
+	    double energyhadHF = weight_HFhad_ * energy;
+	    // Some energy in the tower !
+	    if((energyemHF+energyhadHF) < thresh_HF_ ) continue;
+
+	    // the fibres are cleaned after the loop on the towers
+	    hfTower = hfTowers.size();
+	    hfTowers.push_back( HFTower() );
+	    gatherHFTower( hfTowers.back(), detid, energyemHF, energyhadHF,
+			   *hfHandle, *hcalTopology );
+	  }
+	  break;
+	default:
+	  LogError("PFRecHitProducerHCAL")
+	    <<"CaloTower constituent: unknown layer : "
+	    <<detid.subdet()<<endl;
+	  continue;
+	} 
+
+	towers.push_back( TowerRecHit( ct.id(), detid, energy, 
+				       rescaleFactor, hfTower ) );
       }
-      // do navigation 
-      for(unsigned i=0; i<rechits.size(); i++ ) {
-	findRecHitNeighboursCT( rechits[i], 
-				idSortedRecHits, 
-				caloTowerTopology);
-      }
-      for(unsigned i=0; i<HFEMRecHits->size(); i++ ) {
-	findRecHitNeighboursCT( (*HFEMRecHits)[i], 
-				idSortedRecHitsHFEM, 
-				caloTowerTopology);
-      }
-      for(unsigned i=0; i<HFHADRecHits->size(); i++ ) {
-	findRecHitNeighboursCT( (*HFHADRecHits)[i], 
-				idSortedRecHitsHFHAD, 
-				caloTowerTopology);
+
+
+      // create the rechits of each flavour from the same towers
+      for(unsigned f=0; f<NFLAVOURS; ++f) {
+	if( !flavours_[f].produced ) continue;
+	createCaloTowerRecHits( flavours_[f], towers, hfTowers, 
+				*hbheHandle, *hcalTopology, 
+				*flavourRecHits[f], *flavourRecHitsCleaned[f],
+				*HFEMRecHits[f], *HFHADRecHits[f] );
+	iEvent.put( HFHADRecHits[f], flavours_[f].label+"HFHAD" );	
+	iEvent.put( HFEMRecHits[f], flavours_[f].label+"HFEM" );	
       }
-      iEvent.put( HFHADRecHits,"HFHAD" );	
-      iEvent.put( HFEMRecHits,"HFEM" );	
     }   
   }
   else if( !(inputTagHcalRecHitsHBHE_ == InputTag()) ) { 
     // clustering is not done on CaloTowers but on HCAL rechits.
        
   
-    // get the hcal topology
+    // get the hcal topology, for the dense ids
     edm::ESHandle<HcalTopology> hcalTopology;
     iSetup.get<IdealGeometryRecord>().get( hcalTopology );
+
+    // these rechits are the same for all flavours
+    PFRecHitDenseIndex& idSortedRecHits = flavours_[first].idSortedRecHits;
+    idSortedRecHits.resize( hcalTopology->ncells() );
+    idSortedRecHits.newEvent();
     
     // HCAL rechits 
     //    vector<edm::Handle<HBHERecHitCollection> > hcalHandles;  
@@ -983,6 +487,7 @@ void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
       assert( hcalHandle.isValid() );
       
       const edm::Handle<HBHERecHitCollection>& handle = hcalHandle;
+      rechits.reserve( handle->size() );
       for(unsigned irechit=0; irechit<handle->size(); irechit++) {
 	const HBHERecHit& hit = (*handle)[irechit];
 	
@@ -996,28 +501,25 @@ void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
 	case HcalBarrel:
 	  {
 	    if(energy < thresh_Barrel_ ) continue;
-	    pfrh = createHcalRecHit( detid, 
+	    pfrh = createHcalRecHit( rechits, detid, 
 				     energy, 
-				     PFLayer::HCAL_BARREL1, 
-				     hcalBarrelGeometry );
+				     PFLayer::HCAL_BARREL1 );
  	  }
 	  break;
 	case HcalEndcap:
 	  {
 	    if(energy < thresh_Endcap_ ) continue;
-	    pfrh = createHcalRecHit( detid, 
+	    pfrh = createHcalRecHit( rechits, detid, 
 				     energy, 
-				     PFLayer::HCAL_ENDCAP, 
-				     hcalEndcapGeometry );	  
+				     PFLayer::HCAL_ENDCAP );	  
  	  }
 	  break;
 	case HcalForward:
 	  {
 	    if(energy < thresh_HF_ ) continue;
-	    pfrh = createHcalRecHit( detid, 
+	    pfrh = createHcalRecHit( rechits, detid, 
 				     energy, 
-				     PFLayer::HF_HAD, 
-				     hcalEndcapGeometry );
+				     PFLayer::HF_HAD );
  	  }
 	  break;
 	default:
@@ -1027,25 +529,290 @@ void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
 	} 
 
 	if(pfrh) { 
-	  rechits.push_back( *pfrh );
-	  delete pfrh;
-	  idSortedRecHits.insert( make_pair(detid.rawId(), 
-					    rechits.size()-1 ) ); 
+	  idSortedRecHits.insert( hcalTopology->detId2denseId(detid), 
+				  rechits.size()-1 ); 
 	}
       }
       
       
+      // optionally, along a space-filling curve
+      sortRecHits( rechits, idSortedRecHits, 
+		   [&]( unsigned id ) { 
+		     return hcalTopology->detId2denseId( DetId( id ) ); 
+		   } );
+      
       // do navigation:
-      for(unsigned i=0; i<rechits.size(); i++ ) {
-	
-	findRecHitNeighbours( rechits[i], idSortedRecHits, 
-			      *hcalTopology, 
-			      *hcalBarrelGeometry, 
-			      *hcalTopology,
-			      *hcalEndcapGeometry);
-      } // loop for navigation
+      for(unsigned i=0; i<rechits.size(); i++ ) 
+	findRecHitNeighbours( rechits[i],
+			      hcalTopology->detId2denseId( rechits[i].detId() ),
+			      idSortedRecHits ); // loop for navigation
+
+      // the other flavours get a copy
+      for(unsigned f=first+1; f<NFLAVOURS; ++f) 
+	if( flavours_[f].produced ) *flavourRecHits[f] = rechits;
     }  // endif hcal rechits were found
   } // endif clustering on rechits in hcal
+
+  for(unsigned f=0; f<NFLAVOURS; ++f) {
+    if( !ownRecHits[f].get() ) continue;
+    iEvent.put( ownRecHits[f], flavours_[f].label );
+    iEvent.put( ownRecHitsCleaned[f], flavours_[f].label+"Cleaned" );
+  }
+}
+
+
+
+void 
+PFRecHitProducerHCAL::createCaloTowerRecHits( FlavourSetup& flavour,
+					      const vector<TowerRecHit>& towers,
+					      const vector<HFTower>& hfTowers,
+					      const HBHERecHitCollection& hbheHits,
+					      const HcalTopology& topology,
+					      vector<reco::PFRecHit>& rechits,
+					      vector<reco::PFRecHit>& rechitsCleaned,
+					      vector<reco::PFRecHit>& HFEMRecHits,
+					      vector<reco::PFRecHit>& HFHADRecHits ) {
+
+  // these indices are necessary to find the rechit neighbours efficiently
+  // the key is the CaloTowerDetId dense index, or the HcalTopology 
+  // dense id for the HB and HE rechits made from the HBHE rechits. 
+  // the value is the index in the rechits vector
+  PFRecHitDenseIndex& idSortedRecHits = flavour.idSortedRecHits;
+  PFRecHitDenseIndex& idSortedRecHitsHFEM = flavour.idSortedRecHitsHFEM;
+  PFRecHitDenseIndex& idSortedRecHitsHFHAD = flavour.idSortedRecHitsHFHAD;
+  idSortedRecHits.newEvent();
+  idSortedRecHitsHFEM.newEvent();
+  idSortedRecHitsHFHAD.newEvent();
+  idSortedRecHitsHFEM.resize( CaloTowerDetId::kSizeForDenseIndexing );
+  idSortedRecHitsHFHAD.resize( CaloTowerDetId::kSizeForDenseIndexing );
+
+  const PFHCALTimeSelection* timeSelection = flavour.timeSelection.get();
+  if( timeSelection ) {
+    idSortedRecHits.resize( topology.ncells() );
+    createTimeSelectedRecHits( *timeSelection, hbheHits, topology, 
+			       rechits, idSortedRecHits );
+  }
+  else {
+    idSortedRecHits.resize( CaloTowerDetId::kSizeForDenseIndexing );
+    rechits.reserve( towers.size() );
+  }
+
+  // clean all the HF towers 
+  vector<HFCleaning> hfCleaning( hfTowers.size() );
+  for(unsigned ihf=0; ihf<hfTowers.size(); ++ihf) 
+    cleanHFTower( hfTowers[ihf], flavour, hfCleaning[ihf] );
+
+
+  // create the rechits, in the order of the towers
+  for(unsigned it=0; it<towers.size(); ++it) {
+
+    const TowerRecHit& tower = towers[it];
+    const HcalDetId& detid = tower.detid;
+    double energy = tower.energy;
+    double rescaleFactor = tower.rescaleFactor;
+
+    // the rechits are created in place in the output collections
+    reco::PFRecHit* pfrh = 0;
+    //---ab: need 2 rechits for the HF:
+    reco::PFRecHit* pfrhHFEM = 0;
+    reco::PFRecHit* pfrhHFHAD = 0;
+
+    switch( detid.subdet() ) {
+    case HcalBarrel: 
+      {
+	// already made from the HBHE rechits
+	if( timeSelection ) break;
+	//if ( rescaleFactor > 1. ) 
+	// std::cout << "Barrel HCAL energy rescaled from = " << energy << " to " << energy*rescaleFactor << std::endl;
+	if ( rescaleFactor > 1. ) { 
+	  reco::PFRecHit* pfrhCleaned = 
+	    createHcalRecHit( rechitsCleaned, detid, 
+			      energy, 
+			      PFLayer::HCAL_BARREL1, 
+			      tower.ctId.rawId() );
+	  if(pfrhCleaned) pfrhCleaned->setRescale(rescaleFactor);
+	  energy *= rescaleFactor;
+	}
+	pfrh = createHcalRecHit( rechits, detid, 
+				 energy, 
+				 PFLayer::HCAL_BARREL1, 
+				 tower.ctId.rawId() );
+	if(pfrh) pfrh->setRescale(rescaleFactor);
+      }
+      break;
+    case HcalEndcap:
+      {
+	// already made from the HBHE rechits
+	if( timeSelection ) break;
+	//if ( rescaleFactor > 1. ) 
+	// std::cout << "End-cap HCAL energy rescaled from = " << energy << " to " << energy*rescaleFactor << std::endl;
+	if ( rescaleFactor > 1. ) { 
+	  reco::PFRecHit* pfrhCleaned = 
+	    createHcalRecHit( rechitsCleaned, detid, 
+			      energy, 
+			      PFLayer::HCAL_ENDCAP, 
+			      tower.ctId.rawId() );
+	  if(pfrhCleaned) pfrhCleaned->setRescale(rescaleFactor);
+	  energy *= rescaleFactor;
+	}
+	pfrh = createHcalRecHit( rechits, detid, 
+				 energy, 
+				 PFLayer::HCAL_ENDCAP, 
+				 tower.ctId.rawId() );
+	if(pfrh) pfrh->setRescale(rescaleFactor);
+      }
+      break;
+    case HcalForward:
+      {
+	const HFCleaning& hf = hfCleaning[tower.hfTower];
+
+	// Create an EM and a HAD rechit if above threshold.
+	if ( hf.energyEM > thresh_HF_ || hf.energyHAD > thresh_HF_ ) { 
+	  pfrhHFEM = createHcalRecHit( HFEMRecHits, detid, 
+				       hf.energyEM, 
+				       PFLayer::HF_EM, 
+				       tower.ctId.rawId() );
+	  pfrhHFHAD = createHcalRecHit( HFHADRecHits, detid, 
+					hf.energyHAD, 
+					PFLayer::HF_HAD, 
+					tower.ctId.rawId() );
+	  if(pfrhHFEM) pfrhHFEM->setEnergyUp(hf.energyHAD);
+	  if(pfrhHFHAD) pfrhHFHAD->setEnergyUp(hf.energyEM);
+	}
+
+	// the cleaned fibres
+	for(unsigned ifib=0; ifib<HFCleaning::NCLEANED; ++ifib) {
+	  if( !hf.cleaned[ifib].cleaned ) continue;
+	  PFLayer::Layer layer = 
+	    ifib==HFCleaning::LONG || ifib==HFCleaning::LONG29 ? 
+	    PFLayer::HF_EM : PFLayer::HF_HAD;
+	  reco::PFRecHit* pfrhFibre = 
+	    createHcalRecHit( rechitsCleaned, detid, 
+			      hf.cleaned[ifib].energy, 
+			      layer, 
+			      tower.ctId.rawId() );
+	  if(pfrhFibre) pfrhFibre->setRescale( hf.cleaned[ifib].time );
+	}
+      }
+      break;
+    default:
+      break;
+    } 
+
+    if(pfrh) { 
+      idSortedRecHits.insert( tower.ctId.denseIndex(), 
+			      rechits.size()-1 ); 
+    }
+    //---ab: 2 rechits for HF:	   
+    if(pfrhHFEM) { 
+      idSortedRecHitsHFEM.insert( tower.ctId.denseIndex(), 
+				  HFEMRecHits.size()-1 ); 
+    }
+    if(pfrhHFHAD) { 
+      idSortedRecHitsHFHAD.insert( tower.ctId.denseIndex(), 
+				   HFHADRecHits.size()-1 ); 
+    }
+    //---ab	   
+  }
+
+  // optionally, along a space-filling curve
+  auto towerIndex = []( unsigned id ) { 
+    return CaloTowerDetId( id ).denseIndex(); 
+  };
+  if( timeSelection ) 
+    sortRecHits( rechits, idSortedRecHits, 
+		 [&]( unsigned id ) { 
+		   return topology.detId2denseId( DetId( id ) ); 
+		 } );
+  else 
+    sortRecHits( rechits, idSortedRecHits, towerIndex );
+  sortRecHits( HFEMRecHits, idSortedRecHitsHFEM, towerIndex );
+  sortRecHits( HFHADRecHits, idSortedRecHitsHFHAD, towerIndex );
+
+  // do navigation 
+  if( timeSelection ) 
+    for(unsigned i=0; i<rechits.size(); i++ ) 
+      findRecHitNeighbours( rechits[i],
+			    topology.detId2denseId( rechits[i].detId() ),
+			    idSortedRecHits );
+  else 
+    for(unsigned i=0; i<rechits.size(); i++ ) 
+      findRecHitNeighboursCT( rechits[i],
+			      idSortedRecHits );
+  for(unsigned i=0; i<HFEMRecHits.size(); i++ ) 
+    findRecHitNeighboursCT( HFEMRecHits[i],
+			    idSortedRecHitsHFEM );
+  for(unsigned i=0; i<HFHADRecHits.size(); i++ ) 
+    findRecHitNeighboursCT( HFHADRecHits[i],
+			    idSortedRecHitsHFHAD );
+}
+
+
+
+void 
+PFRecHitProducerHCAL::createTimeSelectedRecHits( const PFHCALTimeSelection& timeSelection,
+						 const HBHERecHitCollection& hbheHits,
+						 const HcalTopology& topology,
+						 vector<reco::PFRecHit>& rechits,
+						 PFRecHitDenseIndex& sortedHits ) {
+
+  // the candidates passing the thresholds, with their calibrated 
+  // energies and their times
+  vector<HcalDetId> detids;
+  vector<double> energies;
+  vector<double> times;
+  detids.reserve( hbheHits.size() );
+  energies.reserve( hbheHits.size() );
+  times.reserve( hbheHits.size() );
+
+  for(unsigned irechit=0; irechit<hbheHits.size(); irechit++) {
+    const HBHERecHit& hit = hbheHits[irechit];
+
+    double hitenergy = hit.energy();
+
+    const HcalDetId& detid = hit.detid();
+    switch( detid.subdet() ) {
+    case HcalBarrel:
+      if(hitenergy < thresh_Barrel_ ) continue;
+      break;
+    case HcalEndcap:
+      if(hitenergy < thresh_Endcap_ ) continue;
+      // Apply tower 29 calibration
+      if ( HCAL_Calib_ && abs(detid.ieta()) == 29 ) hitenergy *= HCAL_Calib_29;
+      break;
+    default:
+      LogError("PFRecHitProducerHCAL")
+	<<"HCAL rechit: unknown layer : "<<detid.subdet()<<endl;
+      continue;
+    }
+
+    detids.push_back( detid );
+    energies.push_back( hitenergy );
+    times.push_back( hit.time() );
+  }
+
+  // time correction and selection of all the candidates, 
+  // before any geometry access
+  unsigned ncandidates = detids.size();
+  if( !ncandidates ) return;
+  vector<unsigned char> accept( ncandidates );
+  timeSelection.select( ncandidates, &detids[0], &energies[0], 
+			&times[0], &accept[0] );
+
+  rechits.reserve( rechits.size() + ncandidates );
+  for(unsigned ic=0; ic<ncandidates; ++ic) {
+    if( !accept[ic] ) continue;
+
+    const HcalDetId& detid = detids[ic];
+    bool barrel = detid.subdet() == HcalBarrel;
+    reco::PFRecHit* pfrh = 
+      createHcalRecHit( rechits, detid, energies[ic], 
+			barrel ? PFLayer::HCAL_BARREL1 : PFLayer::HCAL_ENDCAP );
+    if(pfrh) {
+      pfrh->setRescale(times[ic]);
+      sortedHits.insert( topology.detId2denseId(detid), rechits.size()-1 );
+    }
+  }
 }
 
 
@@ -1054,29 +821,34 @@ void PFRecHitProducerHCAL::createRecHits(vector<reco::PFRecHit>& rechits,
 
 
 reco::PFRecHit* 
-PFRecHitProducerHCAL::createHcalRecHit( const DetId& detid,
+PFRecHitProducerHCAL::createHcalRecHit( vector<reco::PFRecHit>& rechits,
+					const DetId& detid,
 					double energy,
 					PFLayer::Layer layer,
-					const CaloSubdetectorGeometry* geom,
 					unsigned newDetId ) {
   
-  const CaloCellGeometry *thisCell = geom->getGeometry(detid);
+  const PFCaloCellCache::Cell* thisCell = 
+    cellCache_->cell( PFCaloCellCache::HCAL, 
+		      hcalTopology_->detId2denseId(detid) );
   if(!thisCell) {
     edm::LogError("PFRecHitProducerHCAL")
       <<"warning detid "<<detid.rawId()<<" not found in layer "
       <<layer<<endl;
     return 0;
   }
+
+  // regional mode: outside the regions of interest
+  if( !inRegions( *thisCell ) ) return 0;
   
-  const GlobalPoint& position = thisCell->getPosition();
+  const float (&position)[3] = thisCell->position;
   
   double depth_correction = 0.;
   switch ( layer ) { 
   case PFLayer::HF_EM:
-    depth_correction = position.z() > 0. ? EM_Depth_ : -EM_Depth_;
+    depth_correction = position[2] > 0. ? EM_Depth_ : -EM_Depth_;
     break;
   case PFLayer::HF_HAD:
-    depth_correction = position.z() > 0. ? HAD_Depth_ : -HAD_Depth_;
+    depth_correction = position[2] > 0. ? HAD_Depth_ : -HAD_Depth_;
     break;
   default:
     break;
@@ -1084,25 +856,280 @@ PFRecHitProducerHCAL::createHcalRecHit( const DetId& detid,
 
   unsigned id = detid;
   if(newDetId) id = newDetId;
-  reco::PFRecHit *rh = 
-    new reco::PFRecHit( id,  layer, energy, 
-			position.x(), position.y(), position.z()+depth_correction, 
-			0,0,0 );
- 
-  
-  
+  reco::PFRecHit& rh = 
+    newRecHit( rechits, id,  layer, energy, 
+	       position[0], position[1], position[2]+depth_correction );
   
   // set the corners
-  const CaloCellGeometry::CornersVec& corners = thisCell->getCorners();
+  setCorners( rh, thisCell->corners, 1., depth_correction );
+ 
+  return &rh;
+}
 
-  assert( corners.size() == 8 );
 
-  rh->setNECorner( corners[0].x(), corners[0].y(),  corners[0].z()+depth_correction );
-  rh->setSECorner( corners[1].x(), corners[1].y(),  corners[1].z()+depth_correction );
-  rh->setSWCorner( corners[2].x(), corners[2].y(),  corners[2].z()+depth_correction );
-  rh->setNWCorner( corners[3].x(), corners[3].y(),  corners[3].z()+depth_correction );
- 
-  return rh;
+
+
+void 
+PFRecHitProducerHCAL::getHFFibre( HFFibre& fibre, 
+				  const HcalDetId& id, 
+				  const HFRecHitCollection& hfHits,
+				  const HcalTopology& topology ) const {
+
+  fibre.id = id;
+
+  unsigned i = idSortedHFRecHits_.find( topology.detId2denseIdHF(id) );
+  if( i == PFRecHitDenseIndex::NOTFOUND || hfHits[i].id() != id ) return;
+
+  const HFRecHit& hit = hfHits[i];
+  fibre.found = true;
+  fibre.energy = hit.energy();
+  fibre.time = hit.time();
+  fibre.flags = hit.flags();
+}
+
+
+
+void 
+PFRecHitProducerHCAL::gatherHFTower( HFTower& tower, 
+				     const HcalDetId& detid,
+				     double energyEM, 
+				     double energyHAD,
+				     const HFRecHitCollection& hfHits,
+				     const HcalTopology& topology ) const {
+
+  tower.detid = detid;
+  tower.energyEM = energyEM;
+  tower.energyHAD = energyHAD;
+
+  int ieta = detid.ieta();
+  int iphi = detid.iphi();
+  getHFFibre( tower.longFibre, HcalDetId(HcalForward, ieta, iphi, 1), 
+	      hfHits, topology );
+  getHFFibre( tower.shortFibre, HcalDetId(HcalForward, ieta, iphi, 2), 
+	      hfHits, topology );
+
+  // tower 29 is merged with tower 30
+  if ( abs(ieta) == 30 ) { 
+    int ieta29 = ieta > 0 ? 29 : -29;
+    getHFFibre( tower.longFibre29, HcalDetId(HcalForward, ieta29, iphi, 1), 
+		hfHits, topology );
+    getHFFibre( tower.shortFibre29, HcalDetId(HcalForward, ieta29, iphi, 2), 
+		hfHits, topology );
+  }
+}
+
+
+
+PFRecHitProducerHCAL::HFFibreFlags
+PFRecHitProducerHCAL::hfFibreFlags( const HFFibre& fibre, 
+				    const FlavourSetup& flavour ) const {
+
+  HFFibreFlags flags;
+  if( !fibre.found ) return flags;
+
+  int flag = fibre.flags;
+  if( flavour.hfSeverity ) {
+    const HcalDetId& id = fibre.id;
+    flags.flagDPG = applyLongShortDPG_ && ( hcalQuality_.severityLevel(id, flag & hcalHFLongShortFlagValue_, 0)> HcalMaxAllowedHFLongShortSev_);
+    flags.flagTimeDPG = applyTimeDPG_ && ( hcalQuality_.severityLevel(id, flag & hcalHFInTimeWindowFlagValue_, 0)> HcalMaxAllowedHFInTimeWindowSev_);
+    flags.flagPulseDPG = applyPulseDPG_ && ( hcalQuality_.severityLevel(id, flag & hcalHFDigiTimeFlagValue_, 0)> HcalMaxAllowedHFDigiTimeSev_);
+  }
+  else {
+    flags.flagDPG = applyLongShortDPG_ && ( flag & hcalHFLongShortFlagValue_ );
+    flags.flagTimeDPG = applyTimeDPG_ && ( flag & hcalHFInTimeWindowFlagValue_ );
+    flags.flagPulseDPG = applyPulseDPG_ && ( flag & hcalHFDigiTimeFlagValue_ );
+  }
+  return flags;
+}
+
+
+
+bool 
+PFRecHitProducerHCAL::hfChannelAlive( const HcalDetId& fibre, 
+				      const HcalDetId& detid, 
+				      const FlavourSetup& flavour ) const {
+
+  unsigned theStatusValue = hcalQuality_.status(fibre);
+  // The channel is killed
+  if( !flavour.hfSeverity ) return !theStatusValue;
+  int theSeverityLevel = hcalQuality_.severityLevel(detid, 0, theStatusValue);
+  return theSeverityLevel<=HcalMaxAllowedChannelStatusSev_;
+}
+
+
+
+void 
+PFRecHitProducerHCAL::cleanHFTower( const HFTower& tower, 
+				    const FlavourSetup& flavour,
+				    HFCleaning& cleaning ) const {
+
+  const HcalDetId& detid = tower.detid;
+  int ieta = detid.ieta();
+
+  // Some cleaning in the HF 
+  double longFibre = tower.energyEM + tower.energyHAD/2.;
+  double shortFibre = tower.energyHAD/2.;
+
+  const HFFibre& theLongHit = tower.longFibre;
+  const HFFibre& theShortHit = tower.shortFibre;
+  HFFibreFlags theLongFlags = hfFibreFlags( theLongHit, flavour );
+  HFFibreFlags theShortFlags = hfFibreFlags( theShortHit, flavour );
+  double theLongHitEnergy = theLongHit.energy;
+  double theShortHitEnergy = theShortHit.energy;
+
+  CleanedFibre& cleanedLong = cleaning.cleaned[HFCleaning::LONG];
+  CleanedFibre& cleanedShort = cleaning.cleaned[HFCleaning::SHORT];
+  CleanedFibre& cleanedLong29 = cleaning.cleaned[HFCleaning::LONG29];
+  CleanedFibre& cleanedShort29 = cleaning.cleaned[HFCleaning::SHORT29];
+
+  // Then check the timing in short and long fibres in all other towers.
+  if ( theShortHitEnergy > longShortFibre_Cut && 
+       ( theShortHit.time < minShortTiming_Cut ||
+	 theShortHit.time > maxShortTiming_Cut || 
+	 theShortFlags.flagTimeDPG || theShortFlags.flagPulseDPG ) ) { 
+    cleanedShort.clean( theShortHitEnergy, theShortHit.time );
+    shortFibre -= theShortHitEnergy;
+    theShortHitEnergy = 0.;
+  }
+
+  if ( theLongHitEnergy > longShortFibre_Cut && 
+       ( theLongHit.time < minLongTiming_Cut ||
+	 theLongHit.time > maxLongTiming_Cut  || 
+	 theLongFlags.flagTimeDPG || theLongFlags.flagPulseDPG ) ) { 
+    cleanedLong.clean( theLongHitEnergy, theLongHit.time );
+    longFibre -= theLongHitEnergy;
+    theLongHitEnergy = 0.;
+  }
+
+  // Some energy must be in the long fibres is there is some energy in the short fibres ! 
+  // Check if the long-fibre hit was not cleaned already (because hot)
+  // In this case don't apply the cleaning
+  if ( theShortHitEnergy > shortFibre_Cut && 
+       ( theLongHitEnergy/theShortHitEnergy < longFibre_Fraction || 
+	 theShortFlags.flagDPG ) &&
+       hfChannelAlive( theLongHit.id, detid, flavour ) ) {
+    cleanedShort.clean( theShortHitEnergy, theShortHit.time );
+    shortFibre -= theShortHitEnergy;
+    theShortHitEnergy = 0.;
+  }
+
+  if ( theLongHitEnergy > longFibre_Cut && 
+       ( theShortHitEnergy/theLongHitEnergy < shortFibre_Fraction || 
+	 theLongFlags.flagDPG ) &&
+       hfChannelAlive( theShortHit.id, detid, flavour ) ) {
+    cleanedLong.clean( theLongHitEnergy, theLongHit.time );
+    longFibre -= theLongHitEnergy;
+    theLongHitEnergy = 0.;
+  }
+
+  // Special treatment for tower 29
+  // A tower with energy only at ieta = +/- 29 is not physical -> Clean
+  if ( abs(ieta) == 29 ) { 
+    // Clean long fibres
+    if ( theLongHitEnergy > shortFibre_Cut/2. ) { 
+      cleanedLong29.clean( theLongHitEnergy, theLongHit.time );
+      longFibre -= theLongHitEnergy;
+      theLongHitEnergy = 0.;
+    }
+    // Clean short fibres
+    if ( theShortHitEnergy > shortFibre_Cut/2. ) { 
+      cleanedShort29.clean( theShortHitEnergy, theShortHit.time );
+      shortFibre -= theShortHitEnergy;
+      theShortHitEnergy = 0.;
+    }
+  }
+  // Check the timing of the long and short fibre rechits
+		
+  // First, check the timing of long and short fibre in eta = 29 if tower 30.
+  else if ( abs(ieta) == 30 ) { 
+    const HFFibre& theLongHit29 = tower.longFibre29;
+    const HFFibre& theShortHit29 = tower.shortFibre29;
+    double theLongHitEnergy29 = theLongHit29.energy;
+    double theShortHitEnergy29 = theShortHit29.energy;
+    HFFibreFlags theLongFlags29 = hfFibreFlags( theLongHit29, flavour );
+    HFFibreFlags theShortFlags29 = hfFibreFlags( theShortHit29, flavour );
+    if( flavour.hfSeverity ) {
+      // as before, the digi time flag of the short fibre 
+      // overwrites the one of the long fibre in tower 29
+      if( theShortHit29.found ) 
+	theLongFlags29.flagPulseDPG = theShortFlags29.flagPulseDPG;
+      theShortFlags29.flagPulseDPG = false;
+    }
+
+    if ( theLongHitEnergy29 > longShortFibre_Cut && 
+	 ( theLongHit29.time < minLongTiming_Cut ||
+	   theLongHit29.time > maxLongTiming_Cut ||
+	   theLongFlags29.flagTimeDPG || theLongFlags29.flagPulseDPG ) ) { 
+      cleanedLong29.clean( theLongHitEnergy29, theLongHit29.time );
+      longFibre -= theLongHitEnergy29;
+      theLongHitEnergy29 = 0;
+    }
+
+    if ( theShortHitEnergy29 > longShortFibre_Cut && 
+	 ( theShortHit29.time < minShortTiming_Cut ||
+	   theShortHit29.time > maxShortTiming_Cut ||
+	   theShortFlags29.flagTimeDPG || theShortFlags29.flagPulseDPG ) ) { 
+      cleanedShort29.clean( theShortHitEnergy29, theShortHit29.time );
+      shortFibre -= theShortHitEnergy29;
+      theShortHitEnergy29 = 0.;
+    }
+
+    // Some energy must be in the long fibres is there is some energy in the short fibres ! 
+    if ( theShortHitEnergy29 > shortFibre_Cut && 
+	 ( theLongHitEnergy29/theShortHitEnergy29 < 2.*longFibre_Fraction || 
+	   theShortFlags29.flagDPG ) &&
+	 hfChannelAlive( theLongHit29.id, detid, flavour ) ) {
+      cleanedShort29.clean( theShortHitEnergy29, theShortHit29.time );
+      shortFibre -= theShortHitEnergy29;
+      theShortHitEnergy29 = 0.;
+    }
+		  
+    // Some energy must be in the short fibres is there is some energy in the long fibres ! 
+    if ( theLongHitEnergy29 > longFibre_Cut && 
+	 ( theShortHitEnergy29/theLongHitEnergy29 < shortFibre_Fraction || 
+	   theLongFlags29.flagDPG ) &&
+	 hfChannelAlive( theShortHit29.id, detid, flavour ) ) {
+      cleanedLong29.clean( theLongHitEnergy29, theLongHit29.time );
+      longFibre -= theLongHitEnergy29;
+      theLongHitEnergy29 = 0.;
+    }
+
+    // Check that the energy in tower 29 is smaller than in tower 30
+    // First in long fibres
+    if ( theLongHitEnergy29 > std::max(theLongHitEnergy,shortFibre_Cut/2) ) { 
+      cleanedLong29.clean( theLongHitEnergy29, theLongHit29.time );
+      longFibre -= theLongHitEnergy29;
+      theLongHitEnergy29 = 0.;
+    }
+    // Second in short fibres
+    if ( theShortHitEnergy29 > std::max(theShortHitEnergy,shortFibre_Cut/2.) ) { 
+      cleanedShort29.clean( theShortHitEnergy29, theShortHit29.time );
+      shortFibre -= theShortHitEnergy29;
+      theShortHitEnergy29 = 0.;
+    }
+  }
+
+
+  // Determine EM and HAD after cleaning of short and long fibres
+  double energyhadHF = 2.*shortFibre;
+  double energyemHF = longFibre - shortFibre;
+
+  // The EM energy might be negative, as it amounts to Long - Short
+  // In that case, put the EM "energy" in the HAD energy
+  // Just to avoid systematic positive bias due to "Short" high fluctuations
+  if ( energyemHF < thresh_HF_ ) { 
+    energyhadHF += energyemHF;
+    energyemHF = 0.;
+  }
+
+  // Apply HCAL calibration factors flor towers close to 29, if requested
+  if ( HF_Calib_ && abs(detid.ieta()) <= 32 ) { 
+    energyhadHF *= HF_Calib_29;
+    energyemHF *= HF_Calib_29;
+  }
+
+  cleaning.energyEM = energyemHF;
+  cleaning.energyHAD = energyhadHF;
 }
 
 
@@ -1111,11 +1138,8 @@ PFRecHitProducerHCAL::createHcalRecHit( const DetId& detid,
 void 
 PFRecHitProducerHCAL::findRecHitNeighbours
 ( reco::PFRecHit& rh, 
-  const map<unsigned,unsigned >& sortedHits, 
-  const CaloSubdetectorTopology& barrelTopology, 
-  const CaloSubdetectorGeometry& barrelGeometry, 
-  const CaloSubdetectorTopology& endcapTopology, 
-  const CaloSubdetectorGeometry& endcapGeometry ) {
+  unsigned cell,
+  const PFRecHitDenseIndex& sortedHits ) const {
   
   //cout<<"------PFRecHitProducerHcaL:findRecHitNeighbours navigation value "<<navigation_HF_<<endl;
  if(navigation_HF_ == false){
@@ -1124,115 +1148,23 @@ PFRecHitProducerHCAL::findRecHitNeighbours
     if( rh.layer() == PFLayer::HF_EM )
       return;
   } 
-  DetId detid( rh.detId() );
 
-  const CaloSubdetectorTopology* topology = 0;
-  const CaloSubdetectorGeometry* geometry = 0;
-  
   switch( rh.layer() ) {
-  case PFLayer::ECAL_ENDCAP: 
-    topology = &endcapTopology;
-    geometry = &endcapGeometry;
-    break;
-  case PFLayer::ECAL_BARREL: 
-    topology = &barrelTopology;
-    geometry = &barrelGeometry;
-    break;
   case PFLayer::HCAL_ENDCAP:
-    topology = &endcapTopology;
-    geometry = &endcapGeometry;
-    break;
   case PFLayer::HCAL_BARREL1:
-    topology = &barrelTopology;
-    geometry = &barrelGeometry;
-    break;
-  case PFLayer::PS1:
-  case PFLayer::PS2:
-    topology = &barrelTopology;
-    geometry = &barrelGeometry;
     break;
   default:
     assert(0);
   }
   
-  assert( topology && geometry );
-
-  CaloNavigator<DetId> navigator(detid, topology);
-
-  DetId north = navigator.north();  
-  
-  DetId northeast(0);
-  if( north != DetId(0) ) {
-    northeast = navigator.east();  
-  }
-  navigator.home();
-
-
-  DetId south = navigator.south();
-
-  
-
-  DetId southwest(0); 
-  if( south != DetId(0) ) {
-    southwest = navigator.west();
-  }
-  navigator.home();
-
-
-  DetId east = navigator.east();
-  DetId southeast;
-  if( east != DetId(0) ) {
-    southeast = navigator.south(); 
-  }
-  navigator.home();
-  DetId west = navigator.west();
-  DetId northwest;
-  if( west != DetId(0) ) {   
-    northwest = navigator.north();  
-  }
-  navigator.home();
-    
-  IDH i = sortedHits.find( north.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-  
-  i = sortedHits.find( northeast.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-  
-  i = sortedHits.find( south.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-    
-  i = sortedHits.find( southwest.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-  i = sortedHits.find( east.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-    
-  i = sortedHits.find( southeast.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-  i = sortedHits.find( west.rawId() );
-  if(i != sortedHits.end() ) 
-     rh.add4Neighbour( i->second );
-   
-  i = sortedHits.find( northwest.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-
+  addNeighbours( rh, PFCaloCellCache::HCAL, cell, sortedHits );
 }
 
 
 void 
 PFRecHitProducerHCAL::findRecHitNeighboursCT
 ( reco::PFRecHit& rh, 
-  const map<unsigned, unsigned >& sortedHits, 
-  const CaloSubdetectorTopology& topology ) {
+  const PFRecHitDenseIndex& sortedHits ) const {
   //cout<<"------PFRecHitProducerHcaL:findRecHitNeighboursCT navigation value "<<navigation_HF_<<endl;
   //  cout<<"----------- rechit print out"<<endl;
   // if(( rh.layer() == PFLayer::HF_HAD )||(rh.layer() == PFLayer::HF_EM)) {  
@@ -1245,169 +1177,11 @@ PFRecHitProducerHCAL::findRecHitNeighboursCT
     if( rh.layer() == PFLayer::HF_EM )
       return;
   }
-  CaloTowerDetId ctDetId( rh.detId() );
-    
-
-  vector<DetId> northids = topology.north(ctDetId);
-  vector<DetId> westids = topology.west(ctDetId);
-  vector<DetId> southids = topology.south(ctDetId);
-  vector<DetId> eastids = topology.east(ctDetId);
-
-
-  CaloTowerDetId badId;
-
-  // all the following detids will be CaloTowerDetId
-  CaloTowerDetId north;
-  CaloTowerDetId northwest;
-  CaloTowerDetId northwest2;
-  CaloTowerDetId west;
-  CaloTowerDetId west2;
-  CaloTowerDetId southwest;
-  CaloTowerDetId southwest2;
-  CaloTowerDetId south;
-  CaloTowerDetId southeast;
-  CaloTowerDetId southeast2;
-  CaloTowerDetId east;
-  CaloTowerDetId east2;
-  CaloTowerDetId northeast;
-  CaloTowerDetId northeast2;
-  
-  // for north and south, there is no ambiguity : 1 or 0 neighbours
-  
-  switch( northids.size() ) {
-  case 0: 
-    break;
-  case 1: 
-    north = northids[0];
-    break;
-  default:
-  stringstream err("PFRecHitProducerHCAL::findRecHitNeighboursCT : incorrect number of neighbours north: "); 
-    err<<northids.size();
-    throw( err.str() ); 
-  }
-
-  switch( southids.size() ) {
-  case 0: 
-    break;
-  case 1: 
-    south = southids[0];
-    break;
-  default:
-  stringstream err("PFRecHitProducerHCAL::findRecHitNeighboursCT : incorrect number of neighbours south: "); 
-    err<<southids.size();
-    throw( err.str() ); 
-  }
-  
-  // for east and west, one must take care 
-  // of the pitch change in HCAL endcap.
-
-  switch( eastids.size() ) {
-  case 0: 
-    break;
-  case 1: 
-    east = eastids[0];
-    northeast = getNorth(east, topology);
-    southeast = getSouth(east, topology);
-    break;
-  case 2:  
-    // in this case, 0 is more on the north than 1
-    east = eastids[0];
-    east2 = eastids[1];
-    northeast = getNorth(east, topology );
-    southeast = getSouth(east2, topology);    
-    northeast2 = getNorth(northeast, topology );
-    southeast2 = getSouth(southeast, topology);    
-    break;
-  default:
-  stringstream err("PFRecHitProducerHCAL::findRecHitNeighboursCT : incorrect number of neighbours eastids: "); 
-    err<<eastids.size();
-    throw( err.str() ); 
-  }
-  
-  
-  switch( westids.size() ) {
-  case 0: 
-    break;
-  case 1: 
-    west = westids[0];
-    northwest = getNorth(west, topology);
-    southwest = getSouth(west, topology);
-    break;
-  case 2:  
-    // in this case, 0 is more on the north than 1
-    west = westids[0];
-    west2 = westids[1];
-    northwest = getNorth(west, topology );
-    southwest = getSouth(west2, topology );    
-    northwest2 = getNorth(northwest, topology );
-    southwest2 = getSouth(southwest, topology );    
-    break;
-  default:
-  stringstream err("PFRecHitProducerHCAL::findRecHitNeighboursCT : incorrect number of neighbours westids: "); 
-    err<< westids.size();
-    throw( err.str() ); 
-  }
-
-
 
+  unsigned tower = CaloTowerDetId( rh.detId() ).denseIndex();
 
   // find and set neighbours
-    
-  IDH i = sortedHits.find( north.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-  
-  i = sortedHits.find( northeast.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-  
-  i = sortedHits.find( northeast2.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-  
-  i = sortedHits.find( south.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-    
-  i = sortedHits.find( southwest.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-  i = sortedHits.find( southwest2.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-  i = sortedHits.find( east.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-    
-  i = sortedHits.find( east2.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-    
-  i = sortedHits.find( southeast.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-  i = sortedHits.find( southeast2.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-  i = sortedHits.find( west.rawId() );
-  if(i != sortedHits.end() ) 
-     rh.add4Neighbour( i->second );
-   
-  i = sortedHits.find( west2.rawId() );
-  if(i != sortedHits.end() ) 
-     rh.add4Neighbour( i->second );
-   
-  i = sortedHits.find( northwest.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-
-  i = sortedHits.find( northwest2.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
+  addNeighbours( rh, PFCaloCellCache::CALOTOWER, tower, sortedHits );
 
   //  cout<<"----------- rechit print out"<<endl;
   // if(( rh.layer() == PFLayer::HF_HAD )||(rh.layer() == PFLayer::HF_EM)) {  
@@ -1415,33 +1189,3 @@ PFRecHitProducerHCAL::findRecHitNeighboursCT
   //   cout<<rh<<endl;
     //  }
 }
-
-
-
-DetId 
-PFRecHitProducerHCAL::getSouth(const DetId& id, 
-			       const CaloSubdetectorTopology& topology) {
-
-  DetId south;
-  vector<DetId> sids = topology.south(id);
-  if(sids.size() == 1)
-    south = sids[0];
-  
-  return south;
-} 
-
-
-
-DetId 
-PFRecHitProducerHCAL::getNorth(const DetId& id, 
-			       const CaloSubdetectorTopology& topology) {
-
-  DetId north;
-  vector<DetId> nids = topology.north(id);
-  if(nids.size() == 1)
-    north = nids[0];
-  
-  return north;
-} 
-
-
@@ -3,6 +3,7 @@
 
 // system include files
 #include <memory>
+#include <string>
 #include <vector>
 
 // user include files
@@ -14,10 +15,16 @@
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
-#include "Geometry/CaloTopology/interface/CaloDirection.h"
+#include "Geometry/Records/interface/IdealGeometryRecord.h"
+
 #include "Geometry/CaloTopology/interface/HcalTopology.h"
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducer.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitDenseIndex.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFHCALQualityCache.h"
 #include "DataFormats/ParticleFlowReco/interface/PFLayer.h"
+#include "DataFormats/HcalDetId/interface/HcalDetId.h"
+#include "DataFormats/CaloTowers/interface/CaloTowerDetId.h"
+#include "DataFormats/HcalRecHit/interface/HcalRecHitCollections.h"
 
 /**\class PFRecHitProducerHCAL
 \brief Producer for particle flow rechits  (PFRecHit) in HCAL 
@@ -26,8 +33,7 @@
 \date   february 2008
 */
 
-class CaloSubdetectorTopology;
-class CaloSubdetectorGeometry;
+class PFHCALTimeSelection;
 class DetId;
 
 
@@ -35,9 +41,32 @@ class PFRecHitProducerHCAL : public PFRecHitProducer {
  public:
   explicit PFRecHitProducerHCAL(const edm::ParameterSet&);
   ~PFRecHitProducerHCAL();
+
+  /// gets the channel quality and the topology
+  virtual void beginRun(const edm::Run& run, const edm::EventSetup & es) override;
  
- private:
+ protected:
+
+  /// the kinds of HCAL rechits which can be made in the same pass
+  enum Flavour {
+    /// HB/HE rechits from the CaloTowers, HF cleaning with the 
+    /// severity levels of the flags and channel status
+    STANDARD=0, 
+    /// HB/HE rechits from the HBHE rechits passing the dual time 
+    /// selection, HF cleaning with the raw flags and channel status
+    DUALTIME,
+    NFLAVOURS
+  };
 
+  /// for the modules sharing this core: produce the standard and/or 
+  /// the dual time rechits. the first flavour produced is put with 
+  /// the usual instance labels, the dual time one with the 
+  /// "DualTime" prefix if both are produced
+  PFRecHitProducerHCAL(const edm::ParameterSet&, 
+		       bool produceStandard, 
+		       bool produceDualTime);
+
+ private:
 
   /// gets hcal barrel and endcap rechits, 
   /// translate them to PFRecHits, which are stored in the rechits vector
@@ -45,42 +74,189 @@ class PFRecHitProducerHCAL : public PFRecHitProducer {
 		     std::vector<reco::PFRecHit>& rechitsCleaned,
 		     edm::Event&, const edm::EventSetup&);
 
+  /// how a flavour is produced, and its rechit indices for the event
+  struct FlavourSetup {
+    FlavourSetup() : produced(false), hfSeverity(true) {}
+    bool produced;
+    /// prefix of the instance labels
+    std::string label;
+    /// if set, the HB and HE rechits are made from the HBHE 
+    /// rechits passing this selection, instead of the CaloTowers
+    std::shared_ptr<const PFHCALTimeSelection> timeSelection;
+    /// HF DPG flags and dead channels from the severity levels, 
+    /// or directly from the flag bits and the channel status
+    bool hfSeverity;
+    /// index of the rechit in each cell or tower, for the event
+    PFRecHitDenseIndex  idSortedRecHits;
+    PFRecHitDenseIndex  idSortedRecHitsHFEM;
+    PFRecHitDenseIndex  idSortedRecHitsHFHAD;
+  };
 
-
-
-  reco::PFRecHit*  createHcalRecHit( const DetId& detid, 
+  /// create a rechit at the end of rechits. 
+  /// \return the new rechit, or 0 if the cell geometry is missing
+  reco::PFRecHit*  createHcalRecHit( std::vector<reco::PFRecHit>& rechits,
+				     const DetId& detid, 
 				     double energy,
 				     PFLayer::Layer layer,
-				     const CaloSubdetectorGeometry* geom,
 				     unsigned newDetId=0);
   
 
   
 
-  /// find and set the neighbours to a given rechit
-  /// this works for ecal, hcal, ps
+  /// a CaloTower selected to give a rechit
+  struct TowerRecHit {
+    /// hfTower for the towers outside HF
+    static const unsigned NOHF = 0xFFFFFFFF;
+    TowerRecHit( const CaloTowerDetId& id, const HcalDetId& hcalId, 
+		 double e, double rescale, unsigned hf ) 
+      : ctId(id), detid(hcalId), energy(e), rescaleFactor(rescale), 
+	hfTower(hf) {}
+    CaloTowerDetId ctId;
+    /// the HCAL constituent giving the position
+    HcalDetId detid;
+    /// HCAL energy, calibrated, before the ECAL compensation
+    double energy;
+    double rescaleFactor;
+    /// index in the HF towers
+    unsigned hfTower;
+  };
+
+  /// an HF long or short fibre rechit, as needed by the HF cleaning
+  struct HFFibre {
+    HFFibre() : found(false), energy(0.), time(0.), flags(0) {}
+    HcalDetId id;
+    /// is there a rechit for this fibre ? 
+    bool   found;
+    double energy;
+    double time;
+    int    flags;
+  };
+
+  /// long/short, in-time window and digi time DPG flags of an HF 
+  /// fibre, as seen by a flavour
+  struct HFFibreFlags {
+    HFFibreFlags() : flagDPG(false), flagTimeDPG(false), flagPulseDPG(false) {}
+    bool   flagDPG;
+    bool   flagTimeDPG;
+    bool   flagPulseDPG;
+  };
+
+  /// cleaned HF fibre. the corresponding rechit is created once all 
+  /// the cleaning steps are done, with the energy and time of the last one
+  struct CleanedFibre {
+    CleanedFibre() : cleaned(false), energy(0.), time(0.) {}
+    void clean( double e, double t ) { cleaned = true; energy = e; time = t; }
+    bool   cleaned;
+    double energy;
+    double time;
+  };
+
+  /// an HF tower, with its long and short fibres (and those of the 
+  /// tower 29 merged in tower 30)
+  struct HFTower {
+    HcalDetId detid;
+    /// weighted em and had energies
+    double energyEM;
+    double energyHAD;
+    HFFibre longFibre;
+    HFFibre shortFibre;
+    HFFibre longFibre29;
+    HFFibre shortFibre29;
+  };
+
+  /// result of the cleaning of an HF tower for a flavour
+  struct HFCleaning {
+    /// order of the cleaned fibres
+    enum { LONG=0, SHORT, LONG29, SHORT29, NCLEANED };
+    HFCleaning() : energyEM(0.), energyHAD(0.) {}
+    /// em and had energies after the cleaning
+    double energyEM;
+    double energyHAD;
+    CleanedFibre cleaned[NCLEANED];
+  };
+
+  /// find the rechit of an HF fibre
+  void getHFFibre( HFFibre& fibre, 
+		   const HcalDetId& id, 
+		   const HFRecHitCollection& hfHits,
+		   const HcalTopology& topology ) const;
+
+  /// find the fibres of an HF tower
+  void gatherHFTower( HFTower& tower, 
+		      const HcalDetId& detid,
+		      double energyEM, 
+		      double energyHAD,
+		      const HFRecHitCollection& hfHits,
+		      const HcalTopology& topology ) const;
+
+  /// \return the DPG flags of fibre for flavour. 
+  /// the severity levels are only used by the standard flavour
+  HFFibreFlags hfFibreFlags( const HFFibre& fibre, 
+			     const FlavourSetup& flavour ) const;
+
+  /// \return false if the channel of fibre is known to be bad, 
+  /// in which case the other fibre of detid is not cleaned
+  bool hfChannelAlive( const HcalDetId& fibre, 
+		       const HcalDetId& detid, 
+		       const FlavourSetup& flavour ) const;
+
+  /// clean the long and short fibres of an HF tower (timing, 
+  /// long/short fractions, tower 29), and compute its em and 
+  /// had energies
+  void cleanHFTower( const HFTower& tower, 
+		     const FlavourSetup& flavour,
+		     HFCleaning& cleaning ) const;
+
+  /// create the HB and HE rechits of the HBHE rechits passing 
+  /// timeSelection, the corrected time being stored as rescale 
+  /// factor. the selection is applied to all the rechits above 
+  /// threshold before any rechit is created. the key of sortedHits is the HcalTopology dense id
+  void createTimeSelectedRecHits( const PFHCALTimeSelection& timeSelection,
+				  const HBHERecHitCollection& hbheHits,
+				  const HcalTopology& topology,
+				  std::vector<reco::PFRecHit>& rechits,
+				  PFRecHitDenseIndex& sortedHits );
+
+  /// create and navigate the rechits of flavour, from the selected 
+  /// towers, the fibres of the HF towers and the HBHE rechits
+  void createCaloTowerRecHits( FlavourSetup& flavour,
+			       const std::vector<TowerRecHit>& towers,
+			       const std::vector<HFTower>& hfTowers,
+			       const HBHERecHitCollection& hbheHits,
+			       const HcalTopology& topology,
+			       std::vector<reco::PFRecHit>& rechits,
+			       std::vector<reco::PFRecHit>& rechitsCleaned,
+			       std::vector<reco::PFRecHit>& HFEMRecHits,
+			       std::vector<reco::PFRecHit>& HFHADRecHits );
+
+  /// find and set the neighbours of a HB or HE rechit 
+  /// in cell (HcalTopology dense id)
   void 
     findRecHitNeighbours( reco::PFRecHit& rh, 
-			  const std::map<unsigned,unsigned >& sortedHits, 
-			  const CaloSubdetectorTopology& barrelTopo,
-			  const CaloSubdetectorGeometry& barrelGeom, 
-			  const CaloSubdetectorTopology& endcapTopo,
-			  const CaloSubdetectorGeometry& endcapGeom );
+			  unsigned cell,
+			  const PFRecHitDenseIndex& sortedHits ) const;
   
-  /// find and set the neighbours to a given rechit
-  /// this works for hcal CaloTowers. 
-  /// Should be possible to have a single function for all detectors
+  /// find and set the neighbours of a CaloTower rechit 
+  /// (hcal, HFEM or HFHAD)
   void 
     findRecHitNeighboursCT( reco::PFRecHit& rh, 
-			    const std::map<unsigned,unsigned >& sortedHits,
-			    const CaloSubdetectorTopology& topology );
-  
-  DetId getNorth(const DetId& id, const CaloSubdetectorTopology& topology);
-  DetId getSouth(const DetId& id, const CaloSubdetectorTopology& topology);
+			    const PFRecHitDenseIndex& sortedHits ) const;
   
 
   // ----------member data ---------------------------
   
+  /// the flavours of rechits, and which ones are produced
+  FlavourSetup  flavours_[NFLAVOURS];
+
+  /// index of the HF rechits, by HcalTopology HF dense id
+  PFRecHitDenseIndex  idSortedHFRecHits_;
+
+  /// channel status words, and severity levels for the standard flavour
+  PFHCALQualityCache  hcalQuality_;
+
+  /// the HCAL topology, to find the cells in the cell cache
+  const HcalTopology*  hcalTopology_;
+
   // ----------access to event data
   edm::InputTag    inputTagHcalRecHitsHBHE_;
   edm::InputTag    inputTagHcalRecHitsHF_;
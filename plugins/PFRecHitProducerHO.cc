@@ -40,6 +40,13 @@
 using namespace std;
 using namespace edm;
 
+namespace {
+
+  /// radius of the HO layer 0 over the one of layer 1 (384.8/406.6), 
+  /// to bring the cells at |z|>130 to the layer 0 radius
+  const double sclel0l1r = 0.946;
+}
+
 PFRecHitProducerHO::PFRecHitProducerHO(const edm::ParameterSet& iConfig)
   : PFRecHitProducer(iConfig)
 {
@@ -49,13 +56,25 @@ PFRecHitProducerHO::PFRecHitProducerHO(const edm::ParameterSet& iConfig)
     iConfig.getParameter<InputTag>("recHitsHO");
   
   HOMaxAllowedSev_ = iConfig.getParameter<int>("HOMaxAllowedSev");
-  neighbourmapcalculated_ = false;
 }
 
 
 
 PFRecHitProducerHO::~PFRecHitProducerHO() {}
 
+
+
+void 
+PFRecHitProducerHO::beginRun(const edm::Run& run,
+			     const edm::EventSetup& es) {
+
+  PFRecHitProducer::beginRun(run, es);
+
+  hcalQuality_.update( es, true );
+}
+
+
+
 void 
 PFRecHitProducerHO::createRecHits(vector<reco::PFRecHit>& rechits,
 				  vector<reco::PFRecHit>& rechitsCleaned,
@@ -64,36 +83,18 @@ PFRecHitProducerHO::createRecHits(vector<reco::PFRecHit>& rechits,
 
 
 
-  // this map is necessary to find the rechit neighbours efficiently
-  //C but I should think about using Florian's hashed index to do this.
-  //C in which case the map might not be necessary anymore
-  // 
-  // the key of this map is detId. 
+  // this index is necessary to find the rechit neighbours efficiently
+  // the key is the HCAL dense id.
   // the value is the index in the rechits vector
-  map<unsigned, unsigned > idSortedRecHits;
-  //   typedef map<unsigned, unsigned >::iterator IDH;
-  
-  edm::ESHandle<CaloGeometry> geoHandle;
-  iSetup.get<CaloGeometryRecord>().get(geoHandle);
-  
-  // get the HO geometry
-  const CaloSubdetectorGeometry *hcalBarrelGeometry = 
-    geoHandle->getSubdetectorGeometry(DetId::Hcal, HcalOuter);
+  PFRecHitDenseIndex& idSortedRecHits = idSortedRecHits_;
+  idSortedRecHits.newEvent();
+  idSortedRecHits.resize( cellCache_->size( PFCaloCellCache::HCAL ) );
   
   // get the HO topology
   edm::ESHandle<HcalTopology> hcalBarrelTopology;
   iSetup.get<IdealGeometryRecord>().get(hcalBarrelTopology);
   
-  if(!neighbourmapcalculated_)
-    hoNeighbArray( *hcalBarrelGeometry,
-		   *hcalBarrelTopology);
 
-  // Get Hcal Severity Level Computer, so that the severity of each rechit flag/status may be determined
-  edm::ESHandle<HcalSeverityLevelComputer> hcalSevLvlComputerHndl;
-  iSetup.get<HcalSeverityLevelComputerRcd>().get(hcalSevLvlComputerHndl);
-  const HcalSeverityLevelComputer* hcalSevLvlComputer = hcalSevLvlComputerHndl.product();
-
-  
   // get the HO rechits
   
   edm::Handle<HORecHitCollection> rhcHandle;
@@ -112,6 +113,7 @@ PFRecHitProducerHO::createRecHits(vector<reco::PFRecHit>& rechits,
   }
   else {
     assert( rhcHandle.isValid() );
+    rechits.reserve( rhcHandle->size() );
     
     // process HO rechits
     for(unsigned i=0; i<rhcHandle->size(); i++) {
@@ -133,10 +135,9 @@ PFRecHitProducerHO::createRecHits(vector<reco::PFRecHit>& rechits,
       
 
       // Get Channel Quality information for the given detID
-      const HcalChannelStatus* theStatus = theHcalChStatus->getValues(detid);
-      unsigned theStatusValue = theStatus->getValue();
+      unsigned theStatusValue = hcalQuality_.status(detid);
       // Now get severity of problems for the given detID, based on the rechit flag word and the channel quality status value
-      int hitSeverity=hcalSevLvlComputer->getSeverityLevel(detid, erh.flags(),theStatusValue);
+      int hitSeverity=hcalQuality_.severityLevel(detid, erh.flags(),theStatusValue);
     
       // Skip hits whose problems are more severe than max accept level.  In the future, allow for cleaning of such hits?
       // Note:  As of April 2012, by default, all HO hits in rings +/-1, +/-2 should be identified as either "remove from calotowers" or "remove from rechit collections" in the channel quality database, and thus should be rejected by this conditional statement.
@@ -147,114 +148,80 @@ PFRecHitProducerHO::createRecHits(vector<reco::PFRecHit>& rechits,
 	}  
 
 
+      unsigned cell = hcalBarrelTopology->detId2denseId(detid);
       
-      reco::PFRecHit *pfrh = createHORecHit(detid, energy,  
-					    PFLayer::HCAL_BARREL2, // HO,
-					    hcalBarrelGeometry);
+      reco::PFRecHit *pfrh = createHORecHit(rechits, detid, cell, energy,  
+					    PFLayer::HCAL_BARREL2 ); // HO
       
       if( !pfrh ) continue; // problem with this rechit. skip it
       
       pfrh->setRescale(time);
       
-      rechits.push_back( *pfrh );
-      delete pfrh;
-      idSortedRecHits.insert( make_pair(detid.rawId(), rechits.size()-1 ) ); 
+      idSortedRecHits.insert( cell, rechits.size()-1 ); 
     }      
   }
   
+  // optionally, along a space-filling curve
+  sortRecHits( rechits, idSortedRecHits, 
+	       [&]( unsigned id ) { 
+		 return hcalBarrelTopology->detId2denseId( DetId( id ) ); 
+	       } );
+
   // do navigation
-  for(unsigned i=0; i<rechits.size(); i++ ) {
-    findRecHitNeighboursHO( rechits[i], *hcalBarrelTopology, idSortedRecHits ); 
-  }
+  for(unsigned i=0; i<rechits.size(); i++ ) 
+    findRecHitNeighboursHO( rechits[i],
+			    hcalBarrelTopology->detId2denseId( rechits[i].detId() ),
+			    idSortedRecHits );
   
 } 
 
 
+double 
+PFRecHitProducerHO::ringScale( double z ) {
+  return abs(z)>130 ? sclel0l1r : 1.;
+}
+
+
+
 reco::PFRecHit* 
-PFRecHitProducerHO::createHORecHit( const DetId& detid,
+PFRecHitProducerHO::createHORecHit( vector<reco::PFRecHit>& rechits,
+				    const DetId& detid,
+				    unsigned cell,
 				    double energy,
-				    PFLayer::Layer layer,
-				    const CaloSubdetectorGeometry* geom ) {
-  
-  math::XYZVector position;
-  math::XYZVector axis;
-  
-  const CaloCellGeometry *thisCell 
-    = geom->getGeometry(detid);
+				    PFLayer::Layer layer ) const {
   
   // find rechit geometry
-  if(!thisCell) {
+  const PFCaloCellCache::Cell* geometry = 
+    cellCache_->cell( PFCaloCellCache::HCAL, cell );
+  if( !geometry ) {
     LogError("PFRecHitProducerHO")
       <<"warning detid "<<detid.rawId()
       <<" not found in geometry"<<endl;
     return 0;
   }
+
+  // regional mode: outside the regions of interest
+  if( !inRegions( *geometry ) ) return 0;
   
-  double sclel0l1r=0.946; //384.8/406.6
-  
-  if (abs(thisCell->getPosition().z())>130) {
-    position.SetCoordinates ( sclel0l1r*thisCell->getPosition().x(),
-			      sclel0l1r*thisCell->getPosition().y(),
-			      sclel0l1r*thisCell->getPosition().z() );   
-    
-  } else {
-    position.SetCoordinates ( thisCell->getPosition().x(),
-			      thisCell->getPosition().y(),
-			      thisCell->getPosition().z() );
-  }
-  
-  // the axis vector is the difference 
-  
-  //   const TruncatedPyramid* pyr 
-  //     = dynamic_cast< const TruncatedPyramid* > (thisCell);    
-  //   if( pyr ) {
-  //     axis.SetCoordinates( pyr->getPosition(1).x(), 
-  // 			 pyr->getPosition(1).y(), 
-  // 			 pyr->getPosition(1).z() ); 
-  
-  //     math::XYZVector axis0( pyr->getPosition(0).x(), 
-  // 			   pyr->getPosition(0).y(), 
-  // 			   pyr->getPosition(0).z() );
-  
-  //     axis -= axis0;    
-  //   }
-  //   else return 0;
-  
-  axis = math::XYZVector(0,0,0);
-  
-  //   if( !geomfound ) {
-  //     LogError("PFRecHitProducerHO")<<"cannor find geometry for detid "
-  // 				 <<detid.rawId()<<" in layer "<<layer<<endl;
-  //     return 0; // geometry not found, skip rechit
-  //   }
-  
-  
-  reco::PFRecHit *rh 
-    = new reco::PFRecHit( detid.rawId(), layer, 
-			  energy, 
-			  position.x(), position.y(), position.z(), 
-			  axis.x(), axis.y(), axis.z() ); 
+  // the cells at |z|>130 are scaled from the layer 0 
+  // to the layer 1 radius
+  const float (&position)[3] = geometry->position;
+  double scale = ringScale( position[2] );
   
-  const CaloCellGeometry::CornersVec& corners = thisCell->getCorners();
-  assert( corners.size() == 8 );
+  reco::PFRecHit& rh 
+    = newRecHit( rechits, detid.rawId(), layer, 
+		 energy, 
+		 scale*position[0], scale*position[1], scale*position[2] ); 
   
-  if (abs(corners[0].z())>130.0) {
-    rh->setNECorner( sclel0l1r*corners[0].x(), sclel0l1r*corners[0].y(),  sclel0l1r*corners[0].z() );
-    rh->setSECorner( sclel0l1r*corners[1].x(), sclel0l1r*corners[1].y(),  sclel0l1r*corners[1].z() );
-    rh->setSWCorner( sclel0l1r*corners[2].x(), sclel0l1r*corners[2].y(),  sclel0l1r*corners[2].z() );
-    rh->setNWCorner( sclel0l1r*corners[3].x(), sclel0l1r*corners[3].y(),  sclel0l1r*corners[3].z() );
-    
-  } else {
-    rh->setNECorner( corners[0].x(), corners[0].y(),  corners[0].z() );
-    rh->setSECorner( corners[1].x(), corners[1].y(),  corners[1].z() );
-    rh->setSWCorner( corners[2].x(), corners[2].y(),  corners[2].z() );
-    rh->setNWCorner( corners[3].x(), corners[3].y(),  corners[3].z() );
-  }
+  const float (&corners)[4][3] = geometry->corners;
+  double cornerScale = ringScale( corners[0][2] );
+  setCorners( rh, corners, cornerScale );
   
-  return rh;
+  return &rh;
 }
 
 
+
 bool
 PFRecHitProducerHO::findHORecHitGeometry(const DetId& detid, 
 					 const CaloSubdetectorGeometry* geom,
@@ -308,269 +275,8 @@ PFRecHitProducerHO::findHORecHitGeometry(const DetId& detid,
 void 
 PFRecHitProducerHO::findRecHitNeighboursHO
 ( reco::PFRecHit& rh, 
-  const HcalTopology& topo, 
-  const map<unsigned,unsigned >& sortedHits ) {
+  unsigned cell,
+  const PFRecHitDenseIndex& sortedHits ) const {
   
-  DetId center( rh.detId() );
-  
-  
-  DetId north = move( center, topo, NORTH );
-  DetId northeast = move( center, topo, NORTHEAST );
-  DetId northwest = move( center, topo, NORTHWEST ); 
-  DetId south = move( center, topo, SOUTH );  
-  DetId southeast = move( center, topo, SOUTHEAST );  
-  DetId southwest = move( center, topo, SOUTHWEST );  
-  DetId east  = move( center, topo, EAST );  
-  DetId west  = move( center, topo, WEST );  
-  
-  IDH i = sortedHits.find( north.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-  
-  i = sortedHits.find( northeast.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-  
-  i = sortedHits.find( south.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-  
-  i = sortedHits.find( southwest.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-  
-  i = sortedHits.find( east.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-  
-  i = sortedHits.find( southeast.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-  
-  i = sortedHits.find( west.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-  
-  i = sortedHits.find( northwest.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-}
-
-
-// Build the array of (max)8 neighbors
-void 
-PFRecHitProducerHO::hoNeighbArray(
-				  const CaloSubdetectorGeometry& barrelGeom,
-				  const HcalTopology& barrelTopo){
-  
-  static const CaloDirection orderedDir[8]={SOUTHWEST,
-					    SOUTH,
-					    SOUTHEAST,
-					    WEST,
-					    EAST,
-					    NORTHWEST,
-					    NORTH,
-                                            NORTHEAST};
-  
-  const unsigned nbarrel = 2160; //62000;
-  // Barrel first. The hashed index runs from 0 to 2199 61199
-  neighboursHO_.resize(barrelTopo.getHOSize());
-  
-  //std::cout << " Building the array of neighbours (barrel) " ;
-  
-  const std::vector<DetId>& vec(barrelGeom.getValidDetIds(DetId::Hcal,
-							  HcalOuter));
-  unsigned size=vec.size();    
-  for(unsigned ic=0; ic<size; ++ic) 
-    {
-      // We get the 9 cells in a square. 
-      std::vector<DetId> neighbours(barrelTopo.getWindow(vec[ic],3,3));
-      unsigned nneighbours=neighbours.size();
-      
-      unsigned hashedindex=barrelTopo.detId2denseIdHO(vec[ic]);
-      //           std::cout << " Cell " << ic<<" "<<vec[ic].rawId()<<" "<<HcalDetId(vec[ic]) <<" "<<hashedindex<<" "<<nneighbours<< std::endl;
-      if(hashedindex>=nbarrel)
-        {
-          LogDebug("CaloGeometryTools")  << " Array overflow " << std::endl;
-        }
-      
-      
-      // If there are 9 cells, it is easy, and this order is know:
-      //      6  7  8
-      //      3  4  5 
-      //      0  1  2   (0 = SOUTHWEST)
-      
-      if(nneighbours==9)
-        {
-          neighboursHO_[hashedindex].reserve(8);
-          for(unsigned in=0;in<nneighbours;++in)
-            {
-              // remove the centre
-              //    cout<<"ic "<<ic<<" "<<in<<" "<<neighbours[in].rawId()<<" "<<vec[ic].rawId()<<" "<<hashedindex<<endl; 
-              if(neighbours[in]!=vec[ic]) 
-                {
-                  neighboursHO_[hashedindex].push_back(neighbours[in]);
-		  //            std::cout << " Neighbour " << ic<<" "<<size<<" "<<in << " " <<hashedindex<<" "<< HcalDetId(neighbours[in]) << std::endl;
-                }
-            }
-        }
-      else
-        {
-          DetId central(vec[ic]);
-          neighboursHO_[hashedindex].resize(8,DetId(0));
-          for(unsigned idir=0;idir<8;++idir)
-            {
-              DetId testid=central;
-              bool status=stdmove(testid,orderedDir[idir],
-				  barrelTopo, barrelGeom);
-              if(status) neighboursHO_[hashedindex][idir]=testid;
-            }
-	  
-        }
-    }
-  
-  //    std::cout << " done " << size <<std::endl;
-  neighbourmapcalculated_ = true;
-}
-
-bool 
-PFRecHitProducerHO::stdsimplemove(DetId& cell, 
-				  const CaloDirection& dir,
-				  const CaloSubdetectorTopology& barrelTopo,
-				  const CaloSubdetectorGeometry& barrelGeom)
-  const {
-  
-  std::vector<DetId> neighbours;
-  
-  // BARREL CASE 
-  if(cell.subdetId()==HcalOuter) {
-    HcalDetId hoDetId = cell;
-    
-    neighbours = barrelTopo.getNeighbours(hoDetId,dir);
-    
-    // first try to move according to the standard navigation
-    if(neighbours.size()>0 && !neighbours[0].null()) {
-      cell = neighbours[0];
-      return true;
-    }
-    
-    // failed.
-    
-    
-  }
-  
-  // everything failed 
-  cell = DetId(0);
-  return false;
+  addNeighbours( rh, PFCaloCellCache::HCAL, cell, sortedHits );
 }
-
-
-
-bool 
-PFRecHitProducerHO::stdmove(DetId& cell, 
-			    const CaloDirection& dir,
-			    const CaloSubdetectorTopology& barrelTopo,
-			    const CaloSubdetectorGeometry& barrelGeom)
-  
-  const {
-  
-  
-  bool result; 
-  
-  if(dir==NORTH) {
-    result = stdsimplemove(cell,NORTH, barrelTopo, barrelGeom);
-    return result;
-  }
-  else if(dir==SOUTH) {
-    result = stdsimplemove(cell,SOUTH, barrelTopo, barrelGeom);
-    return result;
-  }
-  else if(dir==EAST) {
-    result = stdsimplemove(cell,EAST, barrelTopo, barrelGeom);
-    return result;
-  }
-  else if(dir==WEST) {
-    result = stdsimplemove(cell,WEST, barrelTopo, barrelGeom);
-    return result;
-  }
-  
-  
-  // One has to try both paths
-  else if(dir==NORTHEAST)
-    {
-      result = stdsimplemove(cell,NORTH, barrelTopo, barrelGeom);
-      if(result)
-        return stdsimplemove(cell,EAST, barrelTopo, barrelGeom);
-      else
-        {
-          result = stdsimplemove(cell,EAST, barrelTopo, barrelGeom);
-          if(result)
-            return stdsimplemove(cell,NORTH, barrelTopo, barrelGeom);
-          else
-            return false; 
-        }
-    }
-  else if(dir==NORTHWEST)
-    {
-      result = stdsimplemove(cell,NORTH, barrelTopo, barrelGeom );
-      if(result)
-        return stdsimplemove(cell,WEST, barrelTopo, barrelGeom );
-      else
-        {
-          result = stdsimplemove(cell,WEST, barrelTopo, barrelGeom );
-          if(result)
-            return stdsimplemove(cell,NORTH, barrelTopo, barrelGeom );
-          else
-            return false; 
-        }
-    }
-  else if(dir == SOUTHEAST)
-    {
-      result = stdsimplemove(cell,SOUTH, barrelTopo, barrelGeom );
-      if(result)
-        return stdsimplemove(cell,EAST, barrelTopo, barrelGeom );
-      else
-        {
-          result = stdsimplemove(cell,EAST, barrelTopo, barrelGeom );
-          if(result)
-            return stdsimplemove(cell,SOUTH, barrelTopo, barrelGeom );
-          else
-            return false; 
-        }
-    }
-  else if(dir == SOUTHWEST)
-    {
-      result = stdsimplemove(cell,SOUTH, barrelTopo, barrelGeom );
-      if(result)
-        return stdsimplemove(cell,WEST, barrelTopo, barrelGeom );
-      else
-        {
-          result = stdsimplemove(cell,SOUTH, barrelTopo, barrelGeom );
-          if(result)
-            return stdsimplemove(cell,WEST, barrelTopo, barrelGeom );
-          else
-            return false; 
-        }
-    }
-  cell = DetId(0);
-  return false;
-}
-
-DetId PFRecHitProducerHO::move(DetId cell, 
-			       const HcalTopology&topo,
-			       const CaloDirection&dir ) const
-{  
-  DetId originalcell = cell; 
-  if(dir==NONE || cell==DetId(0)) return false;
-  
-  // Conversion CaloDirection and index in the table
-  // CaloDirection :NONE,SOUTH,SOUTHEAST,SOUTHWEST,EAST,WEST, NORTHEAST,NORTHWEST,NORTH
-  // Table : SOUTHWEST,SOUTH,SOUTHEAST,WEST,EAST,NORTHWEST,NORTH, NORTHEAST
-  static const int calodirections[9]={-1,1,2,0,4,3,7,5,6};
-  
-  assert(neighbourmapcalculated_);
-  
-  DetId result = neighboursHO_[topo.detId2denseIdHO(originalcell)][calodirections[dir]];
-  return result; 
-}
-
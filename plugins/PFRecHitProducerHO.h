@@ -14,9 +14,9 @@
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
-#include "Geometry/CaloTopology/interface/CaloDirection.h"
-
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducer.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitDenseIndex.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFHCALQualityCache.h"
 #include "DataFormats/ParticleFlowReco/interface/PFLayer.h"
 
 #include "DataFormats/Math/interface/Vector3D.h"
@@ -28,7 +28,6 @@
 */
 
 class CaloSubdetectorTopology;
-class HcalTopology;
 class CaloSubdetectorGeometry;
 class DetId;
 
@@ -38,6 +37,14 @@ class PFRecHitProducerHO : public PFRecHitProducer {
   explicit PFRecHitProducerHO(const edm::ParameterSet&);
   ~PFRecHitProducerHO();
 
+  /// updates the channel quality cache
+  virtual void beginRun(const edm::Run& run, const edm::EventSetup & es) override;
+
+  /// \return the scale of the position and corners of a cell at z: 
+  /// the cells at |z|>130 are brought to the layer 0 radius. 
+  /// also used to rehydrate the slim rechits (PFRecHitProducerSlim)
+  static double ringScale( double z );
+
  private:
 
   // gets HO rechits, 
@@ -46,13 +53,14 @@ class PFRecHitProducerHO : public PFRecHitProducer {
 		     std::vector<reco::PFRecHit>& rechitsCleaned,
 		     edm::Event&, const edm::EventSetup&);
 
-  reco::PFRecHit*  createHORecHit( const DetId& detid,
-				     double energy,
-				     PFLayer::Layer layer,
-				   const CaloSubdetectorGeometry* geom);
-  //				     unsigned newDetId=0);
-
-
+  /// create a rechit at the end of rechits, for a cell 
+  /// (HcalTopology dense id). 
+  /// \return the new rechit, or 0 if the cell geometry is missing
+  reco::PFRecHit*  createHORecHit( std::vector<reco::PFRecHit>& rechits,
+				   const DetId& detid,
+				   unsigned cell,
+				   double energy,
+				   PFLayer::Layer layer ) const;
 
   /// find the position and the axis of the cell for a given rechit
   bool findHORecHitGeometry ( const DetId& detid, 
@@ -60,43 +68,28 @@ class PFRecHitProducerHO : public PFRecHitProducer {
 				math::XYZVector& position, 
 				math::XYZVector& axis );
 
-  /// find rechit neighbours, using the hashed index
-    void 
-      findRecHitNeighboursHO( reco::PFRecHit& rh, const HcalTopology& topo,
-  			      const std::map<unsigned,unsigned >& sortedHits );
+  /// find the neighbours of a rechit in cell (HcalTopology 
+  /// dense id), using the PFCaloCellCache table
+  void 
+    findRecHitNeighboursHO( reco::PFRecHit& rh, 
+			    unsigned cell, 
+			    const PFRecHitDenseIndex& sortedHits ) const;
 void
     findRecHitNeighbours( reco::PFRecHit& rh, 
 			  const std::map<unsigned,unsigned >& sortedHits, 
 			  const CaloSubdetectorTopology& barrelTopo,
 			  const CaloSubdetectorGeometry& barrelGeom); 
 
-  /// fill the vectors neighboursEB_ and neighboursEE_ 
-  /// which keep track of the neighbours of each rechit. 
-  /// to be called at the beginning of the run
-  void hoNeighbArray( const CaloSubdetectorGeometry& barrelGeom,
-			const HcalTopology& barrelTopo);
-
-  DetId move(DetId cell, const HcalTopology& barrelTopo, const CaloDirection& dir ) const;
-
-  bool stdsimplemove(DetId& cell, 
-		     const CaloDirection& dir,
-		     const CaloSubdetectorTopology& barrelTopo,
-		     const CaloSubdetectorGeometry& barrelGeom) const;
-
-  bool stdmove(DetId& cell, 
-	       const CaloDirection& dir,
-	       const CaloSubdetectorTopology& barrelTopo,
-	       const CaloSubdetectorGeometry& barrelGeom) const; 
-
   // ----------member data ---------------------------
   
 
  
-  /// for each HO barrel rechit, keep track of the neighbours
-  std::vector<std::vector<DetId> >  neighboursHO_;
+  /// index of the rechit in each cell, by HcalTopology dense id, 
+  /// for the event
+  PFRecHitDenseIndex  idSortedRecHits_;
 
-  /// set to true in hoNeighbArray
-  bool  neighbourmapcalculated_;
+  /// channel status words and severity levels
+  PFHCALQualityCache  hcalQuality_;
 
 //  // if true, navigation will cross the barrel-endcap border
 //  bool  crossBarrelEndcapBorder_;
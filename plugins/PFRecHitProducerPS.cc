@@ -8,6 +8,7 @@
 #include "DataFormats/EcalRecHit/interface/EcalRecHit.h"
 #include "DataFormats/EcalRecHit/interface/EcalRecHitCollections.h"
 #include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+#include "DataFormats/EcalDetId/interface/ESDetId.h"
 
 #include "DataFormats/DetId/interface/DetId.h"
 
@@ -15,15 +16,6 @@
 #include "FWCore/Framework/interface/ESHandle.h"
 #include "FWCore/Framework/interface/EventSetup.h"
 
-#include "Geometry/CaloGeometry/interface/CaloSubdetectorGeometry.h"
-#include "Geometry/CaloGeometry/interface/CaloGeometry.h"
-#include "Geometry/CaloGeometry/interface/CaloCellGeometry.h"
-#include "Geometry/CaloGeometry/interface/TruncatedPyramid.h"
-#include "Geometry/Records/interface/CaloGeometryRecord.h"
-
-#include "Geometry/CaloTopology/interface/EcalPreshowerTopology.h"
-#include "RecoCaloTools/Navigation/interface/CaloNavigator.h"
-
 
 
 using namespace std;
@@ -51,29 +43,22 @@ void PFRecHitProducerPS::createRecHits(vector<reco::PFRecHit>& rechits,
 				       edm::Event& iEvent, 
 				       const edm::EventSetup& iSetup) {
 
-  map<unsigned, unsigned > idSortedRecHits;
-  typedef map<unsigned, unsigned >::iterator IDH;
-
+  // this index is necessary to find the rechit neighbours efficiently
+  // the key is the ESDetId hashed index.
+  // the value is the index in the rechits vector
+  PFRecHitDenseIndex& idSortedRecHits = idSortedRecHits_;
+  idSortedRecHits.newEvent();
+  idSortedRecHits.resize( ESDetId::kSizeForDenseIndexing );
 
-  // get the ps geometry
-  edm::ESHandle<CaloGeometry> geoHandle;
-  iSetup.get<CaloGeometryRecord>().get(geoHandle);
-    
-  const CaloSubdetectorGeometry *psGeometry = 
-    geoHandle->getSubdetectorGeometry(DetId::Ecal, EcalPreshower);
-    
 
   // ShR 28 Jul 2008: check if geometry is NULL. If so we are using
   // partial CMS gemoetry in Pilot1/2 scenarios which do not include the preshower
-  if(!psGeometry) {
+  if( cellCache_->size( PFCaloCellCache::PS ) == 0 ) {
     LogDebug("PFRecHitProducerPS") << "No EcalPreshower geometry available. putting empty PS rechits collection in event";
     return;
   }
 
 
-  // get the ps topology
-  EcalPreshowerTopology psTopology(geoHandle);
-
   // process rechits
   Handle< EcalRecHitCollection >   pRecHits;
 
@@ -94,6 +79,7 @@ void PFRecHitProducerPS::createRecHits(vector<reco::PFRecHit>& rechits,
 
     const EcalRecHitCollection& psrechits = *( pRecHits.product() );
     typedef EcalRecHitCollection::const_iterator IT;
+    rechits.reserve( psrechits.size() );
  
     for(IT i=psrechits.begin(); i!=psrechits.end(); i++) {
       const EcalRecHit& hit = *i;
@@ -102,7 +88,8 @@ void PFRecHitProducerPS::createRecHits(vector<reco::PFRecHit>& rechits,
       if( energy < thresh_Endcap_ ) continue; 
             
       const ESDetId& detid = hit.detid();
-      const CaloCellGeometry *thisCell = psGeometry->getGeometry(detid);
+      const PFCaloCellCache::Cell* thisCell = 
+	cellCache_->cell( PFCaloCellCache::PS, detid.hashedIndex() );
      
       if(!thisCell) {
 	LogError("PFRecHitProducerPS")<<"warning detid "<<detid.rawId()
@@ -110,8 +97,11 @@ void PFRecHitProducerPS::createRecHits(vector<reco::PFRecHit>& rechits,
 				     <<endl;
 	return;
       }
+
+      // regional mode: outside the regions of interest
+      if( !inRegions( *thisCell ) ) continue;
       
-      const GlobalPoint& position = thisCell->getPosition();
+      const float (&position)[3] = thisCell->position;
      
       PFLayer::Layer layer = PFLayer::NONE;
             
@@ -129,150 +119,34 @@ void PFRecHitProducerPS::createRecHits(vector<reco::PFRecHit>& rechits,
 	assert(0);
       }
  
-      reco::PFRecHit *pfrh
-	= new reco::PFRecHit( detid.rawId(), layer, energy, 
-			      position.x(), position.y(), position.z(), 
-			      0,0,0 );
-      
-      const CaloCellGeometry::CornersVec& corners = thisCell->getCorners();
-      assert( corners.size() == 8 );
+      reco::PFRecHit& pfrh
+	= newRecHit( rechits, detid.rawId(), layer, energy, 
+		     position[0], position[1], position[2] );
       
-      pfrh->setNECorner( corners[0].x(), corners[0].y(),  corners[0].z() );
-      pfrh->setSECorner( corners[1].x(), corners[1].y(),  corners[1].z() );
-      pfrh->setSWCorner( corners[2].x(), corners[2].y(),  corners[2].z() );
-      pfrh->setNWCorner( corners[3].x(), corners[3].y(),  corners[3].z() );
+      setCorners( pfrh, thisCell->corners );
 
-      
-      // if( !pfrh ) continue; // problem with this rechit. skip it
-
-      rechits.push_back( *pfrh );
-      delete pfrh;
-      idSortedRecHits.insert( make_pair(detid.rawId(), rechits.size()-1 ) );   
+      idSortedRecHits.insert( detid.hashedIndex(), rechits.size()-1 );   
     }
   }
 
+  // optionally, along a space-filling curve
+  sortRecHits( rechits, idSortedRecHits, 
+	       []( unsigned id ) { return ESDetId( id ).hashedIndex(); } );
+
   // do navigation
-  for(unsigned i=0; i<rechits.size(); i++ ) {
-    
-    findRecHitNeighbours( rechits[i], idSortedRecHits, 
-			  psTopology, 
-			  *psGeometry, 
-			  psTopology,
-			  *psGeometry);
-  }
+  for(unsigned i=0; i<rechits.size(); i++ ) 
+    findRecHitNeighboursPS( rechits[i],
+			    ESDetId( rechits[i].detId() ).hashedIndex(),
+			    idSortedRecHits );
 }
 
 
 
 void 
-PFRecHitProducerPS::findRecHitNeighbours
+PFRecHitProducerPS::findRecHitNeighboursPS
 ( reco::PFRecHit& rh, 
-  const map<unsigned,unsigned >& sortedHits, 
-  const CaloSubdetectorTopology& barrelTopology, 
-  const CaloSubdetectorGeometry& barrelGeometry, 
-  const CaloSubdetectorTopology& endcapTopology, 
-  const CaloSubdetectorGeometry& endcapGeometry ) {
-  
-  DetId detid( rh.detId() );
-
-  const CaloSubdetectorTopology* topology = 0;
-  const CaloSubdetectorGeometry* geometry = 0;
-  
-  switch( rh.layer() ) {
-  case PFLayer::ECAL_ENDCAP: 
-    topology = &endcapTopology;
-    geometry = &endcapGeometry;
-    break;
-  case PFLayer::ECAL_BARREL: 
-    topology = &barrelTopology;
-    geometry = &barrelGeometry;
-    break;
-  case PFLayer::HCAL_ENDCAP:
-    topology = &endcapTopology;
-    geometry = &endcapGeometry;
-    break;
-  case PFLayer::HCAL_BARREL1:
-    topology = &barrelTopology;
-    geometry = &barrelGeometry;
-    break;
-  case PFLayer::PS1:
-  case PFLayer::PS2:
-    topology = &barrelTopology;
-    geometry = &barrelGeometry;
-    break;
-  default:
-    assert(0);
-  }
+  unsigned strip,
+  const PFRecHitDenseIndex& sortedHits ) const {
   
-  assert( topology && geometry );
-
-  CaloNavigator<DetId> navigator(detid, topology);
-
-  DetId north = navigator.north();  
-  
-  DetId northeast(0);
-  if( north != DetId(0) ) {
-    northeast = navigator.east();  
-  }
-  navigator.home();
-
-
-  DetId south = navigator.south();
-
-  
-
-  DetId southwest(0); 
-  if( south != DetId(0) ) {
-    southwest = navigator.west();
-  }
-  navigator.home();
-
-
-  DetId east = navigator.east();
-  DetId southeast;
-  if( east != DetId(0) ) {
-    southeast = navigator.south(); 
-  }
-  navigator.home();
-  DetId west = navigator.west();
-  DetId northwest;
-  if( west != DetId(0) ) {   
-    northwest = navigator.north();  
-  }
-  navigator.home();
-    
-  IDH i = sortedHits.find( north.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-  
-  i = sortedHits.find( northeast.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-  
-  i = sortedHits.find( south.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-    
-  i = sortedHits.find( southwest.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-  i = sortedHits.find( east.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add4Neighbour( i->second );
-    
-  i = sortedHits.find( southeast.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-  i = sortedHits.find( west.rawId() );
-  if(i != sortedHits.end() ) 
-     rh.add4Neighbour( i->second );
-   
-  i = sortedHits.find( northwest.rawId() );
-  if(i != sortedHits.end() ) 
-    rh.add8Neighbour( i->second );
-    
-
+  addNeighbours( rh, PFCaloCellCache::PS, strip, sortedHits );
 }
-
@@ -14,8 +14,8 @@
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
-#include "Geometry/CaloTopology/interface/CaloDirection.h"
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducer.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitDenseIndex.h"
 
 /**\class PFRecHitProducerPS 
 \brief Producer for particle flow rechits (PFRecHit) 
@@ -24,8 +24,6 @@
 \date   february 2008
 */
 
-class CaloSubdetectorTopology;
-class CaloSubdetectorGeometry;
 class DetId;
 
 
@@ -33,7 +31,6 @@ class PFRecHitProducerPS : public PFRecHitProducer {
  public:
   explicit PFRecHitProducerPS(const edm::ParameterSet&);
   ~PFRecHitProducerPS();
-  
 
  private:
 
@@ -47,18 +44,19 @@ class PFRecHitProducerPS : public PFRecHitProducer {
 
 
 
-  /// find and set the neighbours to a given rechit
-  /// this works for ecal, hcal, ps
-  ///COLIN remonter cette fonction dans la classe de base 
+  /// find and set the neighbours of the rechit in strip 
+  /// (ESDetId hashed index), using the PFCaloCellCache table
   void 
-    findRecHitNeighbours( reco::PFRecHit& rh, 
-			  const std::map<unsigned,unsigned >& sortedHits, 
-			  const CaloSubdetectorTopology& barrelTopo,
-			  const CaloSubdetectorGeometry& barrelGeom, 
-			  const CaloSubdetectorTopology& endcapTopo,
-			  const CaloSubdetectorGeometry& endcapGeom );
+    findRecHitNeighboursPS( reco::PFRecHit& rh, 
+			    unsigned strip,
+			    const PFRecHitDenseIndex& sortedHits ) const;
   
   // ----------member data ---------------------------
+
+  /// index of the rechit in each strip, by ESDetId hashed index, 
+  /// for the event
+  PFRecHitDenseIndex  idSortedRecHits_;
+
    
   edm::InputTag    inputTagEcalRecHitsES_;
 };
@@ -0,0 +1,220 @@
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducerSlim.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducer.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducerHO.h"
+#include "RecoParticleFlow/PFClusterProducer/interface/PFClusterAlgo.h"
+
+#include <memory>
+
+#include "DataFormats/Common/interface/OrphanHandle.h"
+#include "DataFormats/DetId/interface/DetId.h"
+#include "DataFormats/EcalDetId/interface/ESDetId.h"
+#include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+#include "DataFormats/HcalDetId/interface/HcalSubdetector.h"
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/Framework/interface/ESHandle.h"
+#include "FWCore/Framework/interface/EventSetup.h"
+
+#include "Geometry/Records/interface/CaloGeometryRecord.h"
+#include "Geometry/Records/interface/IdealGeometryRecord.h"
+#include "Geometry/CaloTopology/interface/HcalTopology.h"
+
+using namespace std;
+using namespace edm;
+
+
+PFRecHitProducerSlim::PFRecHitProducerSlim(const edm::ParameterSet& iConfig)
+{
+
+  verbose_ =
+    iConfig.getUntrackedParameter<bool>("verbose",false);
+
+  inputTagSlimRecHits_ =
+    iConfig.getParameter<InputTag>("slimRecHits");
+
+  inputTagPFClusters_ = 
+    iConfig.getParameter<InputTag>("PFClusters");
+
+  cellCache_ = 0;
+  hcalTopology_ = 0;
+
+  //register products
+  produces<reco::PFRecHitCollection>();
+  if( !inputTagPFClusters_.label().empty() ) 
+    produces<reco::PFClusterCollection>();
+}
+
+
+
+PFRecHitProducerSlim::~PFRecHitProducerSlim() {}
+
+
+
+void
+PFRecHitProducerSlim::beginRun(const edm::Run& run,
+			       const edm::EventSetup& es) {
+
+  edm::ESHandle<PFCaloCellCache> cellCache;
+  es.get<CaloGeometryRecord>().get(cellCache);
+  cellCache_ = cellCache.product();
+
+  edm::ESHandle<HcalTopology> hcalTopology;
+  es.get<IdealGeometryRecord>().get( hcalTopology );
+  hcalTopology_ = hcalTopology.product();
+}
+
+
+
+void PFRecHitProducerSlim::produce(edm::Event& iEvent,
+				   const edm::EventSetup& iSetup) {
+
+  edm::Handle<reco::PFRecHitSlim> slimHandle;
+  bool found = iEvent.getByLabel( inputTagSlimRecHits_, slimHandle );
+
+  if(!found) {
+    ostringstream err;
+    err<<"could not find slim rechits "<<inputTagSlimRecHits_;
+    LogError("PFRecHitProducerSlim")<<err.str()<<endl;
+
+    throw cms::Exception( "MissingProduct", err.str());
+  }
+
+  const reco::PFRecHitSlim& slim = *slimHandle;
+
+  auto_ptr< vector<reco::PFRecHit> > recHits( new vector<reco::PFRecHit> );
+  recHits->reserve( slim.size() );
+
+  for(unsigned i=0; i<slim.size(); ++i) {
+    createRecHit( *recHits, slim.detId[i], slim.energy[i] );
+
+    reco::PFRecHit& rh = recHits->back();
+    rh.setRescale( slim.time[i] );
+
+    const unsigned end = slim.neighbourOffsets[i+1];
+    const unsigned end4 = slim.neighbourOffsets[i] + slim.nNeighbours4[i];
+    for(unsigned in=slim.neighbourOffsets[i]; in<end; ++in) {
+      if( in < end4 ) rh.add4Neighbour( slim.neighbours[in] );
+      else rh.add8Neighbour( slim.neighbours[in] );
+    }
+  }
+
+  if(verbose_)
+    LogInfo("PFRecHitProducerSlim")
+      <<"rehydrated "<<recHits->size()<<" rechits from "
+      <<inputTagSlimRecHits_<<endl;
+
+  edm::OrphanHandle<reco::PFRecHitCollection> rechitsHandle = 
+    iEvent.put( recHits );
+
+  if( inputTagPFClusters_.label().empty() ) return;
+
+  // the clusters of the original rechits, 
+  // pointing to the rehydrated ones
+  edm::Handle<reco::PFClusterCollection> clustersHandle;
+  found = iEvent.getByLabel( inputTagPFClusters_, clustersHandle );
+
+  if(!found) {
+    ostringstream err;
+    err<<"could not find clusters "<<inputTagPFClusters_;
+    LogError("PFRecHitProducerSlim")<<err.str()<<endl;
+
+    throw cms::Exception( "MissingProduct", err.str());
+  }
+
+  auto_ptr< vector<reco::PFCluster> > 
+    clusters( new vector<reco::PFCluster>( *clustersHandle ) );
+  for(unsigned ic=0; ic<clusters->size(); ++ic) {
+    if( !PFClusterAlgo::rebindRecHitRefs( (*clusters)[ic], rechitsHandle ) ) {
+      ostringstream err;
+      err<<"cluster "<<ic<<" of "<<inputTagPFClusters_
+	 <<" refers to a rechit missing in "<<inputTagSlimRecHits_;
+      LogError("PFRecHitProducerSlim")<<err.str()<<endl;
+
+      throw cms::Exception( "InvalidReference", err.str());
+    }
+  }
+
+  iEvent.put( clusters );
+}
+
+
+
+void
+PFRecHitProducerSlim::createRecHit( vector<reco::PFRecHit>& rechits,
+				    unsigned detId, double energy ) const {
+
+  // the layer and the cell of the rechit, as in the
+  // ECAL, PS and HO PFRecHitProducers
+  DetId detid( detId );
+  PFLayer::Layer layer = PFLayer::NONE;
+  const PFCaloCellCache::Cell* cell = 0;
+  if( detid.det() == DetId::Ecal ) {
+    switch( detid.subdetId() ) {
+    case EcalBarrel:
+      layer = PFLayer::ECAL_BARREL;
+      break;
+    case EcalEndcap:
+      layer = PFLayer::ECAL_ENDCAP;
+      break;
+    case EcalPreshower:
+      layer = ESDetId( detid ).plane() == 1 ? PFLayer::PS1 : PFLayer::PS2;
+      cell = cellCache_->cell( PFCaloCellCache::PS,
+			       ESDetId( detid ).hashedIndex() );
+      break;
+    default:
+      break;
+    }
+    if( layer == PFLayer::ECAL_BARREL || layer == PFLayer::ECAL_ENDCAP )
+      cell = cellCache_->cell( PFCaloCellCache::ECAL,
+			       PFCaloCellCache::ecalDenseIndex( detid ) );
+  }
+  else if( detid.det() == DetId::Hcal &&
+	   detid.subdetId() == HcalOuter ) {
+    layer = PFLayer::HCAL_BARREL2;
+    cell = cellCache_->cell( PFCaloCellCache::HCAL,
+			     hcalTopology_->detId2denseId( detid ) );
+  }
+
+  if( !cell ) {
+    LogError("PFRecHitProducerSlim")
+      <<"warning detid "<<detId
+      <<" not found in geometry"<<endl;
+    rechits.push_back( reco::PFRecHit( detId, layer, energy, 0., 0., 0.,
+				       0., 0., 0. ) );
+    return;
+  }
+
+  const float (&position)[3] = cell->position;
+  const float (&corners)[4][3] = cell->corners;
+
+  switch( layer ) {
+  case PFLayer::ECAL_BARREL:
+  case PFLayer::ECAL_ENDCAP:
+    {
+      const double (&axis)[3] = cell->axis;
+      rechits.push_back( reco::PFRecHit( detId, layer, energy,
+					 position[0], position[1], position[2],
+					 axis[0], axis[1], axis[2] ) );
+      PFRecHitProducer::setCorners( rechits.back(), corners );
+    }
+    break;
+  case PFLayer::HCAL_BARREL2:
+    {
+      double scale = PFRecHitProducerHO::ringScale( position[2] );
+      rechits.push_back( reco::PFRecHit( detId, layer, energy,
+					 scale*position[0],
+					 scale*position[1],
+					 scale*position[2],
+					 0., 0., 0. ) );
+      PFRecHitProducer::setCorners( rechits.back(), corners,
+				    PFRecHitProducerHO::ringScale( corners[0][2] ) );
+    }
+    break;
+  default:
+    rechits.push_back( reco::PFRecHit( detId, layer, energy,
+				       position[0], position[1], position[2],
+				       0., 0., 0. ) );
+    PFRecHitProducer::setCorners( rechits.back(), corners );
+    break;
+  }
+}
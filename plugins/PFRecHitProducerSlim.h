@@ -0,0 +1,78 @@
+#ifndef RecoParticleFlow_PFClusterProducer_PFRecHitProducerSlim_h_
+#define RecoParticleFlow_PFClusterProducer_PFRecHitProducerSlim_h_
+
+// system include files
+#include <memory>
+#include <vector>
+
+// user include files
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/EDProducer.h"
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "DataFormats/ParticleFlowReco/interface/PFRecHit.h"
+#include "DataFormats/ParticleFlowReco/interface/PFRecHitFwd.h"
+#include "DataFormats/ParticleFlowReco/interface/PFLayer.h"
+#include "DataFormats/ParticleFlowReco/interface/PFCluster.h"
+#include "DataFormats/ParticleFlowReco/interface/PFClusterFwd.h"
+#include "RecoParticleFlow/PFClusterProducer/interface/PFCaloCellCache.h"
+#include "RecoParticleFlow/PFClusterProducer/interface/PFRecHitSlim.h"
+
+/**\class PFRecHitProducerSlim
+\brief Rehydrates the particle flow rechits (PFRecHit) written out
+as a reco::PFRecHitSlim
+
+The position, axis and corners of the rechits are taken from the
+PFCaloCellCache, as done by the ECAL, HO and PS PFRecHitProducers.
+The rechits are made in the order of the PFRecHitSlim, so that the
+neighbour indices stay valid. The PFClusters written out with the 
+original rechits point to the dropped collection: if PFClusters is 
+set, they are copied and put by this module, with their rechit 
+references pointing to the rehydrated rechits of the same indices.
+*/
+
+class HcalTopology;
+
+class PFRecHitProducerSlim : public edm::EDProducer {
+
+ public:
+  explicit PFRecHitProducerSlim(const edm::ParameterSet&);
+  ~PFRecHitProducerSlim();
+
+  /// gets the cell geometry
+  virtual void beginRun(const edm::Run& run, const edm::EventSetup & es) override;
+
+  void produce(edm::Event& iEvent,
+	       const edm::EventSetup& iSetup) override;
+
+ private:
+
+  /// make the rechit of detId at the end of rechits, with
+  /// the geometry of its cell. the rechit is made at the origin
+  /// if the cell is not in the geometry, to keep the indices valid
+  void createRecHit( std::vector<reco::PFRecHit>& rechits,
+		     unsigned detId, double energy ) const;
+
+  // ----------member data ---------------------------
+
+  /// verbose ?
+  bool   verbose_;
+
+  /// cell geometry, shared with the PFRecHit producers
+  const PFCaloCellCache* cellCache_;
+
+  /// for the dense index of the HO cells
+  const HcalTopology* hcalTopology_;
+
+  // ----------access to event data
+  edm::InputTag    inputTagSlimRecHits_;
+
+  /// clusters of the original rechits, none if the label is empty
+  edm::InputTag    inputTagPFClusters_;
+};
+
+#endif
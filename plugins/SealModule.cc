@@ -1,12 +1,22 @@
 #include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/Framework/interface/ModuleFactory.h"
 
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFClusterProducer.h"
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFHCALSuperClusterProducer.h"
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducerECAL.h"
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducerHCAL.h"
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFHCALDualTimeRecHitProducer.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFHCALCombinedRecHitProducer.h"
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducerHO.h"
 #include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducerPS.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitProducerSlim.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFCaloCellCacheESProducer.h"
+#include "RecoParticleFlow/PFClusterProducer/plugins/PFRecHitClusterProducer.h"
+
+typedef PFRecHitClusterProducer<PFRecHitProducerECAL> PFRecHitClusterProducerECAL;
+typedef PFRecHitClusterProducer<PFRecHitProducerHCAL> PFRecHitClusterProducerHCAL;
+typedef PFRecHitClusterProducer<PFRecHitProducerHO>   PFRecHitClusterProducerHO;
+typedef PFRecHitClusterProducer<PFRecHitProducerPS>   PFRecHitClusterProducerPS;
 
 
 
@@ -16,5 +26,12 @@ DEFINE_FWK_MODULE(PFHCALSuperClusterProducer);
 DEFINE_FWK_MODULE(PFRecHitProducerECAL);
 DEFINE_FWK_MODULE(PFRecHitProducerHCAL);
 DEFINE_FWK_MODULE(PFHCALDualTimeRecHitProducer);
+DEFINE_FWK_MODULE(PFHCALCombinedRecHitProducer);
 DEFINE_FWK_MODULE(PFRecHitProducerHO);
 DEFINE_FWK_MODULE(PFRecHitProducerPS);
+DEFINE_FWK_MODULE(PFRecHitProducerSlim);
+DEFINE_FWK_MODULE(PFRecHitClusterProducerECAL);
+DEFINE_FWK_MODULE(PFRecHitClusterProducerHCAL);
+DEFINE_FWK_MODULE(PFRecHitClusterProducerHO);
+DEFINE_FWK_MODULE(PFRecHitClusterProducerPS);
+DEFINE_FWK_EVENTSETUP_MODULE(PFCaloCellCacheESProducer);
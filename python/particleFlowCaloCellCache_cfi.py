@@ -0,0 +1,10 @@
+import FWCore.ParameterSet.Config as cms
+
+# cell geometry and neighbour tables shared by the PFRecHit producers
+particleFlowCaloCellCache = cms.ESProducer("PFCaloCellCacheESProducer",
+    # the ECAL neighbour tables are built with and without the 
+    # barrel-endcap border crossing, each producer chooses one
+    # prefix of the files caching the neighbour tables between jobs
+    # (no caching if empty)
+    neighbourCacheFile = cms.untracked.string("")
+)
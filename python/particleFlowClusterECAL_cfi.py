@@ -5,6 +5,9 @@ particleFlowClusterECAL = cms.EDProducer("PFClusterProducer",
     verbose = cms.untracked.bool(False),
     # PFRecHit collection          
     PFRecHits = cms.InputTag("particleFlowRecHitECAL"),
+    # seeds of the regions of interest, for the regional clustering
+    # (see particleFlowClusterRegional_cff). empty: the whole detector
+    regionSeeds = cms.VInputTag(),
     #PFCluster Collection name
     #PFClusterCollectionName =  cms.string("ECAL"),                                
     #----all thresholds are in GeV
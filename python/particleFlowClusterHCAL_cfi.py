@@ -5,6 +5,9 @@ particleFlowClusterHCAL = cms.EDProducer("PFClusterProducer",
     verbose = cms.untracked.bool(False),
     # PFRecHit collection                                  
     PFRecHits = cms.InputTag("particleFlowRecHitHCAL"),
+    # seeds of the regions of interest, for the regional clustering
+    # (see particleFlowClusterRegional_cff). empty: the whole detector
+    regionSeeds = cms.VInputTag(),
     #----all thresholds are in GeV
     # seed threshold in HCAL barrel 
     thresh_Seed_Barrel = cms.double(0.8),
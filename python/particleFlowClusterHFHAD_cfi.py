@@ -5,6 +5,9 @@ particleFlowClusterHFHAD = cms.EDProducer("PFClusterProducer",
     verbose = cms.untracked.bool(False),
     # PFRecHit collection                                  
     PFRecHits = cms.InputTag("particleFlowRecHitHCAL","HFHAD"),
+    # seeds of the regions of interest, for the regional clustering
+    # (see particleFlowClusterRegional_cff). empty: the whole detector
+    regionSeeds = cms.VInputTag(),
     #PFCluster Collection name
     #PFClusterCollectionName =  cms.string("HFHAD"),                                
     #----all thresholds are in GeV
@@ -6,6 +6,9 @@ particleFlowClusterHO = cms.EDProducer("PFClusterProducer",
     verbose = cms.untracked.bool(False),
     # PFRecHit collection          
     PFRecHits = cms.InputTag("particleFlowRecHitHO"),
+    # seeds of the regions of interest, for the regional clustering
+    # (see particleFlowClusterRegional_cff). empty: the whole detector
+    regionSeeds = cms.VInputTag(),
 
     # seed threshold in HO barrel 
     thresh_Seed_Barrel = cms.double(1.0),
@@ -5,6 +5,9 @@ particleFlowClusterPS = cms.EDProducer("PFClusterProducer",
     verbose = cms.untracked.bool(False),
     # PFRecHit collection
     PFRecHits = cms.InputTag("particleFlowRecHitPS"),
+    # seeds of the regions of interest, for the regional clustering
+    # (see particleFlowClusterRegional_cff). empty: the whole detector
+    regionSeeds = cms.VInputTag(),
     #PFCluster Collection name
     #PFClusterCollectionName =  cms.string("PS"),
     #----all thresholds are in GeV
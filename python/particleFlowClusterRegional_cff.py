@@ -0,0 +1,88 @@
+import FWCore.ParameterSet.Config as cms
+
+# regional particle flow clustering, for the trigger paths which only
+# look at a few eta-phi regions. The rechits are made within
+# regionDeltaEta (regionDeltaPhi) + regionMargin of the region seeds, 
+# and only those within regionDeltaEta (regionDeltaPhi) can be seeds. 
+# The clusters grow over all the rechits, those in the margin included: 
+# a cluster seeded in a region is the same as in the global clustering 
+# as long as it does not reach the outer edge of the margin.
+
+from RecoParticleFlow.PFClusterProducer.particleFlowCluster_cff import *
+
+pfClusteringRegions = cms.PSet(
+    # seeds of the regions (any collection of candidates)
+    regionSeeds = cms.VInputTag(
+        cms.InputTag("l1extraParticles","Isolated"),
+        cms.InputTag("l1extraParticles","NonIsolated"),
+        cms.InputTag("l1extraParticles","Central"),
+        cms.InputTag("l1extraParticles","Tau"),
+        cms.InputTag("l1extraParticles","Forward")
+    ),
+    # half widths of the regions
+    regionDeltaEta = cms.double(0.5),
+    regionDeltaPhi = cms.double(0.5)
+)
+
+particleFlowRecHitECALRegional = particleFlowRecHitECAL.clone(
+    regionMargin = cms.double(0.1),
+    **pfClusteringRegions.parameters_()
+)
+particleFlowClusterECALRegional = particleFlowClusterECAL.clone(
+    PFRecHits = cms.InputTag("particleFlowRecHitECALRegional"),
+    **pfClusteringRegions.parameters_()
+)
+
+particleFlowRecHitHCALRegional = particleFlowRecHitHCAL.clone(
+    regionMargin = cms.double(0.2),
+    **pfClusteringRegions.parameters_()
+)
+particleFlowClusterHCALRegional = particleFlowClusterHCAL.clone(
+    PFRecHits = cms.InputTag("particleFlowRecHitHCALRegional"),
+    **pfClusteringRegions.parameters_()
+)
+particleFlowClusterHFEMRegional = particleFlowClusterHFEM.clone(
+    PFRecHits = cms.InputTag("particleFlowRecHitHCALRegional","HFEM"),
+    **pfClusteringRegions.parameters_()
+)
+particleFlowClusterHFHADRegional = particleFlowClusterHFHAD.clone(
+    PFRecHits = cms.InputTag("particleFlowRecHitHCALRegional","HFHAD"),
+    **pfClusteringRegions.parameters_()
+)
+
+particleFlowRecHitHORegional = particleFlowRecHitHO.clone(
+    regionMargin = cms.double(0.2),
+    **pfClusteringRegions.parameters_()
+)
+particleFlowClusterHORegional = particleFlowClusterHO.clone(
+    PFRecHits = cms.InputTag("particleFlowRecHitHORegional"),
+    **pfClusteringRegions.parameters_()
+)
+
+particleFlowRecHitPSRegional = particleFlowRecHitPS.clone(
+    regionMargin = cms.double(0.1),
+    **pfClusteringRegions.parameters_()
+)
+particleFlowClusterPSRegional = particleFlowClusterPS.clone(
+    PFRecHits = cms.InputTag("particleFlowRecHitPSRegional"),
+    **pfClusteringRegions.parameters_()
+)
+
+pfClusteringECALRegional = cms.Sequence(particleFlowRecHitECALRegional*
+                                        particleFlowClusterECALRegional)
+pfClusteringHCALRegional = cms.Sequence(particleFlowRecHitHCALRegional*
+                                        (particleFlowClusterHCALRegional+
+                                         particleFlowClusterHFHADRegional+
+                                         particleFlowClusterHFEMRegional))
+pfClusteringHORegional = cms.Sequence(particleFlowRecHitHORegional*
+                                      particleFlowClusterHORegional)
+pfClusteringPSRegional = cms.Sequence(particleFlowRecHitPSRegional*
+                                      particleFlowClusterPSRegional)
+
+particleFlowClusterRegional = cms.Sequence(
+    towerMakerPF*
+    pfClusteringECALRegional*
+    pfClusteringHCALRegional*
+    pfClusteringHORegional*
+    pfClusteringPSRegional
+)
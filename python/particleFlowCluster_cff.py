@@ -4,6 +4,7 @@ import Geometry.HcalEventSetup.hcalTopologyIdeal_cfi
 
 from RecoLocalCalo.CaloTowersCreator.calotowermaker_cfi import *
 from RecoJets.Configuration.CaloTowersRec_cff import *
+from RecoParticleFlow.PFClusterProducer.particleFlowCaloCellCache_cfi import *
 from RecoParticleFlow.PFClusterProducer.particleFlowRecHitECAL_cfi import *
 from RecoParticleFlow.PFClusterProducer.particleFlowRecHitHCAL_cfi import *
 from RecoParticleFlow.PFClusterProducer.particleFlowRecHitHO_cfi import *
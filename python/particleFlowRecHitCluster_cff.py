@@ -0,0 +1,54 @@
+import FWCore.ParameterSet.Config as cms
+
+# rechits and clusters made in a single module, for the paths in which 
+# the PFRecHits are not needed in the event (e.g. HLT). 
+# The rechits are always put in the event, for the clusters to refer 
+# to them: drop them in the output module if they are not needed.
+
+from RecoParticleFlow.PFClusterProducer.particleFlowCaloCellCache_cfi import *
+from RecoParticleFlow.PFClusterProducer.particleFlowRecHitECAL_cfi import *
+from RecoParticleFlow.PFClusterProducer.particleFlowRecHitHCAL_cfi import *
+from RecoParticleFlow.PFClusterProducer.particleFlowRecHitHO_cfi import *
+from RecoParticleFlow.PFClusterProducer.particleFlowRecHitPS_cfi import *
+
+from RecoParticleFlow.PFClusterProducer.particleFlowClusterECAL_cfi import *
+from RecoParticleFlow.PFClusterProducer.particleFlowClusterHCAL_cfi import *
+from RecoParticleFlow.PFClusterProducer.particleFlowClusterHO_cfi import *
+from RecoParticleFlow.PFClusterProducer.particleFlowClusterPS_cfi import *
+from RecoParticleFlow.PFClusterProducer.particleFlowClusterHFEM_cfi import *
+from RecoParticleFlow.PFClusterProducer.particleFlowClusterHFHAD_cfi import *
+
+particleFlowRecHitClusterECAL = cms.EDProducer("PFRecHitClusterProducerECAL",
+    clustering = cms.PSet( **particleFlowClusterECAL.parameters_() ),
+    **particleFlowRecHitECAL.parameters_()
+)
+
+particleFlowRecHitClusterHCAL = cms.EDProducer("PFRecHitClusterProducerHCAL",
+    clustering = cms.PSet( **particleFlowClusterHCAL.parameters_() ),
+    **particleFlowRecHitHCAL.parameters_()
+)
+
+particleFlowRecHitClusterHO = cms.EDProducer("PFRecHitClusterProducerHO",
+    clustering = cms.PSet( **particleFlowClusterHO.parameters_() ),
+    **particleFlowRecHitHO.parameters_()
+)
+
+particleFlowRecHitClusterPS = cms.EDProducer("PFRecHitClusterProducerPS",
+    clustering = cms.PSet( **particleFlowClusterPS.parameters_() ),
+    **particleFlowRecHitPS.parameters_()
+)
+
+# the HF rechits are still put in the event by the HCAL module
+particleFlowClusterHFEMFused = particleFlowClusterHFEM.clone(
+    PFRecHits = cms.InputTag("particleFlowRecHitClusterHCAL","HFEM")
+)
+particleFlowClusterHFHADFused = particleFlowClusterHFHAD.clone(
+    PFRecHits = cms.InputTag("particleFlowRecHitClusterHCAL","HFHAD")
+)
+
+pfRecHitClusteringECAL = cms.Sequence(particleFlowRecHitClusterECAL)
+pfRecHitClusteringHCAL = cms.Sequence(particleFlowRecHitClusterHCAL*
+                                      (particleFlowClusterHFHADFused+
+                                       particleFlowClusterHFEMFused))
+pfRecHitClusteringHO = cms.Sequence(particleFlowRecHitClusterHO)
+pfRecHitClusteringPS = cms.Sequence(particleFlowRecHitClusterPS)
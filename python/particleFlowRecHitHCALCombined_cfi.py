@@ -0,0 +1,26 @@
+import FWCore.ParameterSet.Config as cms
+
+# the cell geometry and neighbour tables used by the producer
+from RecoParticleFlow.PFClusterProducer.particleFlowCaloCellCache_cfi import *
+
+from RecoParticleFlow.PFClusterProducer.particleFlowRecHitHCAL_cfi import particleFlowRecHitHCAL
+
+# standard and dual time HCAL rechits in one pass. 
+# the dual time rechits have the "DualTime" instance label prefix
+particleFlowRecHitHCALCombined = cms.EDProducer("PFHCALCombinedRecHitProducer",
+    **particleFlowRecHitHCAL.parameters_()
+)
+
+# Dual time selection of the HB and HE rechits, by depth: 
+# the time is corrected by -slewA/(slewB+E), and must be 
+# within ]minTime, maxTime[ (time window for signal=4)
+particleFlowRecHitHCALCombined.dualTimeSelection = cms.PSet(
+    HB_slewA = cms.vdouble(48.9580, 34.2860, 38.6872),
+    HB_slewB = cms.vdouble(2.16078, 1.23746, 1.48051),
+    HB_minTime = cms.vdouble(-20., -17., -15.),
+    HB_maxTime = cms.vdouble(5., 8., 10.),
+    HE_slewA = cms.vdouble(60.8050, 47.1677, 37.1941, 42.9898, 48.3157),
+    HE_slewB = cms.vdouble(3.07285, 2.06485, 1.53790, 1.92969, 2.29903),
+    HE_minTime = cms.vdouble(-20., -19., -18., -17., -15.),
+    HE_maxTime = cms.vdouble(5., 6., 7., 8., 10.)
+)
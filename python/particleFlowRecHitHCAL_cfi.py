@@ -1,8 +1,23 @@
 import FWCore.ParameterSet.Config as cms
 
+# the cell geometry and neighbour tables used by the producer
+from RecoParticleFlow.PFClusterProducer.particleFlowCaloCellCache_cfi import *
+
 particleFlowRecHitHCAL = cms.EDProducer("PFRecHitProducerHCAL",
     # verbosity 
     verbose = cms.untracked.bool(False),
+    # seeds of the regions of interest, for the regional clustering
+    # (see particleFlowClusterRegional_cff). empty: the whole detector
+    regionSeeds = cms.VInputTag(),
+    # the rechits are made up to regionMargin (in eta and phi) 
+    # outside the regions, and clustered with those inside
+    regionMargin = cms.double(0.),
+    # emit the rechits along a space-filling curve in (ieta, iphi),
+    # for the memory locality of the neighbours
+    spatialOrder = cms.bool(False),
+    # slim persistence (see particleFlowRecHitSlim_cff) is not 
+    # supported for the HCAL rechits, must be False
+    slimPersistence = cms.bool(False),
     caloTowers = cms.InputTag("towerMakerPF"),
     hcalRecHitsHBHE = cms.InputTag("hbhereco"),
     hcalRecHitsHF = cms.InputTag("hfreco"),
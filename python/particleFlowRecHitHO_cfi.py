@@ -1,8 +1,23 @@
 import FWCore.ParameterSet.Config as cms
 
+# the cell geometry and neighbour tables used by the producer
+from RecoParticleFlow.PFClusterProducer.particleFlowCaloCellCache_cfi import *
+
 particleFlowRecHitHO = cms.EDProducer("PFRecHitProducerHO",
     # verbosity 
     verbose = cms.untracked.bool(False),
+    # seeds of the regions of interest, for the regional clustering
+    # (see particleFlowClusterRegional_cff). empty: the whole detector
+    regionSeeds = cms.VInputTag(),
+    # the rechits are made up to regionMargin (in eta and phi) 
+    # outside the regions, and clustered with those inside
+    regionMargin = cms.double(0.),
+    # emit the rechits along a space-filling curve in (ieta, iphi),
+    # for the memory locality of the neighbours
+    spatialOrder = cms.bool(False),
+    # also put the rechits without geometry (PFRecHitSlim), to be
+    # written out instead of the rechits, see particleFlowRecHitSlim_cff
+    slimPersistence = cms.bool(False),
     # The collection of HO rechits
     recHitsHO = cms.InputTag("horeco", ""), # for RECO
     # The threshold for rechit energies in ring0
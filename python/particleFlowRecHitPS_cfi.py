@@ -1,5 +1,8 @@
 import FWCore.ParameterSet.Config as cms
 
+# the cell geometry and neighbour tables used by the producer
+from RecoParticleFlow.PFClusterProducer.particleFlowCaloCellCache_cfi import *
+
 particleFlowRecHitPS = cms.EDProducer("PFRecHitProducerPS",
     # cell threshold in barrel 
     thresh_Barrel = cms.double(7e-06),
@@ -7,7 +10,19 @@ particleFlowRecHitPS = cms.EDProducer("PFRecHitProducerPS",
     # cell threshold in endcap 
     thresh_Endcap = cms.double(7e-06),
     # verbosity 
-    verbose = cms.untracked.bool(False)
+    verbose = cms.untracked.bool(False),
+    # seeds of the regions of interest, for the regional clustering
+    # (see particleFlowClusterRegional_cff). empty: the whole detector
+    regionSeeds = cms.VInputTag(),
+    # the rechits are made up to regionMargin (in eta and phi) 
+    # outside the regions, and clustered with those inside
+    regionMargin = cms.double(0.),
+    # emit the rechits along a space-filling curve in (x, y) of the sensors,
+    # for the memory locality of the neighbours
+    spatialOrder = cms.bool(False),
+    # also put the rechits without geometry (PFRecHitSlim), to be
+    # written out instead of the rechits, see particleFlowRecHitSlim_cff
+    slimPersistence = cms.bool(False)
 )
 
 
@@ -0,0 +1,51 @@
+import FWCore.ParameterSet.Config as cms
+
+# slim persistence of the ECAL, HO and PS PFRecHits: with
+# slimPersistence = True, the rechit producers also put a
+# reco::PFRecHitSlim (detId, energy, time and neighbours), written out
+# instead of the rechits (see PFRecHitSlimEventContent). When reading
+# the file back, the rechit collections are rehydrated from the cell
+# geometry by the modules below, which take the labels of the original
+# producers.
+# The PFClusters in the file refer to the dropped rechits: the modules
+# below also put a copy of them, referring to the rehydrated rechits,
+# to be used instead (e.g. "particleFlowRecHitECAL" for the ECAL
+# clusters). The HCAL rechits, made from the CaloTowers, are not
+# supported.
+
+from RecoParticleFlow.PFClusterProducer.particleFlowCaloCellCache_cfi import *
+
+PFRecHitSlimEventContent = cms.PSet(
+    outputCommands = cms.untracked.vstring(
+        'drop recoPFRecHits_particleFlowRecHitECAL__*',
+        'drop recoPFRecHits_particleFlowRecHitHO__*',
+        'drop recoPFRecHits_particleFlowRecHitPS__*',
+        'keep recoPFRecHitSlim_particleFlowRecHitECAL_*_*',
+        'keep recoPFRecHitSlim_particleFlowRecHitHO_*_*',
+        'keep recoPFRecHitSlim_particleFlowRecHitPS_*_*'
+    )
+)
+
+# to be run on the files written with PFRecHitSlimEventContent,
+# in a new process
+particleFlowRecHitECAL = cms.EDProducer("PFRecHitProducerSlim",
+    verbose = cms.untracked.bool(False),
+    slimRecHits = cms.InputTag("particleFlowRecHitECAL"),
+    # clusters of the original rechits, to be re-referenced. 
+    # empty label: none
+    PFClusters = cms.InputTag("particleFlowClusterECAL")
+)
+
+particleFlowRecHitHO = particleFlowRecHitECAL.clone(
+    slimRecHits = cms.InputTag("particleFlowRecHitHO"),
+    PFClusters = cms.InputTag("particleFlowClusterHO")
+)
+
+particleFlowRecHitPS = particleFlowRecHitECAL.clone(
+    slimRecHits = cms.InputTag("particleFlowRecHitPS"),
+    PFClusters = cms.InputTag("particleFlowClusterPS")
+)
+
+pfRecHitRehydration = cms.Sequence(particleFlowRecHitECAL+
+                                   particleFlowRecHitHO+
+                                   particleFlowRecHitPS)
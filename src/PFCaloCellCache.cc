@@ -0,0 +1,43 @@
+#include "RecoParticleFlow/PFClusterProducer/interface/PFCaloCellCache.h"
+
+#include "DataFormats/EcalDetId/interface/EBDetId.h"
+#include "DataFormats/EcalDetId/interface/EEDetId.h"
+#include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+#include "FWCore/Utilities/interface/typelookup.h"
+
+namespace {
+
+  const bool fourNeighbours8[8] =
+    { true, false, true, false, true, false, true, false };
+  const bool fourNeighboursCT[14] =
+    { true, false, false, true, false, false,
+      true, true, false, false, true, true, false, false };
+}
+
+
+
+const bool*
+PFCaloCellCache::fourNeighbours( Part part ) {
+  return part == CALOTOWER ? fourNeighboursCT : fourNeighbours8;
+}
+
+
+
+unsigned
+PFCaloCellCache::ecalDenseIndex( const DetId& id ) {
+
+  if( id.det() != DetId::Ecal ) return NOTFOUND;
+
+  switch( id.subdetId() ) {
+  case EcalBarrel:
+    return EBDetId(id).hashedIndex();
+  case EcalEndcap:
+    return EBDetId::kSizeForDenseIndexing + EEDetId(id).hashedIndex();
+  default:
+    return NOTFOUND;
+  }
+}
+
+
+
+TYPELOOKUP_DATA_REG(PFCaloCellCache);
@@ -1,6 +1,8 @@
 #include "RecoParticleFlow/PFClusterProducer/interface/PFClusterAlgo.h"
 #include "DataFormats/ParticleFlowReco/interface/PFLayer.h"
 #include "DataFormats/HcalDetId/interface/HcalDetId.h"
+#include "DataFormats/EcalDetId/interface/EBDetId.h"
+#include "DataFormats/EcalDetId/interface/EEDetId.h"
 #include "Math/GenVector/VectorUtil.h"
 #include "TFile.h"
 #include "TH2F.h"
@@ -68,10 +70,10 @@ void PFClusterAlgo::doClustering( const PFRecHitHandle& rechitsHandle ) {
 
   // cache the Handle to the rechits
   rechitsHandle_ = rechitsHandle;
+  rechitsOrphanHandle_.clear();
 
-  // clear rechits mask
-  mask_.clear();
-  mask_.resize( rechits.size(), true );
+  // clear rechits mask and state
+  states_.assign( rechits.size(), MASK_BIT );
 
   // perform clustering
   doClusteringWorker( rechits );
@@ -83,15 +85,10 @@ void PFClusterAlgo::doClustering( const PFRecHitHandle& rechitsHandle, const std
 
   // cache the Handle to the rechits
   rechitsHandle_ = rechitsHandle;
+  rechitsOrphanHandle_.clear();
 
   // use the specified mask, unless it doesn't match with the rechits
-  mask_.clear();
-  if (mask.size() == rechits.size()) {
-      mask_.insert( mask_.end(), mask.begin(), mask.end() );
-  } else {
-      edm::LogError("PClusterAlgo::doClustering") << "map size should be " << rechits.size() << ". Will be reinitialized.";
-      mask_.resize( rechits.size(), true );
-  }
+  setMask( rechits, mask );
 
   // perform clustering
 
@@ -99,14 +96,59 @@ void PFClusterAlgo::doClustering( const PFRecHitHandle& rechitsHandle, const std
 
 }
 
+void PFClusterAlgo::doClustering( const PFRecHitOrphanHandle& rechitsHandle ) {
+  const reco::PFRecHitCollection& rechits = * rechitsHandle;
+
+  // cache the OrphanHandle to the rechits
+  rechitsHandle_.clear();
+  rechitsOrphanHandle_ = rechitsHandle;
+
+  // clear rechits mask and state
+  states_.assign( rechits.size(), MASK_BIT );
+
+  // perform clustering
+  doClusteringWorker( rechits );
+}
+
+void PFClusterAlgo::doClustering( const PFRecHitOrphanHandle& rechitsHandle, const std::vector<bool> & mask ) {
+  const reco::PFRecHitCollection& rechits = * rechitsHandle;
+
+  // cache the OrphanHandle to the rechits
+  rechitsHandle_.clear();
+  rechitsOrphanHandle_ = rechitsHandle;
+
+  // use the specified mask, unless it doesn't match with the rechits
+  setMask( rechits, mask );
+
+  // perform clustering
+  doClusteringWorker( rechits );
+}
+
+bool PFClusterAlgo::rebindRecHitRefs( reco::PFCluster& cluster, 
+				      const PFRecHitOrphanHandle& rechitsHandle ) {
+
+  const unsigned nrechits = rechitsHandle->size();
+  for ( unsigned irh = 0; irh < cluster.rechits_.size(); ++irh ) 
+    if ( cluster.rechits_[irh].recHitRef().index() >= nrechits ) return false;
+
+  for ( unsigned irh = 0; irh < cluster.rechits_.size(); ++irh ) { 
+    const reco::PFRecHitFraction& rhf = cluster.rechits_[irh];
+    cluster.rechits_[irh] = 
+      reco::PFRecHitFraction( reco::PFRecHitRef( rechitsHandle, 
+						 rhf.recHitRef().index() ), 
+			      rhf.fraction() );
+  }
+  return true;
+}
+
 void PFClusterAlgo::doClustering( const reco::PFRecHitCollection& rechits ) {
 
   // using rechits without a Handle, clear to avoid a stale member
   rechitsHandle_.clear();
+  rechitsOrphanHandle_.clear();
 
-  // clear rechits mask
-  mask_.clear();
-  mask_.resize( rechits.size(), true );
+  // clear rechits mask and state
+  states_.assign( rechits.size(), MASK_BIT );
 
   // perform clustering
   doClusteringWorker( rechits );
@@ -117,16 +159,10 @@ void PFClusterAlgo::doClustering( const reco::PFRecHitCollection& rechits, const
   // using rechits without a Handle, clear to avoid a stale member
 
   rechitsHandle_.clear();
+  rechitsOrphanHandle_.clear();
 
   // use the specified mask, unless it doesn't match with the rechits
-  mask_.clear();
-
-  if (mask.size() == rechits.size()) {
-      mask_.insert( mask_.end(), mask.begin(), mask.end() );
-  } else {
-      edm::LogError("PClusterAlgo::doClustering") << "map size should be " << rechits.size() << ". Will be reinitialized.";
-      mask_.resize( rechits.size(), true );
-  }
+  setMask( rechits, mask );
 
   // perform clustering
   doClusteringWorker( rechits );
@@ -134,6 +170,21 @@ void PFClusterAlgo::doClustering( const reco::PFRecHitCollection& rechits, const
 }
 
 
+void PFClusterAlgo::setMask( const reco::PFRecHitCollection& rechits, 
+			     const std::vector<bool> & mask ) {
+
+  states_.clear();
+
+  if (mask.size() == rechits.size()) {
+    states_.reserve( mask.size() );
+    for ( unsigned rhi = 0; rhi < mask.size(); ++rhi ) 
+      states_.push_back( mask[rhi] ? MASK_BIT : 0 );
+  } else {
+      edm::LogError("PClusterAlgo::doClustering") << "map size should be " << rechits.size() << ". Will be reinitialized.";
+      states_.assign( rechits.size(), MASK_BIT );
+  }
+}
+
 void PFClusterAlgo::doClusteringWorker( const reco::PFRecHitCollection& rechits ) {
 
 
@@ -156,17 +207,24 @@ void PFClusterAlgo::doClusteringWorker( const reco::PFRecHitCollection& rechits
     eRecHits_.insert( make_pair( rechit(i, rechits).energy(), i) );
   }
 
-  color_.clear(); 
-  color_.resize( rechits.size(), 0 );
-
-  seedStates_.clear();
-  seedStates_.resize( rechits.size(), UNKNOWN );
-
-  usedInTopo_.clear();
-  usedInTopo_.resize( rechits.size(), false );
+  // the rechit states (color, seed state, used in topo cluster) 
+  // were reset together with the mask
+
+  // the seed mask only applies to this clustering
+  if ( !seedMask_.empty() ) { 
+    if ( seedMask_.size() == rechits.size() ) { 
+      for ( unsigned rhi = 0; rhi < seedMask_.size(); ++rhi ) 
+	if ( !seedMask_[rhi] ) states_[rhi] |= NOSEED_BIT;
+    } else 
+      edm::LogError("PFClusterAlgo::doClustering") << "seed mask size should be " << rechits.size() << ". All the rechits can be seeds.";
+    seedMask_.clear();
+  }
 
   if ( cleanRBXandHPDs_ ) cleanRBXAndHPD( rechits);
 
+  // neighbour energy sums for the seed cleaning
+  computeNeighbourSums( rechits );
+
   // look for seeds.
 
   findSeeds( rechits );
@@ -286,19 +344,94 @@ double PFClusterAlgo::parameter( Parameter paramtype,
 }
 
 
+namespace {
+
+  /// Number of HPD's and RBX's in HB and HE
+  constexpr unsigned nHPDs = 216;
+  constexpr unsigned nRBXs = 72;
+
+  /// Dense index of an HPD, from its number: 
+  /// -136..-101 (HE-), -72..-1 (HB-), 1..72 (HB+), 101..136 (HE+)
+  /// are mapped, in this order, onto 0..215
+  constexpr unsigned hpdIndex( int hpd ) { 
+    return hpd <= -101 ? hpd+136 : hpd < 0 ? hpd+108 : hpd < 101 ? hpd+107 : hpd+79;
+  }
+
+  /// HPD number from its dense index
+  constexpr int hpdNumber( unsigned index ) { 
+    return index < 36 ? int(index)-136 : index < 108 ? int(index)-108 : 
+      index < 180 ? int(index)-107 : int(index)-79;
+  }
+
+  /// HPD number of the previous HPD in phi (with wraparound)
+  constexpr int hpdPrevious( int hpd ) { 
+    return hpd == 1 ? 72 : hpd == -1 ? -72 : hpd == 101 ? 136 : hpd == -101 ? -136 : 
+      hpd > 0 ? hpd-1 : hpd+1;
+  }
+
+  /// HPD number of the next HPD in phi (with wraparound)
+  constexpr int hpdNext( int hpd ) { 
+    return hpd == 72 ? 1 : hpd == -72 ? -1 : hpd == 136 ? 101 : hpd == -136 ? -101 : 
+      hpd > 0 ? hpd+1 : hpd-1;
+  }
+
+  /// Is this a valid HPD number ?
+  constexpr bool validHPD( int hpd ) { 
+    return ( hpd >= -136 && hpd <= -101 ) || ( hpd >= -72 && hpd <= -1 ) || 
+      ( hpd >= 1 && hpd <= 72 ) || ( hpd >= 101 && hpd <= 136 );
+  }
+
+  /// Is this a valid RBX number ?
+  constexpr bool validRBX( int rbx ) { 
+    return ( rbx >= -38 && rbx <= -21 ) || ( rbx >= -18 && rbx <= -1 ) || 
+      ( rbx >= 1 && rbx <= 18 ) || ( rbx >= 21 && rbx <= 38 );
+  }
+
+  /// Dense index of a RBX, from its number: 
+  /// -38..-21 (HE-), -18..-1 (HB-), 1..18 (HB+), 21..38 (HE+)
+  /// are mapped, in this order, onto 0..71
+  constexpr unsigned rbxIndex( int rbx ) { 
+    return rbx <= -21 ? rbx+38 : rbx < 0 ? rbx+36 : rbx < 21 ? rbx+35 : rbx+33;
+  }
+
+  static_assert( hpdIndex(-136) == 0 && hpdIndex(-101) == 35 &&
+		 hpdIndex(-72) == 36 && hpdIndex(-1) == 107 &&
+		 hpdIndex(1) == 108 && hpdIndex(72) == 179 &&
+		 hpdIndex(101) == 180 && hpdIndex(136) == nHPDs-1, 
+		 "inconsistent HPD index" );
+  static_assert( hpdNumber(hpdIndex(-101)) == -101 && hpdNumber(hpdIndex(-1)) == -1 &&
+		 hpdNumber(hpdIndex(1)) == 1 && hpdNumber(hpdIndex(101)) == 101,
+		 "inconsistent HPD number" );
+  static_assert( rbxIndex(-38) == 0 && rbxIndex(-21) == 17 &&
+		 rbxIndex(-18) == 18 && rbxIndex(-1) == 35 &&
+		 rbxIndex(1) == 36 && rbxIndex(18) == 53 &&
+		 rbxIndex(21) == 54 && rbxIndex(38) == nRBXs-1, 
+		 "inconsistent RBX index" );
+
+  /// Is this HPD large enough to be considered as noisy ?
+  inline bool largeHPD( int hpd, unsigned size ) { 
+    return ( abs(hpd) > 100 && size > 15 ) || ( abs(hpd) < 100 && size > 12 );
+  }
+
+}
+
+
 void 
 PFClusterAlgo::cleanRBXAndHPD(  const reco::PFRecHitCollection& rechits ) {
 
-  std::map< int, std::vector<unsigned> > hpds;
-  std::map< int, std::vector<unsigned> > rbxs;
+  // Sort the HCAL hits by HPD and RBX, in decreasing energy order
+  hcalCleaningHits_.clear();
+
+  unsigned hpdOffsets[nHPDs+1] = { 0 };
+  unsigned rbxOffsets[nRBXs+1] = { 0 };
 
   for(EH ih = eRecHits_.begin(); ih != eRecHits_.end(); ih++ ) {
 
     unsigned  rhi      = ih->second; 
 
-    if(! masked(rhi) ) continue;
+    if(! isMasked(rhi) ) continue;
     // rechit was asked to be processed
-    const reco::PFRecHit& rhit = rechit( rhi, rechits);
+    const reco::PFRecHit& rhit = rechits[rhi];
     //double energy = rhit.energy();
     int layer = rhit.layer();
     if ( layer != PFLayer::HCAL_BARREL1 &&
@@ -310,7 +443,6 @@ PFClusterAlgo::cleanRBXAndHPD(  const reco::PFRecHitCollection& rechits ) {
     int ihpd = ieta < 0 ?  
       ( layer == PFLayer::HCAL_ENDCAP ?  -(iphi+1)/2-100 : -iphi ) : 
       ( layer == PFLayer::HCAL_ENDCAP ?   (iphi+1)/2+100 :  iphi ) ;      
-    hpds[ihpd].push_back(rhi);
     int irbx = ieta < 0 ? 
       ( layer == PFLayer::HCAL_ENDCAP ?  -(iphi+5)/4 - 20 : -(iphi+5)/4 ) : 
       ( layer == PFLayer::HCAL_ENDCAP ?   (iphi+5)/4 + 20 :  (iphi+5)/4 ) ;      
@@ -318,256 +450,241 @@ PFClusterAlgo::cleanRBXAndHPD(  const reco::PFRecHitCollection& rechits ) {
     else if ( irbx == -19 ) irbx = -1;
     else if ( irbx == 39 ) irbx = 21;
     else if ( irbx == -39 ) irbx = -21;
-    rbxs[irbx].push_back(rhi);
+
+    if ( !validHPD(ihpd) || !validRBX(irbx) ) { 
+      LogDebug("PFClusterAlgo")<<"cleanRBXAndHPD : unexpected HPD/RBX "
+			       <<ihpd<<"/"<<irbx<<" for rechit "<<rhi;
+      continue;
+    }
+    HcalCleaningHit hit;
+    hit.rhi = rhi;
+    hit.hpd = hpdIndex(ihpd);
+    hit.rbx = rbxIndex(irbx);
+    hcalCleaningHits_.push_back( hit );
+    ++hpdOffsets[hit.hpd+1];
+    ++rbxOffsets[hit.rbx+1];
+  }
+
+  for ( unsigned i = 0; i < nHPDs; ++i ) hpdOffsets[i+1] += hpdOffsets[i];
+  for ( unsigned i = 0; i < nRBXs; ++i ) rbxOffsets[i+1] += rbxOffsets[i];
+
+  unsigned nHits = hcalCleaningHits_.size();
+  hpdHits_.resize( nHits );
+  rbxHits_.resize( nHits );
+  {
+    unsigned hpdFill[nHPDs];
+    unsigned rbxFill[nRBXs];
+    std::copy( hpdOffsets, hpdOffsets+nHPDs, hpdFill );
+    std::copy( rbxOffsets, rbxOffsets+nRBXs, rbxFill );
+    for ( unsigned ih = 0; ih < nHits; ++ih ) { 
+      const HcalCleaningHit& hit = hcalCleaningHits_[ih];
+      hpdHits_[ hpdFill[hit.hpd]++ ] = hit.rhi;
+      rbxHits_[ rbxFill[hit.rbx]++ ] = hit.rhi;
+    }
   }
 
   // Loop on readout boxes
-  for ( std::map<int, std::vector<unsigned> >::iterator itrbx = rbxs.begin();
-	itrbx != rbxs.end(); ++itrbx ) { 
-    if ( ( abs(itrbx->first)<20 && itrbx->second.size() > 30 ) || 
-	 ( abs(itrbx->first)>20 && itrbx->second.size() > 30 ) ) { 
-      const std::vector<unsigned>& rhits = itrbx->second;
-      double totalEta = 0.;
-      double totalEtaW = 0.;
-      double totalPhi = 0.;
-      double totalPhiW = 0.;
-      double totalEta2 = 1E-9;
-      double totalEta2W = 1E-9;
-      double totalPhi2 = 1E-9;
-      double totalPhi2W = 1E-9;
-      double totalEnergy = 0.;
-      double totalEnergy2 = 1E-9;
-      unsigned nSeeds = rhits.size();
-      unsigned nSeeds0 = rhits.size();
-      std::map< int,std::vector<unsigned> > theHPDs;
-      std::multimap< double,unsigned > theEnergies;
-      for ( unsigned jh=0; jh < rhits.size(); ++jh ) {
-	const reco::PFRecHit& hit = rechit(rhits[jh], rechits);
-	// Check if the hit is a seed
-	unsigned nN = 0;
-	bool isASeed = true;
-	const vector<unsigned>& neighbours4 = *(& hit.neighbours4());
-	for(unsigned in=0; in<neighbours4.size(); in++) {
-	  const reco::PFRecHit& neighbour = rechit( neighbours4[in], rechits ); 
-	  // one neighbour has a higher energy -> the tested rechit is not a seed
-	  if( neighbour.energy() > hit.energy() ) {
-	    --nSeeds;
-	    --nSeeds0;
-	    isASeed = false;
-	    break;
-	  } else {
-	    if ( neighbour.energy() > 0.4 ) ++nN;
-	  }
-	}
-	if ( isASeed && !nN ) --nSeeds0;
-
-	HcalDetId theHcalDetId = HcalDetId(hit.detId());
-	// int ieta = theHcalDetId.ieta();
-	int iphi = theHcalDetId.iphi();
-	// std::cout << "Hit : " << hit.energy() << " " << ieta << " " << iphi << std::endl;
-	if ( hit.layer() == PFLayer::HCAL_BARREL1 )
-	  theHPDs[iphi].push_back(rhits[jh]);
-	else
-	  theHPDs[(iphi-1)/2].push_back(rhits[jh]);
-	theEnergies.insert(std::pair<double,unsigned>(hit.energy(),rhits[jh]));
-	totalEnergy += hit.energy();
-	totalPhi += fabs(hit.position().phi());
-	totalPhiW += hit.energy()*fabs(hit.position().phi());
-	totalEta += hit.position().eta();
-	totalEtaW += hit.energy()*hit.position().eta();
-	totalEnergy2 += hit.energy()*hit.energy();
-	totalPhi2 += hit.position().phi()*hit.position().phi();
-	totalPhi2W += hit.energy()*hit.position().phi()*hit.position().phi();
-	totalEta2 += hit.position().eta()*hit.position().eta();
-	totalEta2W += hit.energy()*hit.position().eta()*hit.position().eta();
-      }
-      // totalPhi /= totalEnergy;
-      totalPhi /= rhits.size();
-      totalEta /= rhits.size();
-      totalPhiW /= totalEnergy;
-      totalEtaW /= totalEnergy;
-      totalPhi2 /= rhits.size();
-      totalEta2 /= rhits.size();
-      totalPhi2W /= totalEnergy;
-      totalEta2W /= totalEnergy;
-      totalPhi2 = std::sqrt(totalPhi2 - totalPhi*totalPhi);
-      totalEta2 = std::sqrt(totalEta2 - totalEta*totalEta);
-      totalPhi2W = std::sqrt(totalPhi2W - totalPhiW*totalPhiW);
-      totalEta2W = std::sqrt(totalEta2W - totalEtaW*totalEtaW);
-      totalEnergy /= rhits.size();
-      totalEnergy2 /= rhits.size();
-      totalEnergy2 = std::sqrt(totalEnergy2 - totalEnergy*totalEnergy);
-      //if ( totalPhi2W/totalEta2W < 0.18 ) { 
-      if ( nSeeds0 > 6 ) {
-	unsigned nHPD15 = 0;
-	for ( std::map<int, std::vector<unsigned> >::iterator itHPD = theHPDs.begin();
-	      itHPD != theHPDs.end(); ++itHPD ) { 
-	  int hpdN = itHPD->first;
-	  const std::vector<unsigned>& hpdHits = itHPD->second;
-	  if ( ( abs(hpdN) < 100 && hpdHits.size() > 14 ) || 
-	       ( abs(hpdN) > 100 && hpdHits.size() > 14 ) ) ++nHPD15;
-	}
-	if ( nHPD15 > 1 ) {
-	  /*
-	  std::cout << "Read out box numero " << itrbx->first 
-		    << " has " << itrbx->second.size() << " hits in it !"
-		    << std::endl << "sigma Eta/Phi = " << totalEta2 << " " << totalPhi2 << " " << totalPhi2/totalEta2
-		    << std::endl << "sigma EtaW/PhiW = " << totalEta2W << " " << totalPhi2W << " " << totalPhi2W/totalEta2W
-		    << std::endl << "E = " << totalEnergy << " +/- " << totalEnergy2
-		    << std::endl << "nSeeds = " << nSeeds << " " << nSeeds0
-		    << std::endl;
-	  for ( std::map<int, std::vector<unsigned> >::iterator itHPD = theHPDs.begin();
-		itHPD != theHPDs.end(); ++itHPD ) { 
-	    unsigned hpdN = itHPD->first;
-	    const std::vector<unsigned>& hpdHits = itHPD->second;
-	    std::cout << "HPD number " << hpdN << " contains " << hpdHits.size() << " hits" << std::endl;
-	  }
-	  */
-	  std::multimap<double, unsigned >::iterator ntEn = theEnergies.end();
-	  --ntEn;
-	  unsigned nn = 0;
-	  double threshold = 1.;
-	  for ( std::multimap<double, unsigned >::iterator itEn = theEnergies.begin();
-		itEn != theEnergies.end(); ++itEn ) {
-	    ++nn;
-	    if ( nn < 5 ) { 
-	      mask_[itEn->second] = false;
-	    } else if ( nn == 5 ) { 
-	      threshold = itEn->first * 5.;
-	      mask_[itEn->second] = false;
-	    } else { 
-	      if ( itEn->first < threshold ) mask_[itEn->second] = false;
-	    }
-	    if ( !masked(itEn->second) ) { 
-	      reco::PFRecHit theCleanedHit(rechit(itEn->second, rechits));
-	      //theCleanedHit.setRescale(0.);
-	      pfRecHitsCleaned_->push_back(theCleanedHit);
-	    }
-	    /*
-	    if ( !masked(itEn->second) ) 
-	      std::cout << "Hit Energies = " << itEn->first 
-			<< " " << ntEn->first/itEn->first << " masked " << std::endl;
-	    else 
-	      std::cout << "Hit Energies = " << itEn->first 
-			<< " " << ntEn->first/itEn->first << " kept for clustering " << std::endl;
-	    */
-	  }
+  for ( unsigned irbx = 0; irbx < nRBXs; ++irbx ) { 
+
+    unsigned rbxSize = rbxOffsets[irbx+1] - rbxOffsets[irbx];
+    if ( rbxSize <= 30 ) continue;
+
+    const unsigned* rhits = &rbxHits_[ rbxOffsets[irbx] ];
+    unsigned nSeeds0 = rbxSize;
+    // number of hits per HPD (numbered by iphi in HB, (iphi-1)/2 in HE)
+    unsigned theHPDs[73] = { 0 };
+    for ( unsigned jh=0; jh < rbxSize; ++jh ) {
+      const reco::PFRecHit& hit = rechits[rhits[jh]];
+      // Check if the hit is a seed
+      unsigned nN = 0;
+      bool isASeed = true;
+      const vector<unsigned>& neighbours4 = hit.neighbours4();
+      for(unsigned in=0; in<neighbours4.size(); in++) {
+	const reco::PFRecHit& neighbour = rechits[ neighbours4[in] ]; 
+	// one neighbour has a higher energy -> the tested rechit is not a seed
+	if( neighbour.energy() > hit.energy() ) {
+	  --nSeeds0;
+	  isASeed = false;
+	  break;
+	} else {
+	  if ( neighbour.energy() > 0.4 ) ++nN;
 	}
       }
+      if ( isASeed && !nN ) --nSeeds0;
+
+      HcalDetId theHcalDetId = HcalDetId(hit.detId());
+      int iphi = theHcalDetId.iphi();
+      if ( hit.layer() == PFLayer::HCAL_BARREL1 )
+	++theHPDs[iphi];
+      else
+	++theHPDs[(iphi-1)/2];
+    }
+
+    if ( nSeeds0 > 6 ) {
+      unsigned nHPD15 = 0;
+      for ( unsigned ihpd = 0; ihpd < 73; ++ihpd ) 
+	if ( theHPDs[ihpd] > 14 ) ++nHPD15;
+      if ( nHPD15 > 1 ) 
+	cleanHits( rhits, rbxSize, 5., rechits );
     }
   }
 
   // Loop on hpd's
-  std::map<int, std::vector<unsigned> >::iterator neighbour1;
-  std::map<int, std::vector<unsigned> >::iterator neighbour2;
-  std::map<int, std::vector<unsigned> >::iterator neighbour0;
-  std::map<int, std::vector<unsigned> >::iterator neighbour3;
-  unsigned size1 = 0;
-  unsigned size2 = 0;
-  for ( std::map<int, std::vector<unsigned> >::iterator ithpd = hpds.begin();
-	ithpd != hpds.end(); ++ithpd ) { 
-
-    const std::vector<unsigned>& rhits = ithpd->second;
-    std::multimap< double,unsigned > theEnergies;
-    double totalEnergy = 0.;
-    double totalEnergy2 = 1E-9;
-    for ( unsigned jh=0; jh < rhits.size(); ++jh ) {
-      const reco::PFRecHit& hit = rechit(rhits[jh], rechits);
-      totalEnergy += hit.energy();
-      totalEnergy2 += hit.energy()*hit.energy();
-      theEnergies.insert(std::pair<double,unsigned>(hit.energy(),rhits[jh]));
-    }
-    totalEnergy /= rhits.size();
-    totalEnergy2 /= rhits.size();
-    totalEnergy2 = std::sqrt(totalEnergy2 - totalEnergy*totalEnergy);
-
-    if ( ithpd->first == 1 ) neighbour1 = hpds.find(72);
-    else if ( ithpd->first == -1 ) neighbour1 = hpds.find(-72);
-    else if ( ithpd->first == 101 ) neighbour1 = hpds.find(136);
-    else if ( ithpd->first == -101 ) neighbour1 = hpds.find(-136);
-    else neighbour1 = ithpd->first > 0 ? hpds.find(ithpd->first-1) : hpds.find(ithpd->first+1) ;
-
-    if ( ithpd->first == 72 ) neighbour2 = hpds.find(1);
-    else if ( ithpd->first == -72 ) neighbour2 = hpds.find(-1);
-    else if ( ithpd->first == 136 ) neighbour2 = hpds.find(101);
-    else if ( ithpd->first == -136 ) neighbour2 = hpds.find(-101);
-    else neighbour2 = ithpd->first > 0 ? hpds.find(ithpd->first+1) : hpds.find(ithpd->first-1) ;
-
-    if ( neighbour1 != hpds.end() ) { 
-      if ( neighbour1->first == 1 ) neighbour0 = hpds.find(72);
-      else if ( neighbour1->first == -1 ) neighbour0 = hpds.find(-72);
-      else if ( neighbour1->first == 101 ) neighbour0 = hpds.find(136);
-      else if ( neighbour1->first == -101 ) neighbour0 = hpds.find(-136);
-      else neighbour0 = neighbour1->first > 0 ? hpds.find(neighbour1->first-1) : hpds.find(neighbour1->first+1) ;
-    } 
+  for ( unsigned ihpd = 0; ihpd < nHPDs; ++ihpd ) { 
 
-    if ( neighbour2 != hpds.end() ) { 
-      if ( neighbour2->first == 72 ) neighbour3 = hpds.find(1);
-      else if ( neighbour2->first == -72 ) neighbour3 = hpds.find(-1);
-      else if ( neighbour2->first == 136 ) neighbour3 = hpds.find(101);
-      else if ( neighbour2->first == -136 ) neighbour3 = hpds.find(-101);
-      else neighbour3 = neighbour2->first > 0 ? hpds.find(neighbour2->first+1) : hpds.find(neighbour2->first-1) ;
-    }
+    unsigned hpdSize = hpdOffsets[ihpd+1] - hpdOffsets[ihpd];
+    if ( !hpdSize ) continue;
+    int hpd = hpdNumber(ihpd);
 
-    size1 = neighbour1 != hpds.end() ? neighbour1->second.size() : 0;
-    size2 = neighbour2 != hpds.end() ? neighbour2->second.size() : 0;
+    unsigned neighbour1 = hpdIndex( hpdPrevious(hpd) );
+    unsigned neighbour2 = hpdIndex( hpdNext(hpd) );
+    unsigned size1 = hpdOffsets[neighbour1+1] - hpdOffsets[neighbour1];
+    unsigned size2 = hpdOffsets[neighbour2+1] - hpdOffsets[neighbour2];
 
     // Also treat the case of two neighbouring HPD's not in the same RBX
-    if ( size1 > 10 ) { 
-      if ( ( abs(neighbour1->first) > 100 && neighbour1->second.size() > 15 ) || 
-	   ( abs(neighbour1->first) < 100 && neighbour1->second.size() > 12 ) ) 
-	size1 = neighbour0 != hpds.end() ? neighbour0->second.size() : 0;
+    if ( size1 > 10 && largeHPD( hpdPrevious(hpd), size1 ) ) { 
+      unsigned neighbour0 = hpdIndex( hpdPrevious(hpdPrevious(hpd)) );
+      size1 = hpdOffsets[neighbour0+1] - hpdOffsets[neighbour0];
     }
-    if ( size2 > 10 ) { 
-      if ( ( abs(neighbour2->first) > 100 && neighbour2->second.size() > 15 ) || 
-	   ( abs(neighbour2->first) < 100 && neighbour2->second.size() > 12 ) ) 
-	size2 = neighbour3 != hpds.end() ? neighbour3->second.size() : 0;
+    if ( size2 > 10 && largeHPD( hpdNext(hpd), size2 ) ) { 
+      unsigned neighbour3 = hpdIndex( hpdNext(hpdNext(hpd)) );
+      size2 = hpdOffsets[neighbour3+1] - hpdOffsets[neighbour3];
     }
     
-    if ( ( abs(ithpd->first) > 100 && ithpd->second.size() > 15 ) || 
-         ( abs(ithpd->first) < 100 && ithpd->second.size() > 12 ) )
-      if ( (float)(size1 + size2)/(float)ithpd->second.size() < 1.0 ) {
-	/* 
-	std::cout << "HPD numero " << ithpd->first 
-		  << " has " << ithpd->second.size() << " hits in it !" << std::endl
-		  << "Neighbours : " << size1 << " " << size2
-		  << std::endl;
-	*/
-	std::multimap<double, unsigned >::iterator ntEn = theEnergies.end();
-	--ntEn;
-	unsigned nn = 0;
-	double threshold = 1.;
-	for ( std::multimap<double, unsigned >::iterator itEn = theEnergies.begin();
-	      itEn != theEnergies.end(); ++itEn ) {
-	  ++nn;
-	  if ( nn < 5 ) { 
-	    mask_[itEn->second] = false;
-	  } else if ( nn == 5 ) { 
-	    threshold = itEn->first * 2.5;
-	    mask_[itEn->second] = false;
-	  } else { 
-	    if ( itEn->first < threshold ) mask_[itEn->second] = false;
-	  }
-	  if ( !masked(itEn->second) ) { 
-	    reco::PFRecHit theCleanedHit(rechit(itEn->second, rechits));
-	    //theCleanedHit.setRescale(0.);
-	    pfRecHitsCleaned_->push_back(theCleanedHit);
-	  }
-	  /*
-	  if ( !masked(itEn->second) ) 
-	    std::cout << "Hit Energies = " << itEn->first 
-		      << " " << ntEn->first/itEn->first << " masked " << std::endl;
-	  else 
-	    std::cout << "Hit Energies = " << itEn->first 
-	    << " " << ntEn->first/itEn->first << " kept for clustering " << std::endl;
-	  */
-	}
-      }
+    if ( largeHPD( hpd, hpdSize ) )
+      if ( (float)(size1 + size2)/(float)hpdSize < 1.0 ) 
+	cleanHits( &hpdHits_[ hpdOffsets[ihpd] ], hpdSize, 2.5, rechits );
   }
 
 }
 
 
+void 
+PFClusterAlgo::cleanHits( const unsigned* rhits, unsigned nhits, 
+			  double factor, 
+			  const reco::PFRecHitCollection& rechits ) {
+
+  // sort by increasing energy (ties in the original order, 
+  // which is by increasing index)
+  cleanEnergies_.clear();
+  for ( unsigned jh=0; jh < nhits; ++jh ) 
+    cleanEnergies_.push_back( std::make_pair( rechits[rhits[jh]].energy(), rhits[jh] ) );
+  std::sort( cleanEnergies_.begin(), cleanEnergies_.end() );
+
+  // mask the four softest hits, and all hits below 
+  // factor times the energy of the fifth one
+  unsigned nn = 0;
+  double threshold = 1.;
+  for ( unsigned ie = 0; ie < cleanEnergies_.size(); ++ie ) {
+    double energy = cleanEnergies_[ie].first;
+    unsigned rhi = cleanEnergies_[ie].second;
+    ++nn;
+    if ( nn < 5 ) { 
+      unmask(rhi);
+    } else if ( nn == 5 ) { 
+      threshold = energy * factor;
+      unmask(rhi);
+    } else { 
+      if ( energy < threshold ) unmask(rhi);
+    }
+    if ( !isMasked(rhi) ) { 
+      reco::PFRecHit theCleanedHit(rechits[rhi]);
+      //theCleanedHit.setRescale(0.);
+      pfRecHitsCleaned_->push_back(theCleanedHit);
+    }
+  }
+}
+
+
+void PFClusterAlgo::computeNeighbourSums( const reco::PFRecHitCollection& rechits ) {
+
+  unsigned nhits = rechits.size();
+  neighbourSums_.assign( nhits, NeighbourSums() );
+  nbCandOffsets_.assign( nhits+1, 0 );
+  nbCandIndices_.clear();
+
+  // Only the rechits above the lowest cleaning threshold can be tested
+  // (all of them when the cleaning histograms are filled)
+  double minThresh = std::min( std::min( threshCleanBarrel_, threshCleanEndcap_ ),
+			       std::min( threshDoubleSpikeBarrel_, threshDoubleSpikeEndcap_ ) );
+
+  for ( unsigned rhi = 0; rhi < nhits; ++rhi ) { 
+
+    // unmasked rechits are never tested
+    if ( !isMasked(rhi) ) continue;
+    const reco::PFRecHit& rh = rechits[rhi];
+    if ( !file_ && !( rh.energy() > minThresh ) ) continue;
+
+    neighbourSums_[rhi].candidate = true;
+    sumMaskedNeighbours( rhi, rechits );
+
+    // The double spike cleaning needs the energy around 
+    // the most energetic neighbour, masked or not.
+    const vector<unsigned>& neighbours4 = rh.neighbours4();
+    for ( unsigned in4 = 0; in4 < neighbours4.size(); ++in4 ) { 
+      unsigned rhj = neighbours4[in4];
+      ++nbCandOffsets_[rhj+1];
+      NeighbourSums& sumsj = neighbourSums_[rhj];
+      if ( sumsj.hasAllEnergy ) continue;
+      const vector<unsigned>& neighbours4j = rechits[rhj].neighbours4();
+      for ( unsigned jn4 = 0; jn4 < neighbours4j.size(); ++jn4 )
+	sumsj.allEnergy += rechits[ neighbours4j[jn4] ].energy();
+      sumsj.hasAllEnergy = true;
+    }
+  }
+
+  // Reverse links, from a rechit to the candidates it is a neighbour of
+  for ( unsigned rhj = 0; rhj < nhits; ++rhj ) 
+    nbCandOffsets_[rhj+1] += nbCandOffsets_[rhj];
+  nbCandIndices_.resize( nbCandOffsets_[nhits] );
+
+  vector<unsigned> fill( nbCandOffsets_.begin(), nbCandOffsets_.end()-1 );
+  for ( unsigned rhi = 0; rhi < nhits; ++rhi ) { 
+    if ( !neighbourSums_[rhi].candidate ) continue;
+    const vector<unsigned>& neighbours4 = rechits[rhi].neighbours4();
+    for ( unsigned in4 = 0; in4 < neighbours4.size(); ++in4 ) 
+      nbCandIndices_[ fill[ neighbours4[in4] ]++ ] = rhi;
+  }
+}
+
+
+void PFClusterAlgo::sumMaskedNeighbours( unsigned rhi, 
+					 const reco::PFRecHitCollection& rechits ) {
+
+  NeighbourSums& sums = neighbourSums_[rhi];
+  const reco::PFRecHit& rh = rechits[rhi];
+
+  sums.surroundingEnergy = rh.energyUp();
+  sums.maskedEnergy = 0.;
+  sums.maxEnergy = -999.;
+  sums.maxNeighbour = 0;
+
+  const vector<unsigned>& neighbours4 = rh.neighbours4();
+  for ( unsigned in4 = 0; in4 < neighbours4.size(); ++in4 ) { 
+    unsigned rhj = neighbours4[in4];
+    // Ignore neighbours already masked
+    if ( !isMasked(rhj) ) continue;
+    const reco::PFRecHit& neighbour = rechits[rhj];
+    sums.surroundingEnergy += neighbour.energy() + neighbour.energyUp();
+    sums.maskedEnergy += neighbour.energy();
+    if ( neighbour.energy() > sums.maxEnergy ) { 
+      sums.maxEnergy = neighbour.energy();
+      sums.maxNeighbour = rhj;
+    }
+  }
+}
+
+
+void PFClusterAlgo::updateNeighbourSums( unsigned rhi, 
+					 const reco::PFRecHitCollection& rechits ) {
+
+  // The sums are recomputed rather than corrected, 
+  // so that they are identical to a fresh summation
+  for ( unsigned ic = nbCandOffsets_[rhi]; ic < nbCandOffsets_[rhi+1]; ++ic ) 
+    sumMaskedNeighbours( nbCandIndices_[ic], rechits );
+}
+
+
 void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
 
   seeds_.clear();
@@ -588,13 +705,13 @@ void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
 
     unsigned  rhi      = ih->second; 
 
-    if(! masked(rhi) ) continue;
+    if(! isMasked(rhi) ) continue;
     // rechit was asked to be processed
 
     double    rhenergy = ih->first;   
-    const reco::PFRecHit& wannaBeSeed = rechit(rhi, rechits);
+    const reco::PFRecHit& wannaBeSeed = rechits[rhi];
      
-    if( seedStates_[rhi] == NO ) continue;
+    if( seedState(rhi) == NO ) continue;
     // this hit was already tested, and is not a seed
  
     // determine seed energy threshold depending on the detector
@@ -631,8 +748,9 @@ void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
 #endif
 
 
-    if( rhenergy < seedThresh || (seedPtThresh>0. && wannaBeSeed.pt2() < seedPtThresh*seedPtThresh )) {
-      seedStates_[rhi] = NO; 
+    if( rhenergy < seedThresh || (seedPtThresh>0. && wannaBeSeed.pt2() < seedPtThresh*seedPtThresh ) || 
+	!isSeedAllowed(rhi) ) {
+      setSeedState( rhi, NO ); 
       continue;
     } 
 
@@ -683,17 +801,17 @@ void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
       
     // Select as a seed if all neighbours have a smaller energy
 
-    seedStates_[rhi] = YES;
+    setSeedState( rhi, YES );
     for(unsigned in=0; in<neighbours.size(); in++) {
 	
       unsigned rhj =  neighbours[in];
       // Ignore neighbours already masked
-      if ( !masked(rhj) ) continue;
-      const reco::PFRecHit& neighbour = rechit( rhj, rechits ); 
+      if ( !isMasked(rhj) ) continue;
+      const reco::PFRecHit& neighbour = rechits[rhj]; 
 	
       // one neighbour has a higher energy -> the tested rechit is not a seed
       if( neighbour.energy() > wannaBeSeed.energy() ) {
-	seedStates_[rhi] = NO;
+	setSeedState( rhi, NO );
 	break;
       }
     }
@@ -701,20 +819,9 @@ void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
     // Cleaning : check energetic, isolated seeds, likely to come from erratic noise.
     if ( file_ || wannaBeSeed.energy() > cleanThresh ) { 
       
-      const vector<unsigned>& neighbours4 = *(& wannaBeSeed.neighbours4());
       // Determine the fraction of surrounding energy
-      double surroundingEnergy = wannaBeSeed.energyUp();
-      double neighbourEnergy = 0.;
-      double layerEnergy = 0.;
-      for(unsigned in4=0; in4<neighbours4.size(); in4++) {
-	unsigned rhj =  neighbours4[in4];
-	// Ignore neighbours already masked
-	if ( !masked(rhj) ) continue;
-	const reco::PFRecHit& neighbour = rechit( rhj, rechits ); 
-	surroundingEnergy += neighbour.energy() + neighbour.energyUp();
-	neighbourEnergy += neighbour.energy() + neighbour.energyUp();
-	layerEnergy += neighbour.energy();
-      }
+      // (neighbours already masked are ignored)
+      double surroundingEnergy = neighbourSums_[rhi].surroundingEnergy;
       // Fraction 0 is the balance between EM and HAD layer for this tower
       // double fraction0 = layer == PFLayer::HF_EM || layer == PFLayer::HF_HAD ? 
       //   wannaBeSeed.energyUp()/wannaBeSeed.energy() : 1.;
@@ -755,8 +862,7 @@ void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
 	if ( fraction1 < f1Cut ) {
 	  // Double the energy cleaning threshold when close to the ECAL/HCAL - HF transition
 	  double eta = wannaBeSeed.position().eta();
-	  double phi = wannaBeSeed.position().phi();
-	  std::pair<double,double> dcr = dCrack(phi,eta);
+	  std::pair<double,double> dcr = crackDistance(wannaBeSeed);
 	  double dcrmin = layer == PFLayer::ECAL_BARREL ? std::min(dcr.first, dcr.second) : dcr.second;
 	  eta = fabs(eta);
 	  if (   eta < 5.0 &&                         // No cleaning for the HF border 
@@ -764,8 +870,9 @@ void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
 		   ( rhenergy > tighterE*cleanThresh && 
 		     fraction1 < f1Cut/tighterF ) )  // Tighter cleaning for various cracks 
 	      ) { 
-	    seedStates_[rhi] = CLEAN;
-	    mask_[rhi] = false;
+	    setSeedState( rhi, CLEAN );
+	    unmask(rhi);
+	    updateNeighbourSums( rhi, rechits );
 	    reco::PFRecHit theCleanedHit(wannaBeSeed);
 	    //theCleanedHit.setRescale(0.);
 	    pfRecHitsCleaned_->push_back(theCleanedHit);
@@ -785,42 +892,25 @@ void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
     }
 
     // Clean double spikes
-    if ( mask_[rhi] && wannaBeSeed.energy() > doubleSpikeThresh ) {
+    if ( isMasked(rhi) && wannaBeSeed.energy() > doubleSpikeThresh ) {
       // Determine energy surrounding the seed and the most energetic neighbour
-      double surroundingEnergyi = 0.;
-      double enmax = -999.;
-      unsigned mostEnergeticNeighbour = 0;
-      const vector<unsigned>& neighbours4i = *(& wannaBeSeed.neighbours4());
-      for(unsigned in4=0; in4<neighbours4i.size(); in4++) {
-	unsigned rhj =  neighbours4i[in4];
-	if ( !masked(rhj) ) continue;
-	const reco::PFRecHit& neighbouri = rechit( rhj, rechits );
-	surroundingEnergyi += neighbouri.energy();
-	if ( neighbouri.energy() > enmax ) { 
-	  enmax = neighbouri.energy();
-	  mostEnergeticNeighbour = rhj;
-	}
-      }
+      const NeighbourSums& sumsi = neighbourSums_[rhi];
+      double surroundingEnergyi = sumsi.maskedEnergy;
+      double enmax = sumsi.maxEnergy;
+      unsigned mostEnergeticNeighbour = sumsi.maxNeighbour;
       // Is there an energetic neighbour ?
       if ( enmax > 0. ) { 
 	unsigned rhj = mostEnergeticNeighbour;
-	const reco::PFRecHit& neighbouri = rechit( rhj, rechits );
-	double surroundingEnergyj = 0.;
+	const reco::PFRecHit& neighbouri = rechits[rhj];
 	//if ( mask_[rhj] && neighbouri.energy() > doubleSpikeThresh ) {
 	// Determine energy surrounding the energetic neighbour
-	const vector<unsigned>& neighbours4j = *(& neighbouri.neighbours4());
-	for(unsigned jn4=0; jn4<neighbours4j.size(); jn4++) {
-	  unsigned rhk =  neighbours4j[jn4];
-	  const reco::PFRecHit& neighbourj = rechit( rhk, rechits ); 
-	  surroundingEnergyj += neighbourj.energy();
-	}
+	double surroundingEnergyj = neighbourSums_[rhj].allEnergy;
 	// The energy surrounding the double spike candidate 
 	double surroundingEnergyFraction = 
 	  (surroundingEnergyi+surroundingEnergyj) / (wannaBeSeed.energy()+neighbouri.energy()) - 1.;
 	if ( surroundingEnergyFraction < doubleSpikeS6S2 ) { 
 	  double eta = wannaBeSeed.position().eta();
-	  double phi = wannaBeSeed.position().phi();
-	  std::pair<double,double> dcr = dCrack(phi,eta);
+	  std::pair<double,double> dcr = crackDistance(wannaBeSeed);
 	  double dcrmin = layer == PFLayer::ECAL_BARREL ? std::min(dcr.first, dcr.second) : dcr.second;
 	  eta = fabs(eta);
 	  if (  ( eta < 5.0 && dcrmin > 1. ) ||
@@ -835,13 +925,15 @@ void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
 		      << std::endl;
 	    */
 	    // mask the seed
-	    seedStates_[rhi] = CLEAN;
-	    mask_[rhi] = false;
+	    setSeedState( rhi, CLEAN );
+	    unmask(rhi);
+	    updateNeighbourSums( rhi, rechits );
 	    reco::PFRecHit theCleanedSeed(wannaBeSeed);
 	    pfRecHitsCleaned_->push_back(theCleanedSeed);
 	    // mask the neighbour
-	    seedStates_[rhj] = CLEAN;
-	    mask_[rhj] = false;
+	    setSeedState( rhj, CLEAN );
+	    unmask(rhj);
+	    updateNeighbourSums( rhj, rechits );
 	    reco::PFRecHit theCleanedNeighbour(wannaBeSeed);
 	    pfRecHitsCleaned_->push_back(neighbouri);
 	  }
@@ -854,17 +946,19 @@ void PFClusterAlgo::findSeeds( const reco::PFRecHitCollection& rechits ) {
       }
     }
 
-    if ( seedStates_[rhi] == YES ) {
+    if ( seedState(rhi) == YES ) {
 
       // seeds_ contains the indices of all seeds. 
       seeds_.push_back( rhi );
       
+#ifdef PFLOW_DEBUG
       // marking the rechit
       paint(rhi, SEED);
+#endif
 	
       // then all neighbours cannot be seeds and are flagged as such
       for(unsigned in=0; in<neighbours.size(); in++) {
-	seedStates_[ neighbours[in] ] = NO;
+	setSeedState( neighbours[in], NO );
       }
     }
 
@@ -892,11 +986,11 @@ void PFClusterAlgo::buildTopoClusters( const reco::PFRecHitCollection& rechits )
     
     unsigned rhi = seeds_[is];
 
-    if( !masked(rhi) ) continue;
+    if( !isMasked(rhi) ) continue;
     // rechit was masked to be processed
 
     // already used in a topological cluster
-    if( usedInTopo_[rhi] ) {
+    if( isUsedInTopo(rhi) ) {
 #ifdef PFLOW_DEBUG
       if(debug_) 
 	cout<<rhi<<" used"<<endl; 
@@ -933,7 +1027,7 @@ PFClusterAlgo::buildTopoCluster( vector< unsigned >& cluster,
     cout<<"PFClusterAlgo::buildTopoCluster in"<<endl;
 #endif
 
-  const reco::PFRecHit& rh = rechit( rhi, rechits); 
+  const reco::PFRecHit& rh = rechits[rhi]; 
 
   double e = rh.energy();
   int layer = rh.layer();
@@ -961,7 +1055,7 @@ PFClusterAlgo::buildTopoCluster( vector< unsigned >& cluster,
   cluster.push_back( rhi );
   // idUsedRecHits_.insert( rh.detId() );
 
-  usedInTopo_[ rhi ] = true;
+  setUsedInTopo( rhi );
 
   //   cout<<" hit ptr "<<hit<<endl;
 
@@ -979,7 +1073,7 @@ PFClusterAlgo::buildTopoCluster( vector< unsigned >& cluster,
 //     if(used != idUsedRecHits_.end() ) continue;
     
     // already used
-    if( usedInTopo_[ nbs[i] ] ) {
+    if( isUsedInTopo( nbs[i] ) ) {
 #ifdef PFLOW_DEBUG
       if(debug_) 
 	cout<<rhi<<" used"<<endl; 
@@ -987,7 +1081,7 @@ PFClusterAlgo::buildTopoCluster( vector< unsigned >& cluster,
       continue;
     }
 			     
-    if( !masked(nbs[i]) ) continue;
+    if( !isMasked(nbs[i]) ) continue;
     buildTopoCluster( cluster, nbs[i], rechits );
   }
 #ifdef PFLOW_DEBUG
@@ -1018,7 +1112,7 @@ PFClusterAlgo::buildPFClusters( const std::vector< unsigned >& topocluster,
 
     unsigned rhi = topocluster[i];
 
-    if( seedStates_[rhi] == YES ) {
+    if( seedState(rhi) == YES ) {
 
       reco::PFCluster cluster;
       reco::PFCluster clusterwodepthcor;
@@ -1060,6 +1154,25 @@ PFClusterAlgo::buildPFClusters( const std::vector< unsigned >& topocluster,
   int posCalcNCrystal = seedsintopocluster.size()>1 ? posCalcNCrystal_:-1;
   double ns2 = std::max(1.,(double)(seedsintopocluster.size())-1.);
   ns2 *= ns2;
+
+  // with 5 or 9 crystals, the neighbour relation of each rechit 
+  // to each seed is determined once for all iterations
+  unsigned ntopo = topocluster.size();
+  bool seedNeighbourFlags = posCalcNCrystal == 5 || posCalcNCrystal == 9;
+  if ( seedNeighbourFlags ) { 
+    if ( topoPosition_.size() < rechits.size() ) 
+      topoPosition_.resize( rechits.size() );
+    seedNeighbours_.resize( seedsintopocluster.size() * ntopo );
+    for ( unsigned irh = 0; irh < ntopo; ++irh ) {
+      unsigned rhindex = topocluster[irh];
+      topoPosition_[rhindex] = irh;
+      const reco::PFRecHit& rh = rechits[rhindex];
+      for ( unsigned ic = 0; ic < seedsintopocluster.size(); ++ic ) 
+	seedNeighbours_[ic*ntopo + irh] = posCalcNCrystal == 5 ? 
+	  rh.isNeighbour4( seedsintopocluster[ic] ) : 
+	  rh.isNeighbour8( seedsintopocluster[ic] );
+    }
+  }
     
   // Find iteratively the energy and position
   // of each pfcluster in the topological cluster
@@ -1101,7 +1214,7 @@ PFClusterAlgo::buildPFClusters( const std::vector< unsigned >& topocluster,
     for( unsigned irh=0; irh<topocluster.size(); irh++ ) {
       unsigned rhindex = topocluster[irh];
       
-      const reco::PFRecHit& rh = rechit( rhindex, rechits);
+      const reco::PFRecHit& rh = rechits[rhindex];
       
       // int layer = rh.layer();
              
@@ -1109,7 +1222,7 @@ PFClusterAlgo::buildPFClusters( const std::vector< unsigned >& topocluster,
       frac.clear();
       double fractot = 0.;
 
-      bool isaseed = isSeed(rhindex);
+      bool isaseed = seedFlag(rhindex);
 
       math::XYZVector cposxyzcell;
       cposxyzcell = rh.position();
@@ -1257,7 +1370,8 @@ PFClusterAlgo::buildPFClusters( const std::vector< unsigned >& topocluster,
     for (  unsigned ic=0; ic<tmp.size(); ++ic ) {
 
       calculateClusterPosition( curpfclusters[ic], curpfclusterswodepthcor[ic], 
-                                true, posCalcNCrystal );
+                                true, posCalcNCrystal, seedsintopocluster[ic], 
+				seedNeighbourFlags ? &seedNeighbours_[ic*ntopo] : 0 );
 #ifdef PFLOW_DEBUG
       if(debug_) cout<<"new iter "<<ic<<endl;
       if(debug_) cout<<curpfclusters[ic]<<endl;
@@ -1282,7 +1396,8 @@ PFClusterAlgo::buildPFClusters( const std::vector< unsigned >& topocluster,
   for(unsigned ic=0; ic<curpfclusters.size(); ic++) {
 
     calculateClusterPosition(curpfclusters[ic], curpfclusterswodepthcor[ic], 
-                             true, posCalcNCrystal);
+                             true, posCalcNCrystal, seedsintopocluster[ic], 
+			     seedNeighbourFlags ? &seedNeighbours_[ic*ntopo] : 0 );
 
     pfClusters_->push_back(curpfclusters[ic]); 
   }
@@ -1294,7 +1409,9 @@ void
 PFClusterAlgo::calculateClusterPosition(reco::PFCluster& cluster,
                                         reco::PFCluster& clusterwodepthcor,
 					bool depcor, 
-					int posCalcNCrystal) {
+					int posCalcNCrystal,
+					unsigned seed,
+					const unsigned char* seedNeighbours) {
 
   if( posCalcNCrystal_ != -1 && 
       posCalcNCrystal_ != 5 && 
@@ -1333,7 +1450,7 @@ PFClusterAlgo::calculateClusterPosition(reco::PFCluster& cluster,
 
     // Find the seed of this sub-cluster (excluding other seeds found in the topological
     // cluster, the energy fraction of which were set to 0 fpr the position determination.
-    if( isSeed(rhi) && fraction > 1e-9 ) {
+    if( seedFlag(rhi) && fraction > 1e-9 ) {
       seedIndex = rhi;
       seedIndexFound = true;
     }
@@ -1365,6 +1482,9 @@ PFClusterAlgo::calculateClusterPosition(reco::PFCluster& cluster,
 
   assert(seedIndexFound);
 
+  // the precomputed neighbour flags are only valid for their own seed
+  if ( seedIndex != seed ) seedNeighbours = 0;
+
   // loop over pairs to find layer with max energy          
   double Emax = 0.;
   PFLayer::Layer layer = PFLayer::NONE;
@@ -1455,12 +1575,17 @@ PFClusterAlgo::calculateClusterPosition(reco::PFCluster& cluster,
     const reco::PFRecHit& rh = *(cluster.rechits_[ic].recHitRef());
 
     if(rhi != seedIndex) { // not the seed
-      if( posCalcNCrystal == 5 ) { // pos calculated from the 5 neighbours only
+      if( seedNeighbours ) { // 5 or 9 neighbours, precomputed
+	if( !seedNeighbours[ topoPosition_[rhi] ] ) {
+	  continue;
+	}
+      }
+      else if( posCalcNCrystal == 5 ) { // pos calculated from the 5 neighbours only
 	if(!rh.isNeighbour4(seedIndex) ) {
 	  continue;
 	}
       }
-      if( posCalcNCrystal == 9 ) { // pos calculated from the 9 neighbours only
+      else if( posCalcNCrystal == 9 ) { // pos calculated from the 9 neighbours only
 	if(!rh.isNeighbour8(seedIndex) ) {
 	  continue;
 	}
@@ -1588,12 +1713,17 @@ PFClusterAlgo::calculateClusterPosition(reco::PFCluster& cluster,
       const reco::PFRecHit& rh = *(cluster.rechits_[ic].recHitRef());
 
       if(rhi != seedIndex) {
-	if( posCalcNCrystal == 5 ) {
+	if( seedNeighbours ) {
+	  if( !seedNeighbours[ topoPosition_[rhi] ] ) {
+	    continue;
+	  }
+	}
+	else if( posCalcNCrystal == 5 ) {
 	  if(!rh.isNeighbour4(seedIndex) ) {
 	    continue;
 	  }
 	}
-	if( posCalcNCrystal == 9 ) {
+	else if( posCalcNCrystal == 9 ) {
 	  if(!rh.isNeighbour8(seedIndex) ) {
 	    continue;
 	  }
@@ -1675,46 +1805,47 @@ PFClusterAlgo::rechit(unsigned i,
 
 bool PFClusterAlgo::masked(unsigned rhi) const {
 
-  if(rhi>=mask_.size() ) { // rhi >= 0, since rhi is unsigned
+  if(rhi>=states_.size() ) { // rhi >= 0, since rhi is unsigned
     string err = "PFClusterAlgo::masked : out of range";
     throw std::out_of_range(err);
   }
   
-  return mask_[rhi];
+  return isMasked(rhi);
 }
 
 
 unsigned PFClusterAlgo::color(unsigned rhi) const {
 
-  if(rhi>=color_.size() ) { // rhi >= 0, since rhi is unsigned
+  if(rhi>=states_.size() ) { // rhi >= 0, since rhi is unsigned
     string err = "PFClusterAlgo::color : out of range";
     throw std::out_of_range(err);
   }
   
-  return color_[rhi];
+  return ( states_[rhi] & COLOR_BITS ) >> COLOR_SHIFT;
 }
 
 
 
 bool PFClusterAlgo::isSeed(unsigned rhi) const {
 
-  if(rhi>=seedStates_.size() ) { // rhi >= 0, since rhi is unsigned
+  if(rhi>=states_.size() ) { // rhi >= 0, since rhi is unsigned
     string err = "PFClusterAlgo::isSeed : out of range";
     throw std::out_of_range(err);
   }
   
-  return seedStates_[rhi]>0 ? true : false;
+  return seedFlag(rhi);
 }
 
 
+// the colors are only painted in PFLOW_DEBUG builds
 void PFClusterAlgo::paint(unsigned rhi, unsigned color ) {
 
-  if(rhi>=color_.size() ) { // rhi >= 0, since rhi is unsigned
+  if(rhi>=states_.size() ) { // rhi >= 0, since rhi is unsigned
     string err = "PFClusterAlgo::color : out of range";
     throw std::out_of_range(err);
   }
   
-  color_[rhi] = color;
+  states_[rhi] = ( states_[rhi] & ~COLOR_BITS ) | ( ( color << COLOR_SHIFT ) & COLOR_BITS );
 }
 
 
@@ -1725,6 +1856,9 @@ PFClusterAlgo::createRecHitRef( const reco::PFRecHitCollection& rechits,
   if( rechitsHandle_.isValid() ) {
     return reco::PFRecHitRef(  rechitsHandle_, rhi );
   } 
+  else if( rechitsOrphanHandle_.isValid() ) {
+    return reco::PFRecHitRef(  rechitsOrphanHandle_, rhi );
+  } 
   else {
     return reco::PFRecHitRef(  &rechits, rhi );
   }
@@ -1769,21 +1903,58 @@ ostream& operator<<(ostream& out,const PFClusterAlgo& algo) {
 
 //compute the unsigned distance to the closest phi-crack in the barrel
 std::pair<double,double>
-PFClusterAlgo::dCrack(double phi, double eta){
+PFClusterAlgo::crackDistance( const reco::PFRecHit& rh ) const {
 
-  static double pi= M_PI;// 3.14159265358979323846;
-  
-  //Location of the 18 phi-cracks
-  static std::vector<double> cPhi;
-  if(cPhi.size()==0)
-    {
-      cPhi.resize(18,0);
-      cPhi[0]=2.97025;
-      for(unsigned i=1;i<=17;++i) cPhi[i]=cPhi[0]-2*i*pi/18;
-    }
+  switch ( rh.layer() ) { 
+  case PFLayer::ECAL_BARREL: {
+    unsigned index = EBDetId(rh.detId()).hashedIndex();
+    if ( index < crackDistBarrel_.size() ) return crackDistBarrel_[index];
+    break;
+  }
+  case PFLayer::ECAL_ENDCAP: {
+    unsigned index = EEDetId(rh.detId()).hashedIndex();
+    if ( index < crackDistEndcap_.size() ) return crackDistEndcap_[index];
+    break;
+  }
+  default:
+    break;
+  }
+
+  return dCrack( rh.position().phi(), rh.position().eta() );
+}
+
+
+namespace {
+
+  constexpr double pi = M_PI;
 
-  //Shift of this location if eta<0
-  static double delta_cPhi=0.00638;
+  /// Location of the i-th phi-crack
+  constexpr double crackPhi( unsigned i ) { return 2.97025 - 2*i*pi/18; }
+
+  /// Location of the 18 phi-cracks
+  constexpr double cPhi[18] = { 
+    crackPhi(0),  crackPhi(1),  crackPhi(2),  crackPhi(3),  crackPhi(4),  crackPhi(5), 
+    crackPhi(6),  crackPhi(7),  crackPhi(8),  crackPhi(9),  crackPhi(10), crackPhi(11), 
+    crackPhi(12), crackPhi(13), crackPhi(14), crackPhi(15), crackPhi(16), crackPhi(17) 
+  };
+
+  /// Shift of this location if eta<0
+  constexpr double delta_cPhi = 0.00638;
+
+  /// Location of the 9 eta-cracks
+  constexpr double cEta[9] = { 
+    0.0,
+    4.44747e-01, -4.44747e-01,
+    7.92824e-01, -7.92824e-01,
+    1.14090e+00, -1.14090e+00,
+    1.47464e+00, -1.47464e+00
+  };
+
+}
+
+
+std::pair<double,double>
+PFClusterAlgo::dCrack(double phi, double eta){
 
   double defi; //the result
 
@@ -1813,21 +1984,13 @@ PFClusterAlgo::dCrack(double phi, double eta){
   }
   else{
     defi=0.;        //if there is a problem, we assum that we are in a crack
-    std::cout<<"Problem in dminphi"<<std::endl;
+    LogDebug("PFClusterAlgo")<<"Problem in dminphi, phi = "<<phi;
   }
   //if(eta<0) defi=-defi;   //because of the disymetry
 
-  static std::vector<double> cEta;
-  if ( cEta.size() == 0 ) { 
-    cEta.push_back(0.0);
-    cEta.push_back(4.44747e-01)  ;   cEta.push_back(-4.44747e-01)  ;
-    cEta.push_back(7.92824e-01)  ;   cEta.push_back(-7.92824e-01) ;
-    cEta.push_back(1.14090e+00)  ;   cEta.push_back(-1.14090e+00)  ;
-    cEta.push_back(1.47464e+00)  ;   cEta.push_back(-1.47464e+00)  ;
-  }
   double deta = 999.; // the other result
 
-  for ( unsigned ieta=0; ieta<cEta.size(); ++ieta ) { 
+  for ( unsigned ieta=0; ieta<9; ++ieta ) { 
     deta = std::min(deta,fabs(eta-cEta[ieta]));
   }
   
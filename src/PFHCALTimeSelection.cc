@@ -0,0 +1,115 @@
+#include "RecoParticleFlow/PFClusterProducer/interface/PFHCALTimeSelection.h"
+
+#include <limits>
+#include <sstream>
+
+#include "DataFormats/HcalDetId/interface/HcalSubdetector.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+using namespace std;
+
+namespace {
+
+  // time window for signal=4, by depth
+  const double slewAHB[] = { 48.9580, 34.2860, 38.6872 };
+  const double slewBHB[] = { 2.16078, 1.23746, 1.48051 };
+  const double minTimeHB[] = { -20, -17, -15 };
+  const double maxTimeHB[] = { 5, 8, 10 };
+
+  const double slewAHE[] = { 60.8050, 47.1677, 37.1941, 42.9898, 48.3157 };
+  const double slewBHE[] = { 3.07285, 2.06485, 1.53790, 1.92969, 2.29903 };
+  const double minTimeHE[] = { -20, -19, -18, -17, -15 };
+  const double maxTimeHE[] = { 5, 6, 7, 8, 10 };
+
+  template<unsigned N>
+  vector<double> table( const double (&values)[N] ) {
+    return vector<double>( values, values+N );
+  }
+}
+
+
+
+PFHCALDualTimeSelection::PFHCALDualTimeSelection( const edm::ParameterSet& iConfig ) {
+
+  if( iConfig.exists("dualTimeSelection") ) {
+    edm::ParameterSet pset = 
+      iConfig.getParameter<edm::ParameterSet>("dualTimeSelection");
+    setRows( HcalBarrel, 
+	     pset.getParameter< vector<double> >("HB_slewA"),
+	     pset.getParameter< vector<double> >("HB_slewB"),
+	     pset.getParameter< vector<double> >("HB_minTime"),
+	     pset.getParameter< vector<double> >("HB_maxTime") );
+    setRows( HcalEndcap, 
+	     pset.getParameter< vector<double> >("HE_slewA"),
+	     pset.getParameter< vector<double> >("HE_slewB"),
+	     pset.getParameter< vector<double> >("HE_minTime"),
+	     pset.getParameter< vector<double> >("HE_maxTime") );
+  }
+  else {
+    setRows( HcalBarrel, table(slewAHB), table(slewBHB), 
+	     table(minTimeHB), table(maxTimeHB) );
+    setRows( HcalEndcap, table(slewAHE), table(slewBHE), 
+	     table(minTimeHE), table(maxTimeHE) );
+  }
+
+  // no correction, empty window
+  reject_ = slewA_.size();
+  slewA_.push_back( 0. );
+  slewB_.push_back( 1. );
+  minTime_.push_back( numeric_limits<double>::max() );
+  maxTime_.push_back( -numeric_limits<double>::max() );
+}
+
+
+
+void 
+PFHCALDualTimeSelection::setRows( int subdet,
+				  const vector<double>& slewA,
+				  const vector<double>& slewB,
+				  const vector<double>& minTime,
+				  const vector<double>& maxTime ) {
+
+  if( slewB.size() != slewA.size() || 
+      minTime.size() != slewA.size() || 
+      maxTime.size() != slewA.size() ) {
+    ostringstream err;
+    err<<"PFHCALDualTimeSelection: the slewing and time window tables of "
+       <<(subdet == HcalBarrel ? "HB" : "HE")<<" have different sizes";
+    throw cms::Exception("Configuration", err.str());
+  }
+
+  unsigned index = subdet == HcalEndcap ? 1 : 0;
+  firstRow_[index] = slewA_.size();
+  nDepths_[index] = slewA.size();
+  slewA_.insert( slewA_.end(), slewA.begin(), slewA.end() );
+  slewB_.insert( slewB_.end(), slewB.begin(), slewB.end() );
+  minTime_.insert( minTime_.end(), minTime.begin(), minTime.end() );
+  maxTime_.insert( maxTime_.end(), maxTime.begin(), maxTime.end() );
+}
+
+
+
+void
+PFHCALDualTimeSelection::select( unsigned n,
+				 const HcalDetId* detids,
+				 const double* energies,
+				 double* times,
+				 unsigned char* accept ) const {
+
+  // look up the rows first, so that the correction loop 
+  // has no branch and can be vectorized
+  vector<unsigned> rows( n );
+  for(unsigned i=0; i<n; ++i) rows[i] = row( detids[i] );
+
+  const double* slewA = &slewA_[0];
+  const double* slewB = &slewB_[0];
+  const double* minTime = &minTime_[0];
+  const double* maxTime = &maxTime_[0];
+  for(unsigned i=0; i<n; ++i) {
+    unsigned r = rows[i];
+    double time = times[i] - slewA[r]/(slewB[r]+energies[i]);
+    times[i] = time;
+    accept[i] = ( time > minTime[r] ) & ( time < maxTime[r] );
+  }
+}
@@ -0,0 +1,36 @@
+#include "RecoParticleFlow/PFClusterProducer/interface/PFRecHitSlim.h"
+
+#include "DataFormats/ParticleFlowReco/interface/PFRecHit.h"
+
+using namespace std;
+
+
+
+void reco::PFRecHitSlim::fill( const reco::PFRecHitCollection& rechits ) {
+
+  const unsigned n = rechits.size();
+
+  detId.resize( n );
+  energy.resize( n );
+  time.resize( n );
+  neighbourOffsets.resize( n+1 );
+  nNeighbours4.resize( n );
+  neighbours.clear();
+
+  for(unsigned i=0; i<n; ++i) {
+    const reco::PFRecHit& rh = rechits[i];
+    detId[i] = rh.detId();
+    energy[i] = rh.energy();
+    time[i] = rh.rescale();
+
+    const vector<unsigned>& neighbours4 = rh.neighbours4();
+    const vector<unsigned>& neighbours8 = rh.neighbours8();
+    neighbourOffsets[i] = neighbours.size();
+    nNeighbours4[i] = neighbours4.size();
+    neighbours.insert( neighbours.end(),
+		       neighbours4.begin(), neighbours4.end() );
+    neighbours.insert( neighbours.end(),
+		       neighbours8.begin(), neighbours8.end() );
+  }
+  neighbourOffsets[n] = neighbours.size();
+}
@@ -0,0 +1,9 @@
+#include "RecoParticleFlow/PFClusterProducer/interface/PFRecHitSlim.h"
+#include "DataFormats/Common/interface/Wrapper.h"
+
+namespace {
+  struct dictionary {
+    reco::PFRecHitSlim                slim;
+    edm::Wrapper<reco::PFRecHitSlim>  wslim;
+  };
+}
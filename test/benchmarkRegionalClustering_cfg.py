@@ -0,0 +1,81 @@
+import FWCore.ParameterSet.Config as cms
+
+# timing of the regional particle flow clustering, as a function 
+# of the number of regions. The regions are built around the 
+# nRegions leading L1 candidates. nRegions=0 runs the standard, 
+# full detector clustering. Example:
+#
+#   for n in 0 1 2 4 8 16; do
+#     cmsRun benchmarkRegionalClustering_cfg.py nRegions=$n > timing_$n.log
+#   done
+#
+# and compare the TimeReport summaries of the rechit and cluster modules.
+
+from FWCore.ParameterSet.VarParsing import VarParsing
+options = VarParsing('analysis')
+options.register('nRegions', 4,
+                 VarParsing.multiplicity.singleton,
+                 VarParsing.varType.int,
+                 "number of regions, 0 for the full detector")
+options.maxEvents = 200
+options.inputFiles = "/store/relval/CMSSW_4_3_0_pre6/RelValTTbar/GEN-SIM-RECO/START43_V3-v1/0085/BC545C44-9F8B-E011-9371-0030486791AA.root"
+options.parseArguments()
+
+process = cms.Process("PFCBENCH")
+
+process.load("Configuration.StandardSequences.Geometry_cff")
+process.load('Configuration/StandardSequences/FrontierConditions_GlobalTag_cff')
+from Configuration.AlCa.autoCond import autoCond
+process.GlobalTag.globaltag = autoCond['startup']
+
+process.source = cms.Source("PoolSource", 
+                            fileNames = cms.untracked.vstring(options.inputFiles) )
+
+process.maxEvents = cms.untracked.PSet(
+    input = cms.untracked.int32(options.maxEvents)
+)
+
+process.load("RecoLocalCalo.HcalRecAlgos.hcalRecAlgoESProd_cfi")
+process.load("RecoLocalCalo.EcalRecAlgos.EcalSeverityLevelESProducer_cfi")
+
+process.load("RecoParticleFlow.PFClusterProducer.particleFlowClusterRegional_cff")
+
+# the nRegions leading L1 candidates
+process.l1Seeds = cms.EDProducer("CandViewMerger",
+    src = process.pfClusteringRegions.regionSeeds
+)
+process.l1LeadingSeeds = cms.EDFilter("LargestEtCandViewSelector",
+    src = cms.InputTag("l1Seeds"),
+    maxNumber = cms.uint32(max(options.nRegions, 1))
+)
+
+for label in ["particleFlowRecHitECALRegional", 
+              "particleFlowClusterECALRegional",
+              "particleFlowRecHitHCALRegional", 
+              "particleFlowClusterHCALRegional",
+              "particleFlowClusterHFEMRegional",
+              "particleFlowClusterHFHADRegional",
+              "particleFlowRecHitHORegional", 
+              "particleFlowClusterHORegional",
+              "particleFlowRecHitPSRegional", 
+              "particleFlowClusterPSRegional"]:
+    getattr(process, label).regionSeeds = cms.VInputTag(
+        cms.InputTag("l1LeadingSeeds") )
+
+if options.nRegions > 0:
+    process.p = cms.Path(
+        process.l1Seeds*
+        process.l1LeadingSeeds*
+        process.particleFlowClusterRegional
+        )
+else:
+    process.p = cms.Path(
+        process.particleFlowCluster
+        )
+
+process.Timing = cms.Service("Timing",
+    summaryOnly = cms.untracked.bool(True)
+)
+process.options = cms.untracked.PSet(
+    wantSummary = cms.untracked.bool(True)
+)
@@ -0,0 +1,173 @@
+// compares the table-driven dual time selection with the former
+// inline slewing corrections and time windows, by subdetector and
+// depth, at the edges of the windows
+
+#include "RecoParticleFlow/PFClusterProducer/interface/PFHCALTimeSelection.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "DataFormats/HcalDetId/interface/HcalDetId.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+using namespace std;
+
+namespace {
+
+  /// the selection before the tables, for signal=4
+  bool formerSelect( const HcalDetId& detid,
+		     double hitenergy,
+		     double& hittime ) {
+
+    switch( detid.subdet() ) {
+    case HcalBarrel:
+      {
+	if(detid.depth()==1) {
+	  hittime -= 48.9580/(2.16078+hitenergy);
+	} else if(detid.depth()==2) {
+	  hittime -= 34.2860/(1.23746+hitenergy);
+	} else if(detid.depth()==3) {
+	  hittime -= 38.6872/(1.48051+hitenergy);
+	}
+	return
+	     (detid.depth()==1 && hittime>-20 && hittime<5)
+	  || (detid.depth()==2 && hittime>-17 && hittime<8)
+	  || (detid.depth()==3 && hittime>-15 && hittime<10);
+      }
+    case HcalEndcap:
+      {
+	if(detid.depth()==1) {
+	  hittime -= 60.8050/(3.07285+hitenergy);
+	} else if(detid.depth()==2) {
+	  hittime -= 47.1677/(2.06485+hitenergy);
+	} else if(detid.depth()==3) {
+	  hittime -= 37.1941/(1.53790+hitenergy);
+	} else if(detid.depth()==4) {
+	  hittime -= 42.9898/(1.92969+hitenergy);
+	} else if(detid.depth()==5) {
+	  hittime -= 48.3157/(2.29903+hitenergy);
+	}
+	return
+	     (detid.depth()==1 && hittime>-20 && hittime<5)
+	  || (detid.depth()==2 && hittime>-19 && hittime<6)
+	  || (detid.depth()==3 && hittime>-18 && hittime<7)
+	  || (detid.depth()==4 && hittime>-17 && hittime<8)
+	  || (detid.depth()==5 && hittime>-15 && hittime<10);
+      }
+    default:
+      return false;
+    }
+  }
+
+  /// the dualTimeSelection PSet of particleFlowRecHitHCALCombined_cfi
+  edm::ParameterSet configuredTables() {
+
+    const double hbSlewA[] = { 48.9580, 34.2860, 38.6872 };
+    const double hbSlewB[] = { 2.16078, 1.23746, 1.48051 };
+    const double hbMinTime[] = { -20., -17., -15. };
+    const double hbMaxTime[] = { 5., 8., 10. };
+    const double heSlewA[] = { 60.8050, 47.1677, 37.1941, 42.9898, 48.3157 };
+    const double heSlewB[] = { 3.07285, 2.06485, 1.53790, 1.92969, 2.29903 };
+    const double heMinTime[] = { -20., -19., -18., -17., -15. };
+    const double heMaxTime[] = { 5., 6., 7., 8., 10. };
+
+    edm::ParameterSet tables;
+    tables.addParameter( "HB_slewA", vector<double>( hbSlewA, hbSlewA+3 ) );
+    tables.addParameter( "HB_slewB", vector<double>( hbSlewB, hbSlewB+3 ) );
+    tables.addParameter( "HB_minTime", vector<double>( hbMinTime, hbMinTime+3 ) );
+    tables.addParameter( "HB_maxTime", vector<double>( hbMaxTime, hbMaxTime+3 ) );
+    tables.addParameter( "HE_slewA", vector<double>( heSlewA, heSlewA+5 ) );
+    tables.addParameter( "HE_slewB", vector<double>( heSlewB, heSlewB+5 ) );
+    tables.addParameter( "HE_minTime", vector<double>( heMinTime, heMinTime+5 ) );
+    tables.addParameter( "HE_maxTime", vector<double>( heMaxTime, heMaxTime+5 ) );
+
+    edm::ParameterSet iConfig;
+    iConfig.addParameter( "dualTimeSelection", tables );
+    return iConfig;
+  }
+
+  /// compare the selections on the corrected times just below, at and
+  /// just above the window edges of each (subdetector, depth), for a
+  /// few energies. \return the number of differences
+  unsigned compare( const PFHCALTimeSelection& selection,
+		    const char* name ) {
+
+    // including depths outside the tables, and HF
+    const HcalSubdetector subdets[] = { HcalBarrel, HcalEndcap, HcalForward };
+    const int maxDepth[] = { 4, 6, 2 };
+    const double edges[] = { -20, -19, -18, -17, -15, 5, 6, 7, 8, 10 };
+    const double energies[] = { 0., 0.5, 3., 20., 150. };
+
+    vector<HcalDetId> detids;
+    vector<double> hitEnergies;
+    vector<double> times;
+    for(unsigned is=0; is<3; ++is)
+      for(int depth=0; depth<=maxDepth[is]; ++depth)
+	for(unsigned ie=0; ie<sizeof(energies)/sizeof(double); ++ie)
+	  for(unsigned ed=0; ed<sizeof(edges)/sizeof(double); ++ed) {
+	    // a raw time corrected to about the edge. the former
+	    // correction is applied to the candidates around it
+	    double corrected = edges[ed];
+	    double time = corrected;
+	    HcalDetId detid( subdets[is], 20, 10, depth );
+	    formerSelect( detid, energies[ie], time );
+	    double raw = 2*corrected - time;
+	    const double candidates[] = {
+	      nextafter( raw, -1e9 ), raw, nextafter( raw, 1e9 ),
+	      corrected - 1e-9, corrected, corrected + 1e-9
+	    };
+	    for(unsigned ic=0; ic<6; ++ic) {
+	      detids.push_back( detid );
+	      hitEnergies.push_back( energies[ie] );
+	      times.push_back( candidates[ic] );
+	    }
+	  }
+
+    const unsigned n = detids.size();
+    vector<double> corrected( times );
+    vector<unsigned char> accept( n );
+    selection.select( n, &detids[0], &hitEnergies[0],
+		      &corrected[0], &accept[0] );
+
+    unsigned nAccepted = 0;
+    unsigned nDiff = 0;
+    for(unsigned i=0; i<n; ++i) {
+      double time = times[i];
+      bool expected = formerSelect( detids[i], hitEnergies[i], time );
+      if( expected ) ++nAccepted;
+      if( bool( accept[i] ) != expected || corrected[i] != time ) {
+	++nDiff;
+	cerr<<name<<": subdet "<<detids[i].subdet()
+	    <<" depth "<<detids[i].depth()
+	    <<" E "<<hitEnergies[i]<<" t "<<times[i]
+	    <<": accept "<<int(accept[i])<<" t "<<corrected[i]
+	    <<", expected "<<expected<<" t "<<time<<endl;
+      }
+    }
+
+    cout<<name<<": "<<n<<" hits, "<<nAccepted<<" accepted, "
+	<<nDiff<<" differences"<<endl;
+
+    // the edges must have been probed from both sides
+    if( nAccepted == 0 || nAccepted == n ) ++nDiff;
+    return nDiff;
+  }
+}
+
+
+
+int main() {
+
+  unsigned nDiff = 0;
+
+  // default tables
+  PFHCALDualTimeSelection defaultSelection( (edm::ParameterSet()) );
+  nDiff += compare( defaultSelection, "default tables" );
+
+  // tables from the configuration
+  PFHCALDualTimeSelection configuredSelection( configuredTables() );
+  nDiff += compare( configuredSelection, "configured tables" );
+
+  return nDiff == 0 ? 0 : 1;
+}